@@ -211,6 +211,7 @@ typedef enum {
 
 /* Handle types. */
 typedef struct uv_loop_s uv_loop_t;
+typedef struct uv_loop_group_s uv_loop_group_t;
 typedef struct uv_handle_s uv_handle_t;
 typedef struct uv_dir_s uv_dir_t;
 typedef struct uv_stream_s uv_stream_t;
@@ -228,6 +229,7 @@ typedef struct uv_process_s uv_process_t;
 typedef struct uv_fs_event_s uv_fs_event_t;
 typedef struct uv_fs_poll_s uv_fs_poll_t;
 typedef struct uv_signal_s uv_signal_t;
+typedef struct uv_channel_s uv_channel_t;
 
 /* Request types. */
 typedef struct uv_req_s uv_req_t;
@@ -249,10 +251,22 @@ typedef struct uv_dirent_s uv_dirent_t;
 typedef struct uv_passwd_s uv_passwd_t;
 typedef struct uv_utsname_s uv_utsname_t;
 typedef struct uv_statfs_s uv_statfs_t;
+typedef struct uv_work_queue_stats_s uv_work_queue_stats_t;
+typedef struct uv_threadpool_metrics_s uv_threadpool_metrics_t;
+typedef struct uv_metrics_s uv_metrics_t;
+typedef struct uv_metrics_histogram_s uv_metrics_histogram_t;
+typedef struct uv_slow_callback_info_s uv_slow_callback_info_t;
 
 typedef enum {
   UV_LOOP_BLOCK_SIGNAL = 0,
-  UV_METRICS_IDLE_TIME
+  UV_METRICS_IDLE_TIME,
+  UV_LOOP_USE_IO_URING,
+  UV_LOOP_USE_TIMER_WHEEL,
+  UV_LOOP_USE_EDGE_TRIGGERED,
+  UV_LOOP_BUSY_POLL,
+  UV_METRICS_PHASES,
+  UV_LOOP_READ_BUDGET,
+  UV_LOOP_READ_ROUND_ROBIN
 } uv_loop_option;
 
 typedef enum {
@@ -324,6 +338,9 @@ typedef void (*uv_close_cb)(uv_handle_t* handle);
 typedef void (*uv_poll_cb)(uv_poll_t* handle, int status, int events);
 typedef void (*uv_timer_cb)(uv_timer_t* handle);
 typedef void (*uv_async_cb)(uv_async_t* handle);
+typedef void (*uv_channel_cb)(uv_channel_t* handle,
+                              void** msgs,
+                              unsigned int nmsgs);
 typedef void (*uv_prepare_cb)(uv_prepare_t* handle);
 typedef void (*uv_check_cb)(uv_check_t* handle);
 typedef void (*uv_idle_cb)(uv_idle_t* handle);
@@ -516,6 +533,14 @@ UV_EXTERN int uv_read_start(uv_stream_t*,
                             uv_read_cb read_cb);
 UV_EXTERN int uv_read_stop(uv_stream_t*);
 
+UV_EXTERN int uv_read_pool_init(uv_loop_t* loop,
+                                size_t buf_size,
+                                unsigned int max_free);
+UV_EXTERN void uv_read_pool_alloc(uv_handle_t* handle,
+                                  size_t suggested_size,
+                                  uv_buf_t* buf);
+UV_EXTERN void uv_read_pool_release(uv_loop_t* loop, const uv_buf_t* buf);
+
 UV_EXTERN int uv_write(uv_write_t* req,
                        uv_stream_t* handle,
                        const uv_buf_t bufs[],
@@ -549,6 +574,9 @@ UV_EXTERN int uv_is_readable(const uv_stream_t* handle);
 UV_EXTERN int uv_is_writable(const uv_stream_t* handle);
 
 UV_EXTERN int uv_stream_set_blocking(uv_stream_t* handle, int blocking);
+UV_EXTERN int uv_stream_set_read_budget(uv_stream_t* handle,
+                                        unsigned int reads,
+                                        size_t bytes);
 
 UV_EXTERN int uv_is_closing(const uv_handle_t* handle);
 
@@ -571,11 +599,21 @@ UV_EXTERN int uv_tcp_nodelay(uv_tcp_t* handle, int enable);
 UV_EXTERN int uv_tcp_keepalive(uv_tcp_t* handle,
                                int enable,
                                unsigned int delay);
+UV_EXTERN int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold);
 UV_EXTERN int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable);
+UV_EXTERN int uv_tcp_accept_batch(uv_tcp_t* handle, unsigned int batch);
+UV_EXTERN int uv_tcp_accept_handoff(uv_tcp_t* handle,
+                                    uv_channel_t* channels[],
+                                    unsigned int nchannels);
 
 enum uv_tcp_flags {
   /* Used with uv_tcp_bind, when an IPv6 address is used. */
-  UV_TCP_IPV6ONLY = 1
+  UV_TCP_IPV6ONLY = 1,
+
+  /* Used with uv_tcp_bind, lets several sockets bind to the same address and
+   * port. The kernel load balances incoming connections between them.
+   */
+  UV_TCP_REUSEPORT = 2
 };
 
 UV_EXTERN int uv_tcp_bind(uv_tcp_t* handle,
@@ -873,6 +911,27 @@ UV_EXTERN int uv_async_init(uv_loop_t*,
 UV_EXTERN int uv_async_send(uv_async_t* async);
 
 
+/*
+ * A bounded multi-producer, single-consumer queue of pointers. Any thread can
+ * send, the callback runs on the loop the channel belongs to.
+ *
+ * uv_channel_t isn't a handle type of its own, it wraps the uv_async_t that
+ * wakes up the loop. Close it with uv_channel_close().
+ */
+struct uv_channel_s {
+  uv_async_t async;
+  /* Private, don't touch. */
+  void* channel_ctx;
+};
+
+UV_EXTERN int uv_channel_init(uv_loop_t* loop,
+                              uv_channel_t* channel,
+                              unsigned int capacity,
+                              uv_channel_cb channel_cb);
+UV_EXTERN int uv_channel_send(uv_channel_t* channel, void* msg);
+UV_EXTERN void uv_channel_close(uv_channel_t* channel, uv_close_cb close_cb);
+
+
 /*
  * uv_timer_t is a subclass of uv_handle_t.
  *
@@ -888,6 +947,11 @@ UV_EXTERN int uv_timer_start(uv_timer_t* handle,
                              uv_timer_cb cb,
                              uint64_t timeout,
                              uint64_t repeat);
+UV_EXTERN int uv_timer_start_ex(uv_timer_t* handle,
+                                uv_timer_cb cb,
+                                uint64_t timeout,
+                                uint64_t repeat,
+                                uint64_t slack);
 UV_EXTERN int uv_timer_stop(uv_timer_t* handle);
 UV_EXTERN int uv_timer_again(uv_timer_t* handle);
 UV_EXTERN void uv_timer_set_repeat(uv_timer_t* handle, uint64_t repeat);
@@ -1095,10 +1159,54 @@ struct uv_work_s {
   UV_WORK_PRIVATE_FIELDS
 };
 
+typedef enum {
+  UV_WORK_PRIORITY_HIGH = 0,
+  UV_WORK_PRIORITY_NORMAL,
+  UV_WORK_PRIORITY_LOW
+} uv_work_priority_t;
+
+struct uv_work_queue_stats_s {
+  uint64_t depth;          /* requests waiting to run */
+  uint64_t submitted;
+  uint64_t started;
+  uint64_t wait_time;      /* nanoseconds, summed over all started requests */
+  uint64_t max_wait_time;  /* nanoseconds */
+};
+
+#define UV_THREADPOOL_HISTOGRAM_SIZE 32
+
+struct uv_threadpool_metrics_s {
+  uint64_t threads;
+  uint64_t idle_threads;
+  uint64_t queue_depth;        /* requests waiting to run */
+  uint64_t completed;          /* requests that finished running */
+  uint64_t idle_time;          /* nanoseconds, summed over all threads */
+  uint64_t slow_io_throttled;  /* times slow I/O had to wait for a thread */
+  /* Bucket 0 counts durations below 1 microsecond, bucket i > 0 durations
+   * in [2^(i-1), 2^i) microseconds. The last bucket also counts everything
+   * longer. */
+  uint64_t wait_time[UV_THREADPOOL_HISTOGRAM_SIZE];
+  uint64_t run_time[UV_THREADPOOL_HISTOGRAM_SIZE];
+};
+
 UV_EXTERN int uv_queue_work(uv_loop_t* loop,
                             uv_work_t* req,
                             uv_work_cb work_cb,
                             uv_after_work_cb after_work_cb);
+UV_EXTERN int uv_queue_work_ex(uv_loop_t* loop,
+                               uv_work_t* req,
+                               uv_work_priority_t priority,
+                               uv_work_cb work_cb,
+                               uv_after_work_cb after_work_cb);
+UV_EXTERN int uv_work_queue_stats(uv_work_priority_t priority,
+                                  uv_work_queue_stats_t* stats);
+UV_EXTERN int uv_threadpool_resize(unsigned int size);
+UV_EXTERN int uv_threadpool_autoscale(unsigned int min_threads,
+                                      unsigned int max_threads,
+                                      uint64_t wait_threshold,
+                                      uint64_t idle_timeout);
+UV_EXTERN unsigned int uv_threadpool_size(void);
+UV_EXTERN int uv_threadpool_metrics(uv_threadpool_metrics_t* metrics);
 
 UV_EXTERN int uv_cancel(uv_req_t* req);
 
@@ -1276,7 +1384,63 @@ UV_EXTERN int uv_os_gethostname(char* buffer, size_t* size);
 
 UV_EXTERN int uv_os_uname(uv_utsname_t* buffer);
 
+struct uv_metrics_s {
+  uint64_t loop_count;
+  uint64_t backend_ctl;       /* Changes to the backend's interest list. */
+  uint64_t backend_ctl_last;  /* backend_ctl of the previous iteration. */
+  uint64_t busy_poll_time;    /* Nanoseconds spent busy polling. */
+  uint64_t events;            /* I/O events dispatched. */
+  uint64_t callbacks;         /* Callbacks run by the loop. */
+  uint64_t backend_poll;      /* Times the backend was polled for events. */
+  uint64_t* reserved[9];
+};
+
+typedef enum {
+  UV_METRICS_PHASE_TIMERS = 0,
+  UV_METRICS_PHASE_PENDING,
+  UV_METRICS_PHASE_IDLE,
+  UV_METRICS_PHASE_PREPARE,
+  UV_METRICS_PHASE_POLL,
+  UV_METRICS_PHASE_CHECK,
+  UV_METRICS_PHASE_CLOSING,
+  UV_METRICS_PHASE_TICK,  /* The whole iteration. */
+  UV_METRICS_PHASE_MAX
+} uv_metrics_phase;
+
+#define UV_METRICS_HISTOGRAM_SIZE 256
+
+struct uv_metrics_histogram_s {
+  uint64_t count;
+  uint64_t sum;  /* nanoseconds */
+  uint64_t max;  /* nanoseconds */
+  /* Bucket i < 8 counts durations of i nanoseconds. Above that every power of
+   * two is split into 8 buckets of equal width, up to 2^34 nanoseconds. The
+   * last bucket also counts everything longer. */
+  uint64_t buckets[UV_METRICS_HISTOGRAM_SIZE];
+};
+
+UV_EXTERN int uv_metrics_info(uv_loop_t* loop, uv_metrics_t* metrics);
 UV_EXTERN uint64_t uv_metrics_idle_time(uv_loop_t* loop);
+UV_EXTERN int uv_metrics_phase_info(uv_loop_t* loop,
+                                    uv_metrics_phase phase,
+                                    uv_metrics_histogram_t* histogram);
+UV_EXTERN uint64_t uv_metrics_histogram_percentile(
+    const uv_metrics_histogram_t* histogram,
+    double percentile);
+
+struct uv_slow_callback_info_s {
+  uv_metrics_phase phase;
+  uv_handle_type type;  /* UV_UNKNOWN_HANDLE when not known. */
+  int fd;               /* -1 when there is none. */
+  uint64_t duration;    /* nanoseconds */
+};
+
+typedef void (*uv_slow_callback_cb)(uv_loop_t* loop,
+                                    const uv_slow_callback_info_t* info);
+
+UV_EXTERN int uv_loop_set_slow_callback(uv_loop_t* loop,
+                                        uint64_t threshold,
+                                        uv_slow_callback_cb cb);
 
 typedef enum {
   UV_FS_UNKNOWN = -1,
@@ -1771,17 +1935,23 @@ UV_EXTERN int uv_thread_create(uv_thread_t* tid, uv_thread_cb entry, void* arg);
 
 typedef enum {
   UV_THREAD_NO_FLAGS = 0x00,
-  UV_THREAD_HAS_STACK_SIZE = 0x01
+  UV_THREAD_HAS_STACK_SIZE = 0x01,
+  UV_THREAD_HAS_AFFINITY = 0x02
 } uv_thread_create_flags;
 
 struct uv_thread_options_s {
   unsigned int flags;
   size_t stack_size;
+  /* cpumask[i] != 0 means the thread may run on CPU i. */
+  const char* cpumask;
+  size_t mask_size;
   /* More fields may be added at any time. */
 };
 
 typedef struct uv_thread_options_s uv_thread_options_t;
 
+UV_EXTERN int uv_cpumask_size(void);
+
 UV_EXTERN int uv_thread_create_ex(uv_thread_t* tid,
                                   const uv_thread_options_t* params,
                                   uv_thread_cb entry,
@@ -1822,6 +1992,45 @@ struct uv_loop_s {
 UV_EXTERN void* uv_loop_get_data(const uv_loop_t*);
 UV_EXTERN void uv_loop_set_data(uv_loop_t*, void* data);
 
+enum uv_loop_group_flags {
+  /* Used with uv_loop_group_init, pins the thread of loop i to the CPUs c
+   * for which c % nloops == i.
+   */
+  UV_LOOP_GROUP_PIN_THREADS = 1
+};
+
+enum uv_loop_group_listen_flags {
+  /* Used with uv_loop_group_listen, hands a connection to the loop whose
+   * index is the CPU that received it modulo nloops.
+   */
+  UV_LOOP_GROUP_STEER_CPU = 1
+};
+
+struct uv_loop_group_s {
+  /* User data - use this for whatever. */
+  void* data;
+  /* Read-only. */
+  unsigned int nloops;
+  /* Private fields. */
+  unsigned int flags;
+  struct uv__loop_group_member_s* members;
+};
+
+UV_EXTERN int uv_loop_group_init(uv_loop_group_t* group,
+                                 unsigned int nloops,
+                                 unsigned int flags);
+UV_EXTERN uv_loop_t* uv_loop_group_get_loop(const uv_loop_group_t* group,
+                                            unsigned int index);
+UV_EXTERN int uv_loop_group_listen(uv_loop_group_t* group,
+                                   uv_tcp_t* servers,
+                                   const struct sockaddr* addr,
+                                   int backlog,
+                                   unsigned int flags,
+                                   uv_connection_cb cb);
+UV_EXTERN int uv_loop_group_start(uv_loop_group_t* group);
+UV_EXTERN int uv_loop_group_stop(uv_loop_group_t* group);
+UV_EXTERN int uv_loop_group_close(uv_loop_group_t* group);
+
 /* Don't export the private CPP symbols. */
 #undef UV_HANDLE_TYPE_PRIVATE
 #undef UV_REQ_TYPE_PRIVATE
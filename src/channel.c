@@ -0,0 +1,238 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The ring is Dmitry Vyukov's bounded MPMC queue with a single consumer. Every
+ * slot carries a sequence number: a producer may fill the slot when it equals
+ * the position it claimed, the consumer may empty it when it's one past that.
+ * Producers only claim positions with a compare-and-swap on `head`, there is
+ * no lock anywhere.
+ *
+ * `pending` counts sent but not yet drained messages. Only the send that takes
+ * it from zero to one wakes up the loop, the drain that leaves it above zero
+ * wakes up the loop again by itself.
+ */
+#ifdef _WIN32
+#define uv__channel_load(p)                                                   \
+  ((unsigned int) InterlockedCompareExchange((LONG volatile*) (p), 0, 0))
+#define uv__channel_store(p, v)                                               \
+  InterlockedExchange((LONG volatile*) (p), (LONG) (v))
+#define uv__channel_cas(p, o, n)                                              \
+  ((unsigned int) InterlockedCompareExchange((LONG volatile*) (p),            \
+                                             (LONG) (n),                      \
+                                             (LONG) (o)))
+#define uv__channel_add(p, v)                                                 \
+  ((int) InterlockedExchangeAdd((LONG volatile*) (p), (LONG) (v)))
+#else
+#define uv__channel_load(p) uv__load_acquire(p)
+#define uv__channel_store(p, v) uv__store_release(p, v)
+#define uv__channel_cas(p, o, n) __sync_val_compare_and_swap(p, o, n)
+#define uv__channel_add(p, v) __sync_fetch_and_add(p, v)
+#endif
+
+/* Messages handed to the callback at once. */
+#define UV__CHANNEL_BATCH 64
+
+/* Keeps the producers' and the consumer's counters on separate cache lines. */
+#define UV__CHANNEL_PAD 64
+
+#define UV__CHANNEL_MAX_CAPACITY (1u << 30)
+
+struct channel_slot {
+  unsigned int seq;
+  void* msg;
+};
+
+struct channel_ctx {
+  uv_channel_cb channel_cb;
+  uv_close_cb close_cb;
+  unsigned int mask;
+  unsigned int tail;  /* Consumer only. */
+  char pad0[UV__CHANNEL_PAD];
+  unsigned int head;
+  int pending;
+  char pad1[UV__CHANNEL_PAD];
+  void* batch[UV__CHANNEL_BATCH];
+  struct channel_slot slots[1];  /* variable length */
+};
+
+static void channel_async_cb(uv_async_t* async);
+static void channel_close_cb(uv_handle_t* async);
+
+
+int uv_channel_init(uv_loop_t* loop,
+                    uv_channel_t* channel,
+                    unsigned int capacity,
+                    uv_channel_cb channel_cb) {
+  struct channel_ctx* ctx;
+  unsigned int size;
+  unsigned int i;
+  int err;
+
+  if (capacity == 0 || capacity > UV__CHANNEL_MAX_CAPACITY)
+    return UV_EINVAL;
+
+  if (channel_cb == NULL)
+    return UV_EINVAL;
+
+  for (size = 1; size < capacity; size <<= 1);
+
+  ctx = uv__malloc(sizeof(*ctx) + (size - 1) * sizeof(ctx->slots[0]));
+  if (ctx == NULL)
+    return UV_ENOMEM;
+
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->channel_cb = channel_cb;
+  ctx->mask = size - 1;
+
+  for (i = 0; i < size; i++) {
+    ctx->slots[i].seq = i;
+    ctx->slots[i].msg = NULL;
+  }
+
+  err = uv_async_init(loop, &channel->async, channel_async_cb);
+  if (err) {
+    uv__free(ctx);
+    return err;
+  }
+
+  /* Only uv_channel_close() knows how to close it, keep it out of uv_walk(). */
+  channel->async.flags |= UV_HANDLE_INTERNAL;
+  channel->channel_ctx = ctx;
+
+  return 0;
+}
+
+
+int uv_channel_send(uv_channel_t* channel, void* msg) {
+  struct channel_ctx* ctx;
+  struct channel_slot* slot;
+  unsigned int pos;
+  unsigned int seq;
+  unsigned int old;
+  int diff;
+
+  ctx = channel->channel_ctx;
+  pos = uv__channel_load(&ctx->head);
+
+  for (;;) {
+    slot = &ctx->slots[pos & ctx->mask];
+    seq = uv__channel_load(&slot->seq);
+    diff = (int) (seq - pos);
+
+    if (diff < 0)
+      return UV_EAGAIN;  /* Full, the consumer hasn't freed the slot yet. */
+
+    if (diff == 0) {
+      old = uv__channel_cas(&ctx->head, pos, pos + 1);
+      if (old == pos)
+        break;
+      pos = old;  /* Another producer got there first. */
+    } else {
+      pos = uv__channel_load(&ctx->head);
+    }
+  }
+
+  slot->msg = msg;
+  uv__channel_store(&slot->seq, pos + 1);
+
+  if (uv__channel_add(&ctx->pending, 1) == 0)
+    return uv_async_send(&channel->async);
+
+  return 0;
+}
+
+
+void uv_channel_close(uv_channel_t* channel, uv_close_cb close_cb) {
+  struct channel_ctx* ctx;
+
+  ctx = channel->channel_ctx;
+  assert(ctx != NULL);
+
+  /* Messages that weren't drained yet are dropped. */
+  ctx->close_cb = close_cb;
+  uv_close((uv_handle_t*) &channel->async, channel_close_cb);
+}
+
+
+static void channel_async_cb(uv_async_t* async) {
+  struct channel_ctx* ctx;
+  struct channel_slot* slot;
+  uv_channel_t* channel;
+  unsigned int budget;
+  unsigned int n;
+
+  channel = container_of(async, uv_channel_t, async);
+  ctx = channel->channel_ctx;
+
+  /* Don't drain more than a full ring per loop iteration, or a fast producer
+   * could keep the loop here forever.
+   */
+  budget = ctx->mask + 1;
+
+  while (budget > 0) {
+    for (n = 0; n < UV__CHANNEL_BATCH && n < budget; n++) {
+      slot = &ctx->slots[ctx->tail & ctx->mask];
+      if (uv__channel_load(&slot->seq) != ctx->tail + 1)
+        break;  /* Empty, or the producer isn't done with the slot. */
+
+      ctx->batch[n] = slot->msg;
+      uv__channel_store(&slot->seq, ctx->tail + ctx->mask + 1);
+      ctx->tail++;
+    }
+
+    if (n == 0)
+      break;
+
+    budget -= n;
+    uv__channel_add(&ctx->pending, -(int) n);
+    ctx->channel_cb(channel, ctx->batch, n);
+
+    if (uv__is_closing(&channel->async))
+      return;
+  }
+
+  /* Producers don't wake us up while messages are still pending. */
+  if ((int) uv__channel_add(&ctx->pending, 0) > 0)
+    uv_async_send(&channel->async);
+}
+
+
+static void channel_close_cb(uv_handle_t* async) {
+  struct channel_ctx* ctx;
+  uv_channel_t* channel;
+  uv_close_cb close_cb;
+
+  channel = container_of(async, uv_channel_t, async);
+  ctx = channel->channel_ctx;
+  close_cb = ctx->close_cb;
+  channel->channel_ctx = NULL;
+  uv__free(ctx);
+
+  if (close_cb != NULL)
+    close_cb(async);
+}
@@ -0,0 +1,303 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* A loop group is a set of event loops, each running on a thread of its own,
+ * that share the load of a TCP server: every loop listens on a socket of its
+ * own, bound to the same address with SO_REUSEPORT, and the kernel spreads
+ * incoming connections over them. Optionally, a classic BPF program makes
+ * the kernel pick the socket by the CPU that received the connection.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+
+#include <string.h>
+
+#define UV__LOOP_GROUP_RUNNING 0x100
+
+struct uv__loop_group_member_s {
+  uv_loop_t loop;
+  uv_async_t stop_handle;
+  uv_thread_t thread;
+  char* cpumask;  /* NULL when the thread isn't pinned. */
+  size_t mask_size;
+  int stop;
+};
+
+
+static void uv__loop_group_stop_cb(uv_async_t* handle) {
+  struct uv__loop_group_member_s* m;
+
+  m = container_of(handle, struct uv__loop_group_member_s, stop_handle);
+
+  /* Ignore stale wakeups from an earlier uv_loop_group_stop(). */
+  if (m->stop)
+    uv_stop(&m->loop);
+}
+
+
+static void uv__loop_group_run(void* arg) {
+  struct uv__loop_group_member_s* m;
+
+  m = arg;
+  uv_run(&m->loop, UV_RUN_DEFAULT);
+}
+
+
+static void uv__loop_group_close_cb(uv_handle_t* handle, void* arg) {
+  if (!uv_is_closing(handle))
+    uv_close(handle, NULL);
+}
+
+
+/* Pins loop i to the CPUs c for which c % nloops == i, that's the CPU to
+ * loop mapping the steering program of uv_loop_group_listen() uses. Loops
+ * without CPUs of their own run wherever the OS likes.
+ */
+static void uv__loop_group_pin(uv_loop_group_t* group) {
+  struct uv__loop_group_member_s* m;
+  unsigned int i;
+  int size;
+  int c;
+
+  size = uv_cpumask_size();
+  if (size <= 0)
+    return;
+
+  for (i = 0; i < group->nloops && i < (unsigned int) size; i++) {
+    m = group->members + i;
+    m->cpumask = uv__calloc(1, size);
+    if (m->cpumask == NULL)
+      return;
+
+    m->mask_size = size;
+    for (c = i; c < size; c += group->nloops)
+      m->cpumask[c] = 1;
+  }
+}
+
+
+int uv_loop_group_init(uv_loop_group_t* group,
+                       unsigned int nloops,
+                       unsigned int flags) {
+  struct uv__loop_group_member_s* m;
+  unsigned int i;
+  int err;
+
+  if (nloops == 0 || (flags & ~UV_LOOP_GROUP_PIN_THREADS))
+    return UV_EINVAL;
+
+  group->members = uv__calloc(nloops, sizeof(*group->members));
+  if (group->members == NULL)
+    return UV_ENOMEM;
+
+  group->nloops = nloops;
+  group->flags = flags;
+
+  for (i = 0; i < nloops; i++) {
+    m = group->members + i;
+
+    err = uv_loop_init(&m->loop);
+    if (err)
+      goto fail;
+
+    err = uv_async_init(&m->loop, &m->stop_handle, uv__loop_group_stop_cb);
+    if (err) {
+      uv_loop_close(&m->loop);
+      goto fail;
+    }
+  }
+
+  if (flags & UV_LOOP_GROUP_PIN_THREADS)
+    uv__loop_group_pin(group);
+
+  return 0;
+
+fail:
+  while (i-- > 0) {
+    m = group->members + i;
+    uv_close((uv_handle_t*) &m->stop_handle, NULL);
+    uv_run(&m->loop, UV_RUN_DEFAULT);
+    uv_loop_close(&m->loop);
+  }
+
+  uv__free(group->members);
+  group->members = NULL;
+  return err;
+}
+
+
+uv_loop_t* uv_loop_group_get_loop(const uv_loop_group_t* group,
+                                  unsigned int index) {
+  if (index >= group->nloops)
+    return NULL;
+
+  return &group->members[index].loop;
+}
+
+
+int uv_loop_group_listen(uv_loop_group_t* group,
+                         uv_tcp_t* servers,
+                         const struct sockaddr* addr,
+                         int backlog,
+                         unsigned int flags,
+                         uv_connection_cb cb) {
+  unsigned int i;
+  int err;
+
+  if (flags & ~UV_LOOP_GROUP_STEER_CPU)
+    return UV_EINVAL;
+
+  if (group->flags & UV__LOOP_GROUP_RUNNING)
+    return UV_EBUSY;
+
+  /* The kernel numbers the sockets of a SO_REUSEPORT group in the order they
+   * start listening, the steering program relies on that.
+   */
+  for (i = 0; i < group->nloops; i++) {
+    err = uv_tcp_init(&group->members[i].loop, servers + i);
+    if (err)
+      goto fail;
+
+    err = uv_tcp_bind(servers + i, addr, UV_TCP_REUSEPORT);
+    if (err == 0)
+      err = uv_listen((uv_stream_t*) (servers + i), backlog, cb);
+    if (err) {
+      i++;
+      goto fail;
+    }
+  }
+
+  if (flags & UV_LOOP_GROUP_STEER_CPU) {
+    err = uv__tcp_reuseport_steer_cpu(servers, group->nloops);
+    if (err)
+      goto fail;
+  }
+
+  return 0;
+
+fail:
+  /* Closed for real by uv_loop_group_close(). */
+  while (i-- > 0)
+    uv_close((uv_handle_t*) (servers + i), NULL);
+
+  return err;
+}
+
+
+int uv_loop_group_start(uv_loop_group_t* group) {
+  struct uv__loop_group_member_s* m;
+  uv_thread_options_t options;
+  unsigned int nloops;
+  unsigned int i;
+  int err;
+
+  if (group->flags & UV__LOOP_GROUP_RUNNING)
+    return UV_EBUSY;
+
+  for (i = 0; i < group->nloops; i++) {
+    m = group->members + i;
+    m->stop = 0;
+
+    err = UV_EINVAL;
+    if (m->cpumask != NULL) {
+      options.flags = UV_THREAD_HAS_AFFINITY;
+      options.cpumask = m->cpumask;
+      options.mask_size = m->mask_size;
+      err = uv_thread_create_ex(&m->thread, &options, uv__loop_group_run, m);
+    }
+
+    /* Not pinned or the CPUs are offline, run wherever the OS likes. */
+    if (err)
+      err = uv_thread_create(&m->thread, uv__loop_group_run, m);
+
+    if (err) {
+      /* Stop the threads that did start. */
+      nloops = group->nloops;
+      group->nloops = i;
+      group->flags |= UV__LOOP_GROUP_RUNNING;
+      uv_loop_group_stop(group);
+      group->nloops = nloops;
+      return err;
+    }
+  }
+
+  group->flags |= UV__LOOP_GROUP_RUNNING;
+  return 0;
+}
+
+
+int uv_loop_group_stop(uv_loop_group_t* group) {
+  struct uv__loop_group_member_s* m;
+  uv_thread_t self;
+  unsigned int i;
+
+  if (!(group->flags & UV__LOOP_GROUP_RUNNING))
+    return UV_EINVAL;
+
+  /* Can't wait for our own thread to exit. */
+  self = uv_thread_self();
+  for (i = 0; i < group->nloops; i++)
+    if (uv_thread_equal(&self, &group->members[i].thread))
+      return UV_EBUSY;
+
+  for (i = 0; i < group->nloops; i++) {
+    m = group->members + i;
+    m->stop = 1;
+    uv_async_send(&m->stop_handle);
+  }
+
+  for (i = 0; i < group->nloops; i++)
+    uv_thread_join(&group->members[i].thread);
+
+  group->flags &= ~UV__LOOP_GROUP_RUNNING;
+  return 0;
+}
+
+
+int uv_loop_group_close(uv_loop_group_t* group) {
+  struct uv__loop_group_member_s* m;
+  unsigned int i;
+  int err;
+
+  if (group->flags & UV__LOOP_GROUP_RUNNING)
+    return UV_EBUSY;
+
+  for (i = 0; i < group->nloops; i++) {
+    m = group->members + i;
+    uv_walk(&m->loop, uv__loop_group_close_cb, NULL);
+    uv_run(&m->loop, UV_RUN_DEFAULT);
+  }
+
+  for (i = 0; i < group->nloops; i++) {
+    err = uv_loop_close(&group->members[i].loop);
+    if (err)
+      return err;
+  }
+
+  for (i = 0; i < group->nloops; i++)
+    uv__free(group->members[i].cpumask);
+
+  uv__free(group->members);
+  group->members = NULL;
+  group->nloops = 0;
+  return 0;
+}
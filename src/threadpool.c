@@ -27,23 +27,101 @@
 
 #include <stdlib.h>
 
+#define DEFAULT_THREADPOOL_SIZE 4
 #define MAX_THREADPOOL_SIZE 1024
+#define THREADS_PER_SHARD 4
+
+/* The pool is split into shards of up to THREADS_PER_SHARD workers, each with
+ * its own lock, condition variable and queues. Every loop submits to one
+ * shard (assigned round-robin on first use) so loops living on different
+ * threads don't all serialize on a single mutex. Workers that run out of work
+ * in their own shard steal from the others before going to sleep.
+ *
+ * With the default pool size there is exactly one shard and the scheduling
+ * behavior is unchanged.
+ *
+ * Within a shard, UV_WORK_PRIORITY_HIGH requests live in their own queue that
+ * is always served first. Low priority work shares the slow I/O queue and its
+ * concurrency limit, so bulk work can never occupy every worker of a shard
+ * with more than one thread. The queue of a request therefore tells its
+ * priority class.
+ */
+
+/* Submission times of the requests in one queue, oldest first. Requests
+ * leave a queue in order unless they're cancelled, so the times can be kept
+ * here rather than in struct uv__work, which is part of the public ABI.
+ */
+struct uv__wq_times {
+  uint64_t* times;
+  unsigned int head;
+  unsigned int len;
+  unsigned int size;  /* A power of two or 0. */
+};
+
+struct uv__wq_shard {
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  unsigned int idle_threads;
+  unsigned int slow_io_work_running;
+  unsigned int nthreads;
+  unsigned int min_threads;
+  unsigned int max_threads;
+  uint64_t idle_timeout;    /* Nanoseconds, 0 means idle workers never exit. */
+  char* cpumask;            /* CPUs the workers run on, NULL if not pinned. */
+  int node;                 /* Index into `node_cpus`, -1 if not NUMA-aware. */
+  unsigned int steal_hint;  /* Another shard has work for our idle workers. */
+  QUEUE exit_message;
+  QUEUE high_wq;
+  QUEUE wq;
+  QUEUE run_slow_work_message;
+  QUEUE slow_io_pending_wq;
+  uv_work_queue_stats_t stats[UV_WORK_PRIORITY_LOW + 1];
+  struct uv__wq_times times[UV_WORK_PRIORITY_LOW + 1];
+  /* Pool metrics, see uv_threadpool_metrics(). */
+  uint64_t completed;
+  uint64_t slow_io_throttled;
+  uint64_t idle_time;  /* Integral of `idle_threads` up to `idle_mark`. */
+  uint64_t idle_mark;
+  uint64_t wait_time[UV_THREADPOOL_HISTOGRAM_SIZE];
+  uint64_t run_time[UV_THREADPOOL_HISTOGRAM_SIZE];
+};
+
+struct uv__worker {
+  uv_thread_t thread;
+  struct uv__wq_shard* shard;
+  uv_sem_t* started;  /* Only set for the workers started by init_threads(). */
+  int exited;
+  QUEUE member;
+};
 
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
-static uv_mutex_t mutex;
-static unsigned int idle_threads;
-static unsigned int slow_io_work_running;
+/* Serializes uv_threadpool_resize() and uv_threadpool_autoscale(). */
+static uv_mutex_t config_mutex;
+/* Protects the fields below. Must not be acquired while holding a shard
+ * mutex, the lock order is `pool_mutex` -> `shard->mutex`. */
+static uv_mutex_t pool_mutex;
+static QUEUE workers;
 static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
-static QUEUE run_slow_work_message;
-static QUEUE slow_io_pending_wq;
-
-static unsigned int slow_work_thread_threshold(void) {
-  return (nthreads + 1) / 2;
+/* The manager thread adds workers to shards with a backlog when autoscaling
+ * is enabled. */
+static uv_thread_t manager_thread;
+static uv_cond_t manager_cond;
+static int manager_running;
+static uint64_t grow_threshold;  /* Nanoseconds, 0 means no autoscaling. */
+static unsigned int nshards;
+static struct uv__wq_shard* shards;
+static struct uv__wq_shard default_shards[1];
+static unsigned int next_shard;  /* Protected by shards[0].mutex. */
+/* Worker placement, see init_affinity(). */
+static size_t cpumask_size;
+static char* pool_cpus;  /* UV_THREADPOOL_CPUS, NULL if not set. */
+static char* node_cpus;  /* `nnodes` masks of `cpumask_size` bytes. */
+static unsigned int nnodes;
+
+static void init_once(void);
+
+static unsigned int slow_work_thread_threshold(struct uv__wq_shard* shard) {
+  return (shard->nthreads + 1) / 2;
 }
 
 static void uv__cancelled(struct uv__work* w) {
@@ -51,112 +129,730 @@ static void uv__cancelled(struct uv__work* w) {
 }
 
 
-/* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
+static unsigned int work_priority(enum uv__work_kind kind) {
+  switch (kind) {
+    case UV__WORK_LATENCY:
+      return UV_WORK_PRIORITY_HIGH;
+    case UV__WORK_SLOW_IO:
+      return UV_WORK_PRIORITY_LOW;
+    default:
+      return UV_WORK_PRIORITY_NORMAL;
+  }
+}
+
+
+/* Maps a duration in nanoseconds to its power-of-two microsecond bucket. */
+static unsigned int histogram_bucket(uint64_t duration) {
+  unsigned int i;
+
+  duration /= 1000;
+  for (i = 0; duration != 0 && i < UV_THREADPOOL_HISTOGRAM_SIZE - 1; i++)
+    duration >>= 1;
+
+  return i;
+}
+
+
+static void times_push(struct uv__wq_times* t, uint64_t time) {
+  uint64_t* times;
+  unsigned int size;
+  unsigned int i;
+
+  if (t->len == t->size) {
+    size = t->size != 0 ? 2 * t->size : 16;
+    times = uv__malloc(size * sizeof(*times));
+    if (times == NULL)
+      abort();
+
+    for (i = 0; i < t->len; i++)
+      times[i] = t->times[(t->head + i) & (t->size - 1)];
+
+    uv__free(t->times);
+    t->times = times;
+    t->head = 0;
+    t->size = size;
+  }
+
+  t->times[(t->head + t->len) & (t->size - 1)] = time;
+  t->len++;
+}
+
+
+/* Removes and returns the time of the request at position `i`. */
+static uint64_t times_remove(struct uv__wq_times* t, unsigned int i) {
+  unsigned int mask;
+  uint64_t time;
+
+  assert(i < t->len);
+  mask = t->size - 1;
+  time = t->times[(t->head + i) & mask];
+
+  if (i == 0)
+    t->head = (t->head + 1) & mask;
+  else
+    for (; i + 1 < t->len; i++)
+      t->times[(t->head + i) & mask] = t->times[(t->head + i + 1) & mask];
+
+  t->len--;
+  return time;
+}
+
+
+/* Returns the priority class of queued request `q` and stores its position
+ * among the requests of its queue in `*index`. `shard->mutex` must be held.
  */
-static void worker(void* arg) {
-  struct uv__work* w;
+static unsigned int queue_position(struct uv__wq_shard* shard,
+                                   QUEUE* q,
+                                   unsigned int* index) {
+  unsigned int priority;
+  unsigned int after;
+
+  after = 0;
+  for (q = QUEUE_NEXT(q); /* empty */; q = QUEUE_NEXT(q)) {
+    if (q == &shard->high_wq) {
+      priority = UV_WORK_PRIORITY_HIGH;
+      break;
+    }
+    if (q == &shard->wq) {
+      priority = UV_WORK_PRIORITY_NORMAL;
+      break;
+    }
+    if (q == &shard->slow_io_pending_wq) {
+      priority = UV_WORK_PRIORITY_LOW;
+      break;
+    }
+    if (q != &shard->exit_message && q != &shard->run_slow_work_message)
+      after++;
+  }
+
+  *index = shard->times[priority].len - 1 - after;
+  return priority;
+}
+
+
+/* Changes the number of idle workers of `shard` by `delta`, accumulating
+ * the time spent idle. `shard->mutex` must be held.
+ */
+static void idle_update(struct uv__wq_shard* shard, int delta) {
+  uint64_t now;
+
+  now = uv_hrtime();
+  shard->idle_time += shard->idle_threads * (now - shard->idle_mark);
+  shard->idle_mark = now;
+  shard->idle_threads += delta;
+}
+
+
+/* Account for the request at the head of the `priority` queue of `shard`
+ * that leaves it to run. `shard->mutex` must be held. Returns the current
+ * time.
+ */
+static uint64_t work_started(struct uv__wq_shard* shard,
+                             unsigned int priority) {
+  uv_work_queue_stats_t* stats;
+  uint64_t now;
+  uint64_t wait;
+
+  stats = &shard->stats[priority];
+  now = uv_hrtime();
+  wait = now - times_remove(&shard->times[priority], 0);
+
+  stats->depth--;
+  stats->started++;
+  stats->wait_time += wait;
+  if (wait > stats->max_wait_time)
+    stats->max_wait_time = wait;
+  shard->wait_time[histogram_bucket(wait)]++;
+
+  return now;
+}
+
+
+/* `shard->mutex` must be held. */
+static int shard_has_work(struct uv__wq_shard* shard) {
+  if (!QUEUE_EMPTY(&shard->high_wq))
+    return 1;
+
+  /* No work is present or only slow I/O and we're at the threshold for
+     that. */
+  if (QUEUE_EMPTY(&shard->wq))
+    return 0;
+
+  if (QUEUE_HEAD(&shard->wq) == &shard->run_slow_work_message &&
+      QUEUE_NEXT(&shard->run_slow_work_message) == &shard->wq &&
+      shard->slow_io_work_running >= slow_work_thread_threshold(shard))
+    return 0;
+
+  return 1;
+}
+
+
+/* Returns the first request of `shard` that may be run by a worker of
+ * another shard, or NULL. Slow I/O work is left to the owning shard so that
+ * its concurrency limit still holds. `*priority` is set to the class of the
+ * request. `shard->mutex` must be held.
+ */
+static QUEUE* stealable(struct uv__wq_shard* shard, unsigned int* priority) {
   QUEUE* q;
-  int is_slow_work;
 
-  uv_sem_post((uv_sem_t*) arg);
-  arg = NULL;
+  *priority = UV_WORK_PRIORITY_HIGH;
+  if (!QUEUE_EMPTY(&shard->high_wq))
+    return QUEUE_HEAD(&shard->high_wq);
 
-  uv_mutex_lock(&mutex);
-  for (;;) {
-    /* `mutex` should always be locked at this point. */
-
-    /* Keep waiting while either no work is present or only slow I/O
-       and we're at the threshold for that. */
-    while (QUEUE_EMPTY(&wq) ||
-           (QUEUE_HEAD(&wq) == &run_slow_work_message &&
-            QUEUE_NEXT(&run_slow_work_message) == &wq &&
-            slow_io_work_running >= slow_work_thread_threshold())) {
-      idle_threads += 1;
-      uv_cond_wait(&cond, &mutex);
-      idle_threads -= 1;
+  *priority = UV_WORK_PRIORITY_NORMAL;
+  QUEUE_FOREACH(q, &shard->wq) {
+    if (q == &shard->exit_message)
+      return NULL;
+    if (q != &shard->run_slow_work_message)
+      return q;
+  }
+
+  return NULL;
+}
+
+
+/* Take a work item from one of the other shards. Must be called without any
+ * shard lock held. Uses trylock so an idle worker never blocks on a foreign
+ * shard. `*start` is set to the time the item was taken.
+ */
+static QUEUE* steal(struct uv__wq_shard* home, uint64_t* start) {
+  struct uv__wq_shard* shard;
+  unsigned int priority;
+  unsigned int i;
+  QUEUE* q;
+
+  for (i = 1; i < nshards; i++) {
+    shard = &shards[(home - shards + i) % nshards];
+    if (uv_mutex_trylock(&shard->mutex))
+      continue;
+
+    q = stealable(shard, &priority);
+    if (q != NULL) {
+      QUEUE_REMOVE(q);
+      QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+      *start = work_started(shard, priority);
     }
 
-    q = QUEUE_HEAD(&wq);
-    if (q == &exit_message) {
-      uv_cond_signal(&cond);
-      uv_mutex_unlock(&mutex);
-      break;
+    uv_mutex_unlock(&shard->mutex);
+    if (q != NULL)
+      return q;
+  }
+
+  return NULL;
+}
+
+
+/* Wake up an idle worker in another shard because all workers of `home` are
+ * busy. Must be called without any shard lock held.
+ */
+static void wake_thief(struct uv__wq_shard* home) {
+  struct uv__wq_shard* shard;
+  unsigned int i;
+  int found;
+
+  for (i = 1; i < nshards; i++) {
+    shard = &shards[(home - shards + i) % nshards];
+    uv_mutex_lock(&shard->mutex);
+    found = shard->idle_threads > 0;
+    if (found) {
+      shard->steal_hint = 1;
+      uv_cond_signal(&shard->cond);
     }
+    uv_mutex_unlock(&shard->mutex);
+    if (found)
+      break;
+  }
+}
 
-    QUEUE_REMOVE(q);
-    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
 
+/* Hand a finished work request back to its loop. The request isn't linked
+ * into any queue until then, uv_cancel() considers it to be still running.
+ *
+ * Right after the work ran the worker only tries the lock. When the loop
+ * thread or another worker holds it, the worker keeps the one request while
+ * it picks up its next one and hands it back with a blocking lock before it
+ * runs that next one, or goes idle or exits. There is never more than one
+ * request held and it never waits for other work to run.
+ *
+ * The loop only needs to be woken up when its queue was empty: otherwise
+ * a wakeup is already pending and uv__work_done() hasn't run yet, and it
+ * will pick up this request as well.
+ *
+ * Returns NULL when the request was handed back, |w| otherwise.
+ */
+static struct uv__work* hand_back(struct uv__work* w, int force) {
+  uv_loop_t* loop;
+  int wakeup;
+
+  loop = w->loop;
+  if (force)
+    uv_mutex_lock(&loop->wq_mutex);
+  else if (uv_mutex_trylock(&loop->wq_mutex))
+    return w;
+
+  wakeup = QUEUE_EMPTY(&loop->wq);
+
+  w->work = NULL;  /* Signal uv_cancel() that the work req is done executing. */
+  QUEUE_INSERT_TAIL(&loop->wq, &w->wq);
+
+  if (wakeup)
+    uv_async_send(&loop->wq_async);
+  uv_mutex_unlock(&loop->wq_mutex);
+
+  return NULL;
+}
+
+
+static void worker(void* arg) {
+  struct uv__worker* self;
+  struct uv__wq_shard* shard;
+  struct uv__work* held;
+  struct uv__work* w;
+  unsigned int priority;
+  uint64_t start;
+  uint64_t run_time;
+  QUEUE* q;
+  int is_slow_work;
+  int timed_out;
+
+  self = arg;
+  shard = self->shard;
+  if (self->started != NULL)
+    uv_sem_post(self->started);
+  held = NULL;
+
+  uv_mutex_lock(&shard->mutex);
+  for (;;) {
+    /* `shard->mutex` should always be locked at this point. */
+    q = NULL;
     is_slow_work = 0;
-    if (q == &run_slow_work_message) {
-      /* If we're at the slow I/O threshold, re-schedule until after all
-         other work in the queue is done. */
-      if (slow_io_work_running >= slow_work_thread_threshold()) {
-        QUEUE_INSERT_TAIL(&wq, q);
+
+    /* The threadpool was shrunk. */
+    if (shard->nthreads > shard->max_threads)
+      goto retire;
+
+    while (!shard_has_work(shard)) {
+      if (held != NULL) {
+        /* Out of work, don't let the held request wait any longer. */
+        uv_mutex_unlock(&shard->mutex);
+        held = hand_back(held, 1);
+        uv_mutex_lock(&shard->mutex);
         continue;
       }
 
-      /* If we encountered a request to run slow I/O work but there is none
-         to run, that means it's cancelled => Start over. */
-      if (QUEUE_EMPTY(&slow_io_pending_wq))
-        continue;
+      if (nshards > 1) {
+        /* Look for work in the other shards before going to sleep. */
+        shard->steal_hint = 0;
+        uv_mutex_unlock(&shard->mutex);
+        q = steal(shard, &start);
+        if (q != NULL)
+          break;
+        uv_mutex_lock(&shard->mutex);
+        if (shard->steal_hint)
+          continue;
+        if (shard_has_work(shard))
+          break;
+      }
+      /* Going to sleep while slow I/O work is waiting for a thread. */
+      if (!QUEUE_EMPTY(&shard->slow_io_pending_wq))
+        shard->slow_io_throttled++;
+      timed_out = 0;
+      idle_update(shard, 1);
+      if (shard->idle_timeout != 0 && shard->nthreads > shard->min_threads)
+        timed_out = uv_cond_timedwait(&shard->cond,
+                                      &shard->mutex,
+                                      shard->idle_timeout) == UV_ETIMEDOUT;
+      else
+        uv_cond_wait(&shard->cond, &shard->mutex);
+      idle_update(shard, -1);
+
+      /* The threadpool was shrunk or this worker has been idle for too
+       * long. */
+      if (shard->nthreads > shard->max_threads)
+        goto retire;
+      if (timed_out &&
+          shard->nthreads > shard->min_threads &&
+          !shard_has_work(shard))
+        goto retire;
+    }
 
-      is_slow_work = 1;
-      slow_io_work_running++;
+    if (q == NULL) {
+      if (!QUEUE_EMPTY(&shard->high_wq)) {
+        q = QUEUE_HEAD(&shard->high_wq);
+        priority = UV_WORK_PRIORITY_HIGH;
+      } else {
+        q = QUEUE_HEAD(&shard->wq);
+        priority = UV_WORK_PRIORITY_NORMAL;
+        if (q == &shard->exit_message) {
+          uv_cond_signal(&shard->cond);
+          uv_mutex_unlock(&shard->mutex);
+          if (held != NULL)
+            hand_back(held, 1);
+          return;
+        }
+      }
 
-      q = QUEUE_HEAD(&slow_io_pending_wq);
       QUEUE_REMOVE(q);
-      QUEUE_INIT(q);
-
-      /* If there is more slow I/O work, schedule it to be run as well. */
-      if (!QUEUE_EMPTY(&slow_io_pending_wq)) {
-        QUEUE_INSERT_TAIL(&wq, &run_slow_work_message);
-        if (idle_threads > 0)
-          uv_cond_signal(&cond);
+      QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+
+      if (q == &shard->run_slow_work_message) {
+        /* If we're at the slow I/O threshold, re-schedule until after all
+           other work in the queue is done. */
+        if (shard->slow_io_work_running >= slow_work_thread_threshold(shard)) {
+          shard->slow_io_throttled++;
+          QUEUE_INSERT_TAIL(&shard->wq, q);
+          continue;
+        }
+
+        /* If we encountered a request to run slow I/O work but there is none
+           to run, that means it's cancelled => Start over. */
+        if (QUEUE_EMPTY(&shard->slow_io_pending_wq))
+          continue;
+
+        is_slow_work = 1;
+        shard->slow_io_work_running++;
+        priority = UV_WORK_PRIORITY_LOW;
+
+        q = QUEUE_HEAD(&shard->slow_io_pending_wq);
+        QUEUE_REMOVE(q);
+        QUEUE_INIT(q);
+
+        /* If there is more slow I/O work, schedule it to be run as well. */
+        if (!QUEUE_EMPTY(&shard->slow_io_pending_wq)) {
+          QUEUE_INSERT_TAIL(&shard->wq, &shard->run_slow_work_message);
+          if (shard->idle_threads > 0)
+            uv_cond_signal(&shard->cond);
+        }
       }
-    }
 
-    uv_mutex_unlock(&mutex);
+      start = work_started(shard, priority);
+      uv_mutex_unlock(&shard->mutex);
+    }
 
     w = QUEUE_DATA(q, struct uv__work, wq);
+
+    /* The previous request mustn't wait for this one to finish. */
+    if (held != NULL)
+      held = hand_back(held, 1);
+
     w->work(w);
+    run_time = uv_hrtime() - start;
 
-    uv_mutex_lock(&w->loop->wq_mutex);
-    w->work = NULL;  /* Signal uv_cancel() that the work req is done
-                        executing. */
-    QUEUE_INSERT_TAIL(&w->loop->wq, &w->wq);
-    uv_async_send(&w->loop->wq_async);
-    uv_mutex_unlock(&w->loop->wq_mutex);
+    held = hand_back(w, 0);
 
-    /* Lock `mutex` since that is expected at the start of the next
+    /* Lock `shard->mutex` since that is expected at the start of the next
      * iteration. */
-    uv_mutex_lock(&mutex);
+    uv_mutex_lock(&shard->mutex);
+    shard->completed++;
+    shard->run_time[histogram_bucket(run_time)]++;
     if (is_slow_work) {
-      /* `slow_io_work_running` is protected by `mutex`. */
-      slow_io_work_running--;
+      /* `slow_io_work_running` is protected by `shard->mutex`. */
+      shard->slow_io_work_running--;
+    }
+  }
+
+retire:
+  /* `shard->mutex` is locked. The thread is joined by whoever next reaps
+   * exited workers, see reap_workers(). */
+  shard->nthreads--;
+  uv_mutex_unlock(&shard->mutex);
+
+  if (held != NULL)
+    hand_back(held, 1);
+
+  uv_mutex_lock(&pool_mutex);
+  self->exited = 1;
+  nthreads--;
+  uv_mutex_unlock(&pool_mutex);
+}
+
+
+/* Join the workers that retired. `pool_mutex` must be held. */
+static void reap_workers(void) {
+  struct uv__worker* worker;
+  QUEUE* q;
+  QUEUE* next;
+
+  for (q = QUEUE_HEAD(&workers); q != &workers; q = next) {
+    next = QUEUE_NEXT(q);
+    worker = QUEUE_DATA(q, struct uv__worker, member);
+    if (!worker->exited)
+      continue;
+
+    if (uv_thread_join(&worker->thread))
+      abort();
+
+    QUEUE_REMOVE(q);
+    uv__free(worker);
+  }
+}
+
+
+/* Start a new worker in `shard`. `pool_mutex` must be held. */
+static int add_worker(struct uv__wq_shard* shard, uv_sem_t* started) {
+  uv_thread_options_t options;
+  struct uv__worker* self;
+  int err;
+
+  self = uv__malloc(sizeof(*self));
+  if (self == NULL)
+    return UV_ENOMEM;
+
+  self->shard = shard;
+  self->started = started;
+  self->exited = 0;
+
+  uv_mutex_lock(&shard->mutex);
+  shard->nthreads++;
+  uv_mutex_unlock(&shard->mutex);
+
+  err = UV_EINVAL;
+  if (shard->cpumask != NULL) {
+    options.flags = UV_THREAD_HAS_AFFINITY;
+    options.cpumask = shard->cpumask;
+    options.mask_size = cpumask_size;
+    err = uv_thread_create_ex(&self->thread, &options, worker, self);
+  }
+
+  /* Not pinned or the CPUs went offline, run wherever the OS likes. */
+  if (err)
+    err = uv_thread_create(&self->thread, worker, self);
+
+  if (err) {
+    uv_mutex_lock(&shard->mutex);
+    shard->nthreads--;
+    uv_mutex_unlock(&shard->mutex);
+    uv__free(self);
+    return err;
+  }
+
+  QUEUE_INSERT_TAIL(&workers, &self->member);
+  nthreads++;
+
+  return 0;
+}
+
+
+/* Returns how long the oldest request in `shard` has been waiting.
+ * `shard->mutex` must be held.
+ */
+static uint64_t oldest_wait(struct uv__wq_shard* shard, uint64_t now) {
+  struct uv__wq_times* t;
+  uint64_t oldest;
+  unsigned int i;
+
+  oldest = now;
+
+  for (i = 0; i < ARRAY_SIZE(shard->times); i++) {
+    t = &shard->times[i];
+    if (t->len != 0 && t->times[t->head] < oldest)
+      oldest = t->times[t->head];
+  }
+
+  return now - oldest;
+}
+
+
+/* Adds a worker to every shard whose workers are all busy while requests
+ * have been waiting for longer than `grow_threshold`, at most one per shard
+ * per `grow_threshold` interval.
+ */
+static void manager(void* arg) {
+  struct uv__wq_shard* shard;
+  unsigned int i;
+  uint64_t now;
+  int grow;
+
+  uv_mutex_lock(&pool_mutex);
+  while (manager_running) {
+    uv_cond_timedwait(&manager_cond, &pool_mutex, grow_threshold);
+    if (!manager_running)
+      break;
+
+    reap_workers();
+    now = uv_hrtime();
+
+    for (i = 0; i < nshards; i++) {
+      shard = &shards[i];
+      uv_mutex_lock(&shard->mutex);
+      grow = shard->idle_threads == 0 &&
+             shard->nthreads < shard->max_threads &&
+             oldest_wait(shard, now) >= grow_threshold;
+      uv_mutex_unlock(&shard->mutex);
+
+      if (grow)
+        add_worker(shard, NULL);
     }
   }
+  uv_mutex_unlock(&pool_mutex);
+}
+
+
+/* Stop the manager thread. `config_mutex` must be held. */
+static void stop_manager(void) {
+  int running;
+
+  uv_mutex_lock(&pool_mutex);
+  running = manager_running;
+  manager_running = 0;
+  uv_cond_signal(&manager_cond);
+  uv_mutex_unlock(&pool_mutex);
+
+  if (running)
+    if (uv_thread_join(&manager_thread))
+      abort();
+}
+
+
+/* Share of `n` threads for shard `i`, every shard gets at least one. */
+static unsigned int shard_share(unsigned int n, unsigned int i) {
+  n = n / nshards + (i < n % nshards);
+  return n > 0 ? n : 1;
+}
+
+
+static int configure(unsigned int min_threads,
+                     unsigned int max_threads,
+                     uint64_t threshold,
+                     uint64_t idle_timeout) {
+  struct uv__wq_shard* shard;
+  unsigned int missing;
+  unsigned int i;
+  int err;
+
+  uv_once(&once, init_once);
+
+  uv_mutex_lock(&config_mutex);
+  stop_manager();
+
+  uv_mutex_lock(&pool_mutex);
+  reap_workers();
+
+  err = 0;
+  for (i = 0; i < nshards; i++) {
+    shard = &shards[i];
+
+    uv_mutex_lock(&shard->mutex);
+    shard->min_threads = shard_share(min_threads, i);
+    shard->max_threads = shard_share(max_threads, i);
+    shard->idle_timeout = idle_timeout;
+    missing = 0;
+    if (shard->nthreads < shard->min_threads)
+      missing = shard->min_threads - shard->nthreads;
+    /* Let the idle workers pick up the new limits. */
+    uv_cond_broadcast(&shard->cond);
+    uv_mutex_unlock(&shard->mutex);
+
+    while (err == 0 && missing-- > 0)
+      err = add_worker(shard, NULL);
+  }
+
+  grow_threshold = threshold;
+  if (err == 0 && grow_threshold != 0) {
+    manager_running = 1;
+    err = uv_thread_create(&manager_thread, manager, NULL);
+    if (err)
+      manager_running = 0;
+  }
+
+  uv_mutex_unlock(&pool_mutex);
+  uv_mutex_unlock(&config_mutex);
+
+  return err;
 }
 
 
-static void post(QUEUE* q, enum uv__work_kind kind) {
-  uv_mutex_lock(&mutex);
+static void post(QUEUE* q, struct uv__wq_shard* shard, enum uv__work_kind kind) {
+  unsigned int priority;
+  uint64_t now;
+  int saturated;
+
+  priority = work_priority(kind);
+  now = uv_hrtime();
+
+  uv_mutex_lock(&shard->mutex);
+  shard->stats[priority].depth++;
+  shard->stats[priority].submitted++;
+  times_push(&shard->times[priority], now);
+
   if (kind == UV__WORK_SLOW_IO) {
     /* Insert into a separate queue. */
-    QUEUE_INSERT_TAIL(&slow_io_pending_wq, q);
-    if (!QUEUE_EMPTY(&run_slow_work_message)) {
+    QUEUE_INSERT_TAIL(&shard->slow_io_pending_wq, q);
+    if (!QUEUE_EMPTY(&shard->run_slow_work_message)) {
       /* Running slow I/O tasks is already scheduled => Nothing to do here.
          The worker that runs said other task will schedule this one as well. */
-      uv_mutex_unlock(&mutex);
+      uv_mutex_unlock(&shard->mutex);
       return;
     }
-    q = &run_slow_work_message;
+    q = &shard->run_slow_work_message;
+  }
+
+  if (kind == UV__WORK_LATENCY)
+    QUEUE_INSERT_TAIL(&shard->high_wq, q);
+  else
+    QUEUE_INSERT_TAIL(&shard->wq, q);
+
+  saturated = shard->idle_threads == 0;
+  if (!saturated)
+    uv_cond_signal(&shard->cond);
+  uv_mutex_unlock(&shard->mutex);
+
+  /* Slow I/O is not stolen, don't bother waking up other shards for it. */
+  if (saturated && nshards > 1 && kind != UV__WORK_SLOW_IO)
+    wake_thief(shard);
+}
+
+
+/* Returns the NUMA node the calling thread runs on, or -1 if unknown. */
+static int current_node(void) {
+#if defined(__linux__)
+  unsigned int i;
+  int cpu;
+
+  if (nnodes == 0)
+    return -1;
+
+  cpu = uv__getcpu();
+  if (cpu < 0 || (size_t) cpu >= cpumask_size)
+    return -1;
+
+  for (i = 0; i < nnodes; i++)
+    if (node_cpus[i * cpumask_size + cpu])
+      return i;
+#endif
+
+  return -1;
+}
+
+
+/* Returns the shard that `loop` submits its work to. Only called from the
+ * loop thread, which is the only one that reads or writes `wq_shard`.
+ *
+ * With UV_THREADPOOL_NUMA the loop gets a shard of the NUMA node it is
+ * running on when it first uses the threadpool.
+ */
+static struct uv__wq_shard* loop_shard(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  unsigned int i;
+  unsigned int n;
+  int node;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->wq_shard == 0) {
+    node = current_node();
+    uv_mutex_lock(&shards[0].mutex);
+    for (i = 0; i < nshards; i++) {
+      n = next_shard++ % nshards;
+      if (node == -1 || shards[n].node == node)
+        break;
+    }
+    lfields->wq_shard = 1 + n;
+    uv_mutex_unlock(&shards[0].mutex);
   }
 
-  QUEUE_INSERT_TAIL(&wq, q);
-  if (idle_threads > 0)
-    uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+  /* The threadpool is re-initialized after fork() and can end up with fewer
+   * shards when UV_THREADPOOL_SIZE was changed in between. */
+  return &shards[(lfields->wq_shard - 1) % nshards];
 }
 
 
@@ -165,70 +861,311 @@ static void post(QUEUE* q, enum uv__work_kind kind) {
 __attribute__((destructor))
 #endif
 void uv__threadpool_cleanup(void) {
+  struct uv__wq_shard* shard;
+  struct uv__worker* worker;
   unsigned int i;
+  unsigned int j;
+  QUEUE* q;
+  QUEUE all;
 
   if (nthreads == 0)
     return;
 
+  uv_mutex_lock(&config_mutex);
+  stop_manager();
+  uv_mutex_unlock(&config_mutex);
+
 #ifndef __MVS__
   /* TODO(gabylb) - zos: revisit when Woz compiler is available. */
-  post(&exit_message, UV__WORK_CPU);
+  for (i = 0; i < nshards; i++) {
+    shard = &shards[i];
+    uv_mutex_lock(&shard->mutex);
+    QUEUE_INSERT_TAIL(&shard->wq, &shard->exit_message);
+    uv_cond_signal(&shard->cond);
+    uv_mutex_unlock(&shard->mutex);
+  }
 #endif
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
+  /* Retiring workers take `pool_mutex`, don't hold it while joining. */
+  uv_mutex_lock(&pool_mutex);
+  QUEUE_MOVE(&workers, &all);
+  uv_mutex_unlock(&pool_mutex);
+
+  while (!QUEUE_EMPTY(&all)) {
+    q = QUEUE_HEAD(&all);
+    QUEUE_REMOVE(q);
+    worker = QUEUE_DATA(q, struct uv__worker, member);
+    if (uv_thread_join(&worker->thread))
       abort();
+    uv__free(worker);
+  }
 
-  if (threads != default_threads)
-    uv__free(threads);
+  for (i = 0; i < nshards; i++) {
+    uv_mutex_destroy(&shards[i].mutex);
+    uv_cond_destroy(&shards[i].cond);
+    uv__free(shards[i].cpumask);
+    for (j = 0; j < ARRAY_SIZE(shards[i].times); j++)
+      uv__free(shards[i].times[j].times);
+  }
+
+  uv__free(pool_cpus);
+  uv__free(node_cpus);
+  pool_cpus = NULL;
+  node_cpus = NULL;
+  nnodes = 0;
+
+  if (shards != default_shards)
+    uv__free(shards);
 
-  uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
+  uv_cond_destroy(&manager_cond);
+  uv_mutex_destroy(&pool_mutex);
+  uv_mutex_destroy(&config_mutex);
 
-  threads = NULL;
   nthreads = 0;
+  shards = NULL;
+  nshards = 0;
+}
+
+
+/* Parses a CPU list like "0-3,8,10-11" into `mask`. */
+static int parse_cpulist(const char* s, char* mask, size_t size) {
+  unsigned long first;
+  unsigned long last;
+  char* end;
+
+  memset(mask, 0, size);
+
+  for (;;) {
+    first = strtoul(s, &end, 10);
+    if (end == s)
+      return UV_EINVAL;
+
+    last = first;
+    s = end;
+    if (*s == '-') {
+      last = strtoul(s + 1, &end, 10);
+      if (end == s + 1 || last < first)
+        return UV_EINVAL;
+      s = end;
+    }
+
+    if (last >= size)
+      return UV_EINVAL;
+
+    memset(mask + first, 1, last - first + 1);
+
+    if (*s != ',')
+      break;
+    s++;
+  }
+
+  /* sysfs files end in a newline. */
+  while (*s == '\n' || *s == ' ')
+    s++;
+
+  return *s == '\0' ? 0 : UV_EINVAL;
+}
+
+
+/* Reads UV_THREADPOOL_CPUS, a list of CPUs to pin the workers to, and
+ * UV_THREADPOOL_NUMA, which asks for at least one shard per NUMA node with
+ * its workers pinned to that node.
+ */
+static void init_affinity(void) {
+#if defined(__linux__)
+  char buf[4096];
+  char file[32];
+  char* online;
+  unsigned int i;
+#endif
+  const char* val;
+  int n;
+
+  /* Don't look at the state from before fork(). */
+  pool_cpus = NULL;
+  node_cpus = NULL;
+  nnodes = 0;
+
+  n = uv_cpumask_size();
+  if (n <= 0)
+    return;
+
+  cpumask_size = n;
+
+  val = getenv("UV_THREADPOOL_CPUS");
+  if (val != NULL) {
+    pool_cpus = uv__malloc(cpumask_size);
+    if (pool_cpus != NULL && parse_cpulist(val, pool_cpus, cpumask_size)) {
+      uv__free(pool_cpus);
+      pool_cpus = NULL;
+    }
+  }
+
+#if defined(__linux__)
+  val = getenv("UV_THREADPOOL_NUMA");
+  if (val == NULL || atoi(val) <= 0)
+    return;
+
+  if (uv__numa_read("online", buf, sizeof(buf)))
+    return;
+
+  online = uv__malloc(cpumask_size);
+  if (online == NULL)
+    return;
+
+  if (parse_cpulist(buf, online, cpumask_size))
+    goto out;
+
+  n = 0;
+  for (i = 0; i < cpumask_size; i++)
+    n += online[i];
+
+  node_cpus = uv__malloc(n * cpumask_size);
+  if (node_cpus == NULL)
+    goto out;
+
+  for (i = 0; i < cpumask_size; i++) {
+    if (!online[i])
+      continue;
+
+    /* Nodes without CPUs fail to parse and are skipped. */
+    snprintf(file, sizeof(file), "node%u/cpulist", i);
+    if (uv__numa_read(file, buf, sizeof(buf)) == 0 &&
+        parse_cpulist(buf, node_cpus + nnodes * cpumask_size, cpumask_size) == 0)
+      nnodes++;
+  }
+
+  /* Nothing to gain on a single node. */
+  if (nnodes < 2) {
+    uv__free(node_cpus);
+    node_cpus = NULL;
+    nnodes = 0;
+  }
+
+out:
+  uv__free(online);
+#endif
+}
+
+
+/* Returns the CPUs the workers of a shard on NUMA node `node` run on, or NULL
+ * when they aren't pinned.
+ */
+static char* shard_cpumask(int node) {
+  char* mask;
+  size_t i;
+  int n;
+
+  if (node == -1 && pool_cpus == NULL)
+    return NULL;
+
+  mask = uv__malloc(cpumask_size);
+  if (mask == NULL)
+    return NULL;
+
+  n = 0;
+  for (i = 0; i < cpumask_size; i++) {
+    mask[i] = (node == -1 || node_cpus[node * cpumask_size + i]) &&
+              (pool_cpus == NULL || pool_cpus[i]);
+    n += mask[i];
+  }
+
+  /* UV_THREADPOOL_CPUS excludes the whole node, use it as is. */
+  if (n == 0 && pool_cpus != NULL)
+    memcpy(mask, pool_cpus, cpumask_size);
+
+  return mask;
 }
 
 
 static void init_threads(void) {
+  struct uv__wq_shard* shard;
+  unsigned int size;
   unsigned int i;
+  unsigned int j;
   const char* val;
   uv_sem_t sem;
 
-  nthreads = ARRAY_SIZE(default_threads);
+  size = DEFAULT_THREADPOOL_SIZE;
   val = getenv("UV_THREADPOOL_SIZE");
   if (val != NULL)
-    nthreads = atoi(val);
-  if (nthreads == 0)
-    nthreads = 1;
-  if (nthreads > MAX_THREADPOOL_SIZE)
-    nthreads = MAX_THREADPOOL_SIZE;
-
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = uv__malloc(nthreads * sizeof(threads[0]));
-    if (threads == NULL) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
-    }
-  }
+    size = atoi(val);
+  if (size == 0)
+    size = 1;
+  if (size > MAX_THREADPOOL_SIZE)
+    size = MAX_THREADPOOL_SIZE;
 
-  if (uv_cond_init(&cond))
+  if (uv_mutex_init(&config_mutex))
     abort();
 
-  if (uv_mutex_init(&mutex))
+  if (uv_mutex_init(&pool_mutex))
     abort();
 
-  QUEUE_INIT(&wq);
-  QUEUE_INIT(&slow_io_pending_wq);
-  QUEUE_INIT(&run_slow_work_message);
+  if (uv_cond_init(&manager_cond))
+    abort();
+
+  QUEUE_INIT(&workers);
+  nthreads = 0;
+  manager_running = 0;
+  grow_threshold = 0;
+
+  init_affinity();
+
+  nshards = (size + THREADS_PER_SHARD - 1) / THREADS_PER_SHARD;
+  /* The same number of shards for every NUMA node. */
+  if (nnodes > 0)
+    nshards = (nshards + nnodes - 1) / nnodes * nnodes;
+
+  shards = default_shards;
+  if (nshards > ARRAY_SIZE(default_shards)) {
+    shards = uv__calloc(nshards, sizeof(shards[0]));
+    if (shards == NULL) {
+      nshards = ARRAY_SIZE(default_shards);
+      shards = default_shards;
+    }
+  }
+
+  for (i = 0; i < nshards; i++) {
+    shard = &shards[i];
+
+    if (uv_cond_init(&shard->cond))
+      abort();
+
+    if (uv_mutex_init(&shard->mutex))
+      abort();
+
+    shard->idle_threads = 0;
+    shard->slow_io_work_running = 0;
+    shard->nthreads = 0;
+    shard->min_threads = shard_share(size, i);
+    shard->max_threads = shard->min_threads;
+    shard->idle_timeout = 0;
+    shard->node = nnodes > 0 ? (int) (i % nnodes) : -1;
+    shard->cpumask = shard_cpumask(shard->node);
+    shard->steal_hint = 0;
+    memset(shard->stats, 0, sizeof(shard->stats));
+    memset(shard->times, 0, sizeof(shard->times));
+    shard->completed = 0;
+    shard->slow_io_throttled = 0;
+    shard->idle_time = 0;
+    shard->idle_mark = uv_hrtime();
+    memset(shard->wait_time, 0, sizeof(shard->wait_time));
+    memset(shard->run_time, 0, sizeof(shard->run_time));
+    QUEUE_INIT(&shard->high_wq);
+    QUEUE_INIT(&shard->wq);
+    QUEUE_INIT(&shard->slow_io_pending_wq);
+    QUEUE_INIT(&shard->run_slow_work_message);
+  }
 
   if (uv_sem_init(&sem, 0))
     abort();
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, &sem))
-      abort();
+  uv_mutex_lock(&pool_mutex);
+  for (i = 0; i < nshards; i++)
+    for (j = 0; j < shards[i].min_threads; j++)
+      if (add_worker(&shards[i], &sem))
+        abort();
+  uv_mutex_unlock(&pool_mutex);
 
   for (i = 0; i < nthreads; i++)
     uv_sem_wait(&sem);
@@ -248,8 +1185,8 @@ static void reset_once(void) {
 static void init_once(void) {
 #ifndef _WIN32
   /* Re-initialize the threadpool after fork.
-   * Note that this discards the global mutex and condition as well
-   * as the work queue.
+   * Note that this discards the shard mutexes and conditions as well
+   * as the work queues.
    */
   if (pthread_atfork(NULL, NULL, &reset_once))
     abort();
@@ -267,22 +1204,36 @@ void uv__work_submit(uv_loop_t* loop,
   w->loop = loop;
   w->work = work;
   w->done = done;
-  post(&w->wq, kind);
+  post(&w->wq, loop_shard(loop), kind);
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  struct uv__wq_shard* shard;
+  unsigned int priority;
+  unsigned int index;
   int cancelled;
 
-  uv_mutex_lock(&mutex);
+  /* Work is only ever queued in the shard of the loop that submitted it. A
+   * loop without a shard never used the threadpool, e.g. when its requests
+   * went through io_uring. */
+  if (uv__get_internal_fields(w->loop)->wq_shard == 0)
+    return UV_EBUSY;
+
+  shard = loop_shard(w->loop);
+  uv_mutex_lock(&shard->mutex);
   uv_mutex_lock(&w->loop->wq_mutex);
 
   cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
-  if (cancelled)
+  if (cancelled) {
+    priority = queue_position(shard, &w->wq, &index);
+    times_remove(&shard->times[priority], index);
+    shard->stats[priority].depth--;
     QUEUE_REMOVE(&w->wq);
+  }
 
   uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
+  uv_mutex_unlock(&shard->mutex);
 
   if (!cancelled)
     return UV_EBUSY;
@@ -344,6 +1295,35 @@ int uv_queue_work(uv_loop_t* loop,
                   uv_work_t* req,
                   uv_work_cb work_cb,
                   uv_after_work_cb after_work_cb) {
+  return uv_queue_work_ex(loop,
+                          req,
+                          UV_WORK_PRIORITY_NORMAL,
+                          work_cb,
+                          after_work_cb);
+}
+
+
+int uv_queue_work_ex(uv_loop_t* loop,
+                     uv_work_t* req,
+                     uv_work_priority_t priority,
+                     uv_work_cb work_cb,
+                     uv_after_work_cb after_work_cb) {
+  enum uv__work_kind kind;
+
+  switch (priority) {
+    case UV_WORK_PRIORITY_HIGH:
+      kind = UV__WORK_LATENCY;
+      break;
+    case UV_WORK_PRIORITY_NORMAL:
+      kind = UV__WORK_CPU;
+      break;
+    case UV_WORK_PRIORITY_LOW:
+      kind = UV__WORK_SLOW_IO;
+      break;
+    default:
+      return UV_EINVAL;
+  }
+
   if (work_cb == NULL)
     return UV_EINVAL;
 
@@ -353,13 +1333,111 @@ int uv_queue_work(uv_loop_t* loop,
   req->after_work_cb = after_work_cb;
   uv__work_submit(loop,
                   &req->work_req,
-                  UV__WORK_CPU,
+                  kind,
                   uv__queue_work,
                   uv__queue_done);
   return 0;
 }
 
 
+int uv_threadpool_resize(unsigned int size) {
+  if (size == 0 || size > MAX_THREADPOOL_SIZE)
+    return UV_EINVAL;
+
+  return configure(size, size, 0, 0);
+}
+
+
+int uv_threadpool_autoscale(unsigned int min_threads,
+                            unsigned int max_threads,
+                            uint64_t wait_threshold,
+                            uint64_t idle_timeout) {
+  if (max_threads == 0 ||
+      max_threads > MAX_THREADPOOL_SIZE ||
+      min_threads > max_threads)
+    return UV_EINVAL;
+
+  return configure(min_threads,
+                   max_threads,
+                   wait_threshold * 1000000,
+                   idle_timeout * 1000000);
+}
+
+
+unsigned int uv_threadpool_size(void) {
+  unsigned int n;
+
+  uv_once(&once, init_once);
+  uv_mutex_lock(&pool_mutex);
+  n = nthreads;
+  uv_mutex_unlock(&pool_mutex);
+
+  return n;
+}
+
+
+int uv_work_queue_stats(uv_work_priority_t priority,
+                        uv_work_queue_stats_t* stats) {
+  uv_work_queue_stats_t* s;
+  unsigned int i;
+
+  if ((unsigned int) priority > UV_WORK_PRIORITY_LOW || stats == NULL)
+    return UV_EINVAL;
+
+  uv_once(&once, init_once);
+  memset(stats, 0, sizeof(*stats));
+
+  for (i = 0; i < nshards; i++) {
+    uv_mutex_lock(&shards[i].mutex);
+    s = &shards[i].stats[priority];
+    stats->depth += s->depth;
+    stats->submitted += s->submitted;
+    stats->started += s->started;
+    stats->wait_time += s->wait_time;
+    if (s->max_wait_time > stats->max_wait_time)
+      stats->max_wait_time = s->max_wait_time;
+    uv_mutex_unlock(&shards[i].mutex);
+  }
+
+  return 0;
+}
+
+
+int uv_threadpool_metrics(uv_threadpool_metrics_t* metrics) {
+  struct uv__wq_shard* shard;
+  unsigned int i;
+  unsigned int j;
+  uint64_t now;
+
+  if (metrics == NULL)
+    return UV_EINVAL;
+
+  uv_once(&once, init_once);
+  memset(metrics, 0, sizeof(*metrics));
+
+  for (i = 0; i < nshards; i++) {
+    shard = &shards[i];
+    uv_mutex_lock(&shard->mutex);
+    now = uv_hrtime();
+    metrics->threads += shard->nthreads;
+    metrics->idle_threads += shard->idle_threads;
+    for (j = 0; j < ARRAY_SIZE(shard->stats); j++)
+      metrics->queue_depth += shard->stats[j].depth;
+    metrics->completed += shard->completed;
+    metrics->idle_time += shard->idle_time +
+                          shard->idle_threads * (now - shard->idle_mark);
+    metrics->slow_io_throttled += shard->slow_io_throttled;
+    for (j = 0; j < UV_THREADPOOL_HISTOGRAM_SIZE; j++) {
+      metrics->wait_time[j] += shard->wait_time[j];
+      metrics->run_time[j] += shard->run_time[j];
+    }
+    uv_mutex_unlock(&shard->mutex);
+  }
+
+  return 0;
+}
+
+
 int uv_cancel(uv_req_t* req) {
   struct uv__work* wreq;
   uv_loop_t* loop;
@@ -368,6 +1446,11 @@ int uv_cancel(uv_req_t* req) {
   case UV_FS:
     loop =  ((uv_fs_t*) req)->loop;
     wreq = &((uv_fs_t*) req)->work_req;
+#if defined(__linux__)
+    /* Posted to the io_uring, see uv__iou_fs_post(). */
+    if (wreq->work == NULL && wreq->done == NULL)
+      return uv__iou_fs_cancel(loop, (uv_fs_t*) req);
+#endif
     break;
   case UV_GETADDRINFO:
     loop =  ((uv_getaddrinfo_t*) req)->loop;
@@ -24,6 +24,36 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <string.h>
+
+/* Loops configured with UV_LOOP_USE_TIMER_WHEEL keep their timers in a
+ * hierarchical timing wheel instead of the heap. Level 0 has one slot per
+ * millisecond, every level above is WHEEL_SLOTS times coarser. A timer goes
+ * into the level that covers its distance to `time` and moves down a level
+ * ("cascades") when the wheel reaches the start of its slot. Starting and
+ * stopping a timer is O(1) and a timer is touched at most WHEEL_LEVELS times
+ * before it expires, no matter how many other timers there are.
+ *
+ * Timers further out than the wheel reaches (about two years) wait in `far`
+ * and are reinserted whenever the top level moves on to its next slot.
+ *
+ * A level 0 slot only holds timers with the same timeout. Its timers are
+ * kept in start_id order so they fire in the same order as with the heap.
+ *
+ * The timer's `heap_node` field holds the queue links and the slot.
+ */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 6
+#define WHEEL_TOP_SHIFT (WHEEL_BITS * (WHEEL_LEVELS - 1))
+
+struct uv__timer_wheel {
+  uint64_t time;  /* Next millisecond to expire. */
+  uint64_t occupied[WHEEL_LEVELS];  /* Bitmaps of the non-empty slots. */
+  QUEUE ready;  /* Timers that were already due when they were started. */
+  QUEUE far;
+  QUEUE slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
 
 
 static struct heap *timer_heap(const uv_loop_t* loop) {
@@ -35,6 +65,11 @@ static struct heap *timer_heap(const uv_loop_t* loop) {
 }
 
 
+static struct uv__timer_wheel* timer_wheel(const uv_loop_t* loop) {
+  return uv__get_internal_fields(loop)->timer_wheel;
+}
+
+
 static int timer_less_than(const struct heap_node* ha,
                            const struct heap_node* hb) {
   const uv_timer_t* a;
@@ -49,25 +84,293 @@ static int timer_less_than(const struct heap_node* ha,
     return 0;
 
   /* Compare start_id when both have the same timeout. start_id is
-   * allocated with loop->timer_counter in uv_timer_start().
+   * allocated with loop->timer_counter in uv_timer_start_ex().
    */
   return a->start_id < b->start_id;
 }
 
 
+static void wheel_insert(struct uv__timer_wheel* w, uv_timer_t* handle) {
+  unsigned int level;
+  unsigned int index;
+  uint64_t delta;
+  QUEUE* slot;
+  QUEUE* q;
+
+  if (handle->timeout < w->time) {
+    slot = &w->ready;
+  } else {
+    delta = handle->timeout - w->time;
+    for (level = 0; level < WHEEL_LEVELS; level++)
+      if ((delta >> (WHEEL_BITS * (level + 1))) == 0)
+        break;
+
+    if (level == WHEEL_LEVELS) {
+      slot = &w->far;
+    } else {
+      index = (handle->timeout >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+      slot = &w->slots[level][index];
+      w->occupied[level] |= (uint64_t) 1 << index;
+    }
+  }
+
+  /* Newly started timers have the highest start_id and go last, only
+   * cascading timers may have to be placed before others. */
+  q = QUEUE_PREV(slot);
+  while (q != slot &&
+         QUEUE_DATA(q, uv_timer_t, heap_node)->start_id > handle->start_id)
+    q = QUEUE_PREV(q);
+
+  QUEUE_INSERT_HEAD(q, (QUEUE*) &handle->heap_node);
+  handle->heap_node[2] = slot;
+}
+
+
+static void wheel_remove(struct uv__timer_wheel* w, uv_timer_t* handle) {
+  QUEUE* slot;
+  size_t n;
+
+  slot = handle->heap_node[2];
+  QUEUE_REMOVE((QUEUE*) &handle->heap_node);
+
+  if (QUEUE_EMPTY(slot) && slot != &w->ready && slot != &w->far) {
+    n = slot - &w->slots[0][0];
+    w->occupied[n / WHEEL_SLOTS] &= ~((uint64_t) 1 << (n % WHEEL_SLOTS));
+  }
+}
+
+
+/* Returns the next millisecond at which the wheel has work to do, either
+ * because a level 0 slot expires or because a slot of a higher level
+ * cascades. Returns UINT64_MAX when the wheel is empty.
+ */
+static uint64_t wheel_next(const struct uv__timer_wheel* w) {
+  unsigned int level;
+  unsigned int shift;
+  unsigned int i;
+  uint64_t block;
+  uint64_t mask;
+  uint64_t next;
+  uint64_t when;
+
+  next = (uint64_t) -1;
+
+  for (level = 0; level < WHEEL_LEVELS; level++) {
+    if (w->occupied[level] == 0)
+      continue;
+
+    /* The slot of the current block has already cascaded unless the wheel
+     * is exactly at its start. */
+    shift = WHEEL_BITS * level;
+    mask = ((uint64_t) 1 << shift) - 1;
+    block = (w->time + mask) >> shift;
+
+    for (i = 0; i < WHEEL_SLOTS; i++)
+      if (w->occupied[level] & ((uint64_t) 1 << ((block + i) % WHEEL_SLOTS)))
+        break;
+
+    when = (block + i) << shift;
+    if (when < next)
+      next = when;
+  }
+
+  if (!QUEUE_EMPTY(&w->far)) {
+    mask = ((uint64_t) 1 << WHEEL_TOP_SHIFT) - 1;
+    when = (w->time + mask) & ~mask;
+    if (when < next)
+      next = when;
+  }
+
+  return next;
+}
+
+
+static void wheel_reinsert(struct uv__timer_wheel* w, QUEUE* slot) {
+  QUEUE queue;
+  QUEUE* q;
+
+  QUEUE_MOVE(slot, &queue);
+  while (!QUEUE_EMPTY(&queue)) {
+    q = QUEUE_HEAD(&queue);
+    QUEUE_REMOVE(q);
+    wheel_insert(w, QUEUE_DATA(q, uv_timer_t, heap_node));
+  }
+}
+
+
+/* Moves the timers of the slots that start at `w->time` down the wheel. */
+static void wheel_cascade(struct uv__timer_wheel* w) {
+  unsigned int level;
+  unsigned int index;
+  unsigned int shift;
+
+  if ((w->time & (((uint64_t) 1 << WHEEL_TOP_SHIFT) - 1)) == 0)
+    wheel_reinsert(w, &w->far);
+
+  for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+    shift = WHEEL_BITS * level;
+    if ((w->time & (((uint64_t) 1 << shift) - 1)) != 0)
+      continue;
+
+    index = (w->time >> shift) & (WHEEL_SLOTS - 1);
+    if ((w->occupied[level] & ((uint64_t) 1 << index)) == 0)
+      continue;
+
+    w->occupied[level] &= ~((uint64_t) 1 << index);
+    wheel_reinsert(w, &w->slots[level][index]);
+  }
+}
+
+
+static void timer_expire(uv_timer_t* handle) {
+  uv_loop_t* loop;
+  uint64_t start;
+
+  loop = handle->loop;
+  uv_timer_stop(handle);
+  uv_timer_again(handle);
+  uv__metrics_inc_callbacks(loop, 1);
+  start = uv__slow_cb_start(loop);
+  handle->timer_cb(handle);
+  uv__slow_cb_end(loop, start, UV_METRICS_PHASE_TIMERS, UV_TIMER, -1);
+}
+
+
+static void wheel_run(uv_loop_t* loop, struct uv__timer_wheel* w) {
+  uint64_t next;
+  QUEUE* slot;
+
+  while (!QUEUE_EMPTY(&w->ready))
+    timer_expire(QUEUE_DATA(QUEUE_HEAD(&w->ready), uv_timer_t, heap_node));
+
+  /* Expire one millisecond at a time but skip the ones without work. Timers
+   * started by the callbacks for the current millisecond end up in the same
+   * slot and run as well, just like with the heap. */
+  for (;;) {
+    next = wheel_next(w);
+    if (next > loop->time)
+      break;
+
+    w->time = next;
+    wheel_cascade(w);
+
+    slot = &w->slots[0][next % WHEEL_SLOTS];
+    while (!QUEUE_EMPTY(slot))
+      timer_expire(QUEUE_DATA(QUEUE_HEAD(slot), uv_timer_t, heap_node));
+
+    w->time = next + 1;
+  }
+
+  if (w->time <= loop->time)
+    w->time = loop->time + 1;
+}
+
+
+int uv__timer_wheel_init(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__timer_wheel* w;
+  unsigned int level;
+  unsigned int i;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->timer_wheel != NULL)
+    return 0;
+
+  /* Timers can't be moved over from the heap. */
+  if (heap_min(timer_heap(loop)) != NULL)
+    return UV_EBUSY;
+
+  w = uv__malloc(sizeof(*w));
+  if (w == NULL)
+    return UV_ENOMEM;
+
+  w->time = loop->time;
+  QUEUE_INIT(&w->ready);
+  QUEUE_INIT(&w->far);
+  for (level = 0; level < WHEEL_LEVELS; level++) {
+    w->occupied[level] = 0;
+    for (i = 0; i < WHEEL_SLOTS; i++)
+      QUEUE_INIT(&w->slots[level][i]);
+  }
+
+  lfields->timer_wheel = w;
+  return 0;
+}
+
+
+void uv__timer_wheel_delete(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  uv__free(lfields->timer_wheel);
+  lfields->timer_wheel = NULL;
+}
+
+
+/* The slack of uv_timer_start_ex() is kept in the handle's u.reserved[],
+ * timers don't use it otherwise and uv_timer_t keeps its size.
+ */
+STATIC_ASSERT(sizeof(((uv_handle_t*) 0)->u.reserved) >= sizeof(uint64_t));
+
+static uint64_t timer_slack(const uv_timer_t* handle) {
+  uint64_t slack;
+
+  memcpy(&slack, handle->u.reserved, sizeof(slack));
+  return slack;
+}
+
+
+static void timer_set_slack(uv_timer_t* handle, uint64_t slack) {
+  memcpy(handle->u.reserved, &slack, sizeof(slack));
+}
+
+
 int uv_timer_init(uv_loop_t* loop, uv_timer_t* handle) {
   uv__handle_init(loop, (uv_handle_t*)handle, UV_TIMER);
   handle->timer_cb = NULL;
   handle->timeout = 0;
   handle->repeat = 0;
+  timer_set_slack(handle, 0);
   return 0;
 }
 
 
+/* Rounds `timeout` up to a multiple of the largest power of two that is not
+ * larger than `slack`. Timers with nearby deadlines then share the same
+ * timeout and expire in the same loop iteration.
+ */
+static uint64_t timer_coalesce(uint64_t timeout, uint64_t slack) {
+  uint64_t granularity;
+  uint64_t rounded;
+
+  if (slack == 0)
+    return timeout;
+
+  granularity = 1;
+  while (granularity <= slack / 2)
+    granularity <<= 1;
+
+  rounded = (timeout + granularity - 1) & ~(granularity - 1);
+  if (rounded < timeout)
+    return timeout;
+
+  return rounded;
+}
+
+
 int uv_timer_start(uv_timer_t* handle,
                    uv_timer_cb cb,
                    uint64_t timeout,
                    uint64_t repeat) {
+  return uv_timer_start_ex(handle, cb, timeout, repeat, 0);
+}
+
+
+int uv_timer_start_ex(uv_timer_t* handle,
+                      uv_timer_cb cb,
+                      uint64_t timeout,
+                      uint64_t repeat,
+                      uint64_t slack) {
   uint64_t clamped_timeout;
 
   if (uv__is_closing(handle) || cb == NULL)
@@ -81,14 +384,18 @@ int uv_timer_start(uv_timer_t* handle,
     clamped_timeout = (uint64_t) -1;
 
   handle->timer_cb = cb;
-  handle->timeout = clamped_timeout;
+  handle->timeout = timer_coalesce(clamped_timeout, slack);
   handle->repeat = repeat;
+  timer_set_slack(handle, slack);
   /* start_id is the second index to be compared in timer_less_than() */
   handle->start_id = handle->loop->timer_counter++;
 
-  heap_insert(timer_heap(handle->loop),
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (timer_wheel(handle->loop) != NULL)
+    wheel_insert(timer_wheel(handle->loop), handle);
+  else
+    heap_insert(timer_heap(handle->loop),
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_start(handle);
 
   return 0;
@@ -99,9 +406,12 @@ int uv_timer_stop(uv_timer_t* handle) {
   if (!uv__is_active(handle))
     return 0;
 
-  heap_remove(timer_heap(handle->loop),
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (timer_wheel(handle->loop) != NULL)
+    wheel_remove(timer_wheel(handle->loop), handle);
+  else
+    heap_remove(timer_heap(handle->loop),
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_stop(handle);
 
   return 0;
@@ -114,7 +424,11 @@ int uv_timer_again(uv_timer_t* handle) {
 
   if (handle->repeat) {
     uv_timer_stop(handle);
-    uv_timer_start(handle, handle->timer_cb, handle->repeat, handle->repeat);
+    uv_timer_start_ex(handle,
+                      handle->timer_cb,
+                      handle->repeat,
+                      handle->repeat,
+                      timer_slack(handle));
   }
 
   return 0;
@@ -141,18 +455,34 @@ uint64_t uv_timer_get_due_in(const uv_timer_t* handle) {
 
 int uv__next_timeout(const uv_loop_t* loop) {
   const struct heap_node* heap_node;
+  const struct uv__timer_wheel* w;
   const uv_timer_t* handle;
+  uint64_t timeout;
   uint64_t diff;
 
-  heap_node = heap_min(timer_heap(loop));
-  if (heap_node == NULL)
-    return -1; /* block indefinitely */
+  w = timer_wheel(loop);
+  if (w != NULL) {
+    if (!QUEUE_EMPTY(&w->ready))
+      return 0;
+
+    /* This can be the time of a cascade rather than that of an actual
+     * timeout, the loop then wakes up early once per level. */
+    timeout = wheel_next(w);
+    if (timeout == (uint64_t) -1)
+      return -1; /* block indefinitely */
+  } else {
+    heap_node = heap_min(timer_heap(loop));
+    if (heap_node == NULL)
+      return -1; /* block indefinitely */
+
+    handle = container_of(heap_node, uv_timer_t, heap_node);
+    timeout = handle->timeout;
+  }
 
-  handle = container_of(heap_node, uv_timer_t, heap_node);
-  if (handle->timeout <= loop->time)
+  if (timeout <= loop->time)
     return 0;
 
-  diff = handle->timeout - loop->time;
+  diff = timeout - loop->time;
   if (diff > INT_MAX)
     diff = INT_MAX;
 
@@ -164,6 +494,11 @@ void uv__run_timers(uv_loop_t* loop) {
   struct heap_node* heap_node;
   uv_timer_t* handle;
 
+  if (timer_wheel(loop) != NULL) {
+    wheel_run(loop, timer_wheel(loop));
+    return;
+  }
+
   for (;;) {
     heap_node = heap_min(timer_heap(loop));
     if (heap_node == NULL)
@@ -173,9 +508,7 @@ void uv__run_timers(uv_loop_t* loop) {
     if (handle->timeout > loop->time)
       break;
 
-    uv_timer_stop(handle);
-    uv_timer_again(handle);
-    handle->timer_cb(handle);
+    timer_expire(handle);
   }
 }
 
@@ -162,7 +162,6 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     w = QUEUE_DATA(q, uv__io_t, watcher_queue);
     assert(w->pevents != 0);
     assert(w->fd >= 0);
-    assert(w->fd < (int) loop->nwatchers);
 
     pc.events = w->pevents;
     pc.fd = w->fd;
@@ -294,9 +293,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
 
       assert(pc.fd >= 0);
-      assert((unsigned) pc.fd < loop->nwatchers);
 
-      w = loop->watchers[pc.fd];
+      w = uv__watcher_get(loop, pc.fd);
 
       if (w == NULL) {
         /* File descriptor that we've stopped watching, disarm it.
@@ -315,12 +313,14 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         have_signals = 1;
       } else {
         uv__metrics_update_idle_time(loop);
-        w->cb(loop, w, pe->revents);
+        uv__io_dispatch(loop, w, pe->revents, UV_METRICS_PHASE_POLL);
       }
 
       nevents++;
     }
 
+    uv__metrics_inc_events(loop, nevents);
+
     if (reset_timeout != 0) {
       timeout = user_timeout;
       reset_timeout = 0;
@@ -40,6 +40,8 @@
 
 static void uv__async_send(uv_loop_t* loop);
 static int uv__async_start(uv_loop_t* loop);
+static int uv__async_push(uv_async_t* handle);
+static void uv__async_drain(uv_loop_t* loop);
 
 
 int uv_async_init(uv_loop_t* loop, uv_async_t* handle, uv_async_cb async_cb) {
@@ -53,7 +55,7 @@ int uv_async_init(uv_loop_t* loop, uv_async_t* handle, uv_async_cb async_cb) {
   handle->async_cb = async_cb;
   handle->pending = 0;
 
-  QUEUE_INSERT_TAIL(&loop->async_handles, &handle->queue);
+  QUEUE_INIT(&handle->queue);
   uv__handle_start(handle);
 
   return 0;
@@ -69,8 +71,11 @@ int uv_async_send(uv_async_t* handle) {
   if (cmpxchgi(&handle->pending, 0, 1) != 0)
     return 0;
 
-  /* Wake up the other thread's event loop. */
-  uv__async_send(handle->loop);
+  /* Wake up the other thread's event loop, unless another handle got there
+   * first and the loop hasn't picked up the pending handles yet.
+   */
+  if (uv__async_push(handle))
+    uv__async_send(handle->loop);
 
   /* Tell the other thread we're done. */
   if (cmpxchgi(&handle->pending, 1, 2) != 1)
@@ -112,9 +117,60 @@ static int uv__async_spin(uv_async_t* handle) {
 }
 
 
+/* A handle is on the pending stack or the loop's ready queue for exactly as
+ * long as handle->pending is non-zero. The stack is a singly linked list
+ * through handle->queue[0] that other threads push onto, the ready queue is
+ * loop->async_handles and only the loop thread touches it.
+ */
+static int uv__async_push(uv_async_t* handle) {
+  void** head;
+  void* old;
+
+  head = &uv__get_internal_fields(handle->loop)->async_pending;
+
+  do {
+    old = (void*) ACCESS_ONCE(void*, *head);
+    handle->queue[0] = old;
+  } while (cmpxchgp(head, old, &handle->queue) != old);
+
+  return old == NULL;
+}
+
+
+/* Only call this from the event loop thread. */
+static void uv__async_drain(uv_loop_t* loop) {
+  void** head;
+  QUEUE* tail;
+  QUEUE* q;
+  void* next;
+
+  head = &uv__get_internal_fields(loop)->async_pending;
+
+  do
+    next = (void*) ACCESS_ONCE(void*, *head);
+  while (next != NULL && cmpxchgp(head, next, NULL) != next);
+
+  /* The stack is newest first, insert every entry right behind the current
+   * tail of the ready queue so they come out in the order they were sent.
+   */
+  tail = QUEUE_PREV(&loop->async_handles);
+  while (next != NULL) {
+    q = next;
+    next = (*q)[0];
+    QUEUE_INSERT_HEAD(tail, q);
+  }
+}
+
+
 void uv__async_close(uv_async_t* handle) {
-  uv__async_spin(handle);
-  QUEUE_REMOVE(&handle->queue);
+  /* If the handle is pending it's on the stack or in the ready queue, move
+   * the stack over so it can be unlinked.
+   */
+  if (uv__async_spin(handle) != 0) {
+    uv__async_drain(handle->loop);
+    QUEUE_REMOVE(&handle->queue);
+  }
+
   uv__handle_stop(handle);
 }
 
@@ -122,7 +178,6 @@ void uv__async_close(uv_async_t* handle) {
 static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   char buf[1024];
   ssize_t r;
-  QUEUE queue;
   QUEUE* q;
   uv_async_t* h;
 
@@ -146,13 +201,16 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
     abort();
   }
 
-  QUEUE_MOVE(&loop->async_handles, &queue);
-  while (!QUEUE_EMPTY(&queue)) {
-    q = QUEUE_HEAD(&queue);
+  /* Only visit the handles that were sent, not every handle on the loop.
+   * Handles that are sent again from a callback go on the stack and wait for
+   * the next wakeup.
+   */
+  uv__async_drain(loop);
+  while (!QUEUE_EMPTY(&loop->async_handles)) {
+    q = QUEUE_HEAD(&loop->async_handles);
     h = QUEUE_DATA(q, uv_async_t, queue);
 
     QUEUE_REMOVE(q);
-    QUEUE_INSERT_TAIL(&loop->async_handles, q);
 
     if (0 == uv__async_spin(h))
       continue;  /* Not pending. */
@@ -228,12 +286,23 @@ static int uv__async_start(uv_loop_t* loop) {
 
 
 int uv__async_fork(uv_loop_t* loop) {
+  int err;
+
   if (loop->async_io_watcher.fd == -1) /* never started */
     return 0;
 
   uv__async_stop(loop);
 
-  return uv__async_start(loop);
+  err = uv__async_start(loop);
+  if (err)
+    return err;
+
+  /* The new eventfd missed the wakeup of handles that are still pending. */
+  if (uv__get_internal_fields(loop)->async_pending != NULL ||
+      !QUEUE_EMPTY(&loop->async_handles))
+    uv__async_send(loop);
+
+  return 0;
 }
 
 
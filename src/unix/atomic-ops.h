@@ -23,6 +23,7 @@
 #endif
 
 UV_UNUSED(static int cmpxchgi(int* ptr, int oldval, int newval));
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval));
 UV_UNUSED(static void cpu_relax(void));
 
 /* Prefer hand-rolled assembly over the gcc builtins because the latter also
@@ -50,6 +51,21 @@ UV_UNUSED(static int cmpxchgi(int* ptr, int oldval, int newval)) {
 #endif
 }
 
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval)) {
+#if defined(__i386__) || defined(__x86_64__)
+  void* out;
+  __asm__ __volatile__ ("lock; cmpxchg %2, %1;"
+                        : "=a" (out), "+m" (*(void* volatile*) ptr)
+                        : "r" (newval), "0" (oldval)
+                        : "memory");
+  return out;
+#elif defined(__SUNPRO_C) || defined(__SUNPRO_CC)
+  return atomic_cas_ptr(ptr, oldval, newval);
+#else
+  return __sync_val_compare_and_swap(ptr, oldval, newval);
+#endif
+}
+
 UV_UNUSED(static void cpu_relax(void)) {
 #if defined(__i386__) || defined(__x86_64__)
   __asm__ __volatile__ ("rep; nop" ::: "memory");  /* a.k.a. PAUSE */
@@ -245,7 +245,10 @@ int uv__getiovmax(void) {
 
 
 static void uv__finish_close(uv_handle_t* handle) {
+  uv_handle_type type;
   uv_signal_t* sh;
+  uv_loop_t* loop;
+  uint64_t start;
 
   /* Note: while the handle is in the UV_HANDLE_CLOSING state now, it's still
    * possible for it to be active in the sense that uv__is_active() returns
@@ -304,7 +307,12 @@ static void uv__finish_close(uv_handle_t* handle) {
   QUEUE_REMOVE(&handle->handle_queue);
 
   if (handle->close_cb) {
+    loop = handle->loop;
+    type = handle->type;
+    uv__metrics_inc_callbacks(loop, 1);
+    start = uv__slow_cb_start(loop);
     handle->close_cb(handle);
+    uv__slow_cb_end(loop, start, UV_METRICS_PHASE_CLOSING, type, -1);
   }
 }
 
@@ -347,6 +355,9 @@ int uv_backend_timeout(const uv_loop_t* loop) {
   if (!QUEUE_EMPTY(&loop->pending_queue))
     return 0;
 
+  if (!QUEUE_EMPTY(&uv__get_internal_fields(loop)->deferred_reads))
+    return 0;
+
   if (loop->closing_handles)
     return 0;
 
@@ -376,11 +387,17 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
     uv__update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    uv__metrics_inc_loop_count(loop);
+    uv__metrics_tick(loop);
     uv__update_time(loop);
     uv__run_timers(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
     ran_pending = uv__run_pending(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PENDING);
     uv__run_idle(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_IDLE);
     uv__run_prepare(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PREPARE);
 
     timeout = 0;
     if ((mode == UV_RUN_ONCE && !ran_pending) || mode == UV_RUN_DEFAULT)
@@ -394,9 +411,14 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
      * the timeout == 0) or was already updated b/c an event was received.
      */
     uv__metrics_update_idle_time(loop);
+    /* Streams that yielded their turn in this poll phase go last. */
+    uv__stream_run_deferred(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
 
     uv__run_check(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CHECK);
     uv__run_closing_handles(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CLOSING);
 
     if (mode == UV_RUN_ONCE) {
       /* UV_RUN_ONCE implies forward progress: at least one callback must have
@@ -409,8 +431,10 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
        */
       uv__update_time(loop);
       uv__run_timers(loop);
+      uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
     }
 
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TICK);
     r = uv__loop_alive(loop);
     if (mode == UV_RUN_ONCE || mode == UV_RUN_NOWAIT)
       break;
@@ -807,6 +831,7 @@ static int uv__run_pending(uv_loop_t* loop) {
   QUEUE* q;
   QUEUE pq;
   uv__io_t* w;
+  unsigned int events;
 
   if (QUEUE_EMPTY(&loop->pending_queue))
     return 0;
@@ -818,7 +843,13 @@ static int uv__run_pending(uv_loop_t* loop) {
     QUEUE_REMOVE(q);
     QUEUE_INIT(q);
     w = QUEUE_DATA(q, uv__io_t, pending_queue);
-    w->cb(loop, w, POLLOUT);
+    events = POLLOUT;
+#if defined(__linux__)
+    /* Readiness that an edge-triggered watcher hasn't consumed yet. */
+    events |= uv__io_ready(w, w->pevents | POLLERR | POLLHUP);
+#endif
+    uv__io_dispatch(loop, w, events, UV_METRICS_PHASE_PENDING);
+    uv__metrics_inc_callbacks(loop, 1);
   }
 
   return 1;
@@ -871,6 +902,264 @@ static void maybe_resize(uv_loop_t* loop, unsigned int len) {
 }
 
 
+/* Multiplicative hashing spreads out the runs of consecutive fds. */
+static unsigned int uv__watcher_hash(int fd, unsigned int mask) {
+  unsigned int h;
+
+  h = (unsigned int) fd * 2654435769u;
+  return (h ^ (h >> 16)) & mask;
+}
+
+
+static void uv__watchers_rehash(uv_loop_t* loop, unsigned int nslots) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watcher_slot* slots;
+  struct uv__watcher_slot* old;
+  unsigned int nold;
+  unsigned int mask;
+  unsigned int i;
+  unsigned int j;
+
+  lfields = uv__get_internal_fields(loop);
+  old = lfields->sparse_watchers;
+  nold = old != NULL ? lfields->sparse_watchers_mask + 1 : 0;
+
+  slots = NULL;
+  mask = 0;
+
+  if (nslots > 0) {
+    slots = uv__malloc(nslots * sizeof(*slots));
+    if (slots == NULL)
+      abort();
+
+    for (i = 0; i < nslots; i++) {
+      slots[i].fd = -1;
+      slots[i].w = NULL;
+    }
+
+    mask = nslots - 1;
+    for (i = 0; i < nold; i++) {
+      if (old[i].fd == -1)
+        continue;
+
+      j = uv__watcher_hash(old[i].fd, mask);
+      while (slots[j].fd != -1)
+        j = (j + 1) & mask;
+
+      slots[j] = old[i];
+    }
+  }
+
+  uv__free(old);
+  lfields->sparse_watchers = slots;
+  lfields->sparse_watchers_mask = mask;
+}
+
+
+uv__io_t* uv__watcher_find(uv_loop_t* loop, int fd) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watcher_slot* slots;
+  unsigned int mask;
+  unsigned int i;
+
+  lfields = uv__get_internal_fields(loop);
+  slots = lfields->sparse_watchers;
+
+  if (slots == NULL || fd < UV__WATCHERS_DENSE_MAX)
+    return NULL;
+
+  mask = lfields->sparse_watchers_mask;
+  for (i = uv__watcher_hash(fd, mask); slots[i].fd != -1; i = (i + 1) & mask)
+    if (slots[i].fd == fd)
+      return slots[i].w;
+
+  return NULL;
+}
+
+
+static void uv__watcher_insert(uv_loop_t* loop, int fd, uv__io_t* w) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watcher_slot* slots;
+  unsigned int nslots;
+  unsigned int mask;
+  unsigned int i;
+
+  lfields = uv__get_internal_fields(loop);
+  nslots = 0;
+  if (lfields->sparse_watchers != NULL)
+    nslots = lfields->sparse_watchers_mask + 1;
+
+  /* Keep the load factor at or below 1/2, probes stay short. */
+  if (2 * (lfields->sparse_watchers_count + 1) > nslots)
+    uv__watchers_rehash(loop, nslots > 0 ? 2 * nslots : 16);
+
+  slots = lfields->sparse_watchers;
+  mask = lfields->sparse_watchers_mask;
+  for (i = uv__watcher_hash(fd, mask); slots[i].fd != -1; i = (i + 1) & mask) {
+    if (slots[i].fd == fd) {
+      slots[i].w = w;
+      return;
+    }
+  }
+
+  slots[i].fd = fd;
+  slots[i].w = w;
+  lfields->sparse_watchers_count++;
+}
+
+
+static void uv__watcher_remove(uv_loop_t* loop, int fd) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__watcher_slot* slots;
+  unsigned int nslots;
+  unsigned int mask;
+  unsigned int home;
+  unsigned int i;
+  unsigned int j;
+
+  lfields = uv__get_internal_fields(loop);
+  slots = lfields->sparse_watchers;
+  if (slots == NULL)
+    return;
+
+  mask = lfields->sparse_watchers_mask;
+  for (i = uv__watcher_hash(fd, mask); slots[i].fd != fd; i = (i + 1) & mask)
+    if (slots[i].fd == -1)
+      return;
+
+  /* Shift the rest of the cluster back instead of leaving a tombstone, an
+   * entry moves into the hole when its home slot isn't between the hole and
+   * where the entry is now.
+   */
+  for (j = i;;) {
+    j = (j + 1) & mask;
+    if (slots[j].fd == -1)
+      break;
+
+    home = uv__watcher_hash(slots[j].fd, mask);
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+      continue;
+
+    slots[i] = slots[j];
+    i = j;
+  }
+
+  slots[i].fd = -1;
+  slots[i].w = NULL;
+  lfields->sparse_watchers_count--;
+
+  nslots = mask + 1;
+  if (lfields->sparse_watchers_count == 0)
+    uv__watchers_rehash(loop, 0);
+  else if (nslots > 16 && 8 * lfields->sparse_watchers_count < nslots)
+    uv__watchers_rehash(loop, nslots / 2);
+}
+
+
+/* Registers `w` as the watcher of `fd`, or removes the registered watcher
+ * when `w` is NULL. The dense part of the table must already be big enough,
+ * see maybe_resize().
+ */
+void uv__watcher_set(uv_loop_t* loop, int fd, uv__io_t* w) {
+  assert(fd >= 0);
+
+  if (fd < UV__WATCHERS_DENSE_MAX) {
+    assert((unsigned) fd < loop->nwatchers);
+    loop->watchers[fd] = w;
+  } else if (w != NULL) {
+    uv__watcher_insert(loop, fd, w);
+  } else {
+    uv__watcher_remove(loop, fd);
+  }
+}
+
+
+/* Calls `cb` for every registered watcher. The callback may remove the
+ * watcher it's passed but no others.
+ */
+void uv__watchers_foreach(uv_loop_t* loop,
+                          void (*cb)(uv_loop_t* loop, uv__io_t* w)) {
+  uv__loop_internal_fields_t* lfields;
+  uv__io_t** sparse;
+  unsigned int nsparse;
+  unsigned int i;
+  unsigned int n;
+  uv__io_t* w;
+
+  for (i = 0; i < loop->nwatchers; i++) {
+    w = loop->watchers[i];
+    if (w != NULL)
+      cb(loop, w);
+  }
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->sparse_watchers == NULL)
+    return;
+
+  /* Removals shuffle the hash table around, walk a copy. */
+  nsparse = lfields->sparse_watchers_count;
+  sparse = uv__malloc(nsparse * sizeof(*sparse));
+  if (sparse == NULL)
+    abort();
+
+  n = 0;
+  for (i = 0; i <= lfields->sparse_watchers_mask; i++)
+    if (lfields->sparse_watchers[i].fd != -1)
+      sparse[n++] = lfields->sparse_watchers[i].w;
+
+  assert(n == nsparse);
+  for (i = 0; i < n; i++)
+    cb(loop, sparse[i]);
+
+  uv__free(sparse);
+}
+
+
+/* Best effort, only used to report slow callbacks. */
+static uv_handle_type uv__io_handle_type(uv_loop_t* loop,
+                                         uv__io_t* w,
+                                         uv__io_cb cb) {
+  if (cb == uv__stream_io || cb == uv__server_io)
+    return container_of(w, uv_stream_t, io_watcher)->type;
+
+  if (cb == uv__udp_io)
+    return UV_UDP;
+
+  if (cb == uv__poll_io)
+    return UV_POLL;
+
+  if (w == &loop->async_io_watcher)
+    return UV_ASYNC;
+
+  if (w == &loop->signal_io_watcher)
+    return UV_SIGNAL;
+
+  return UV_UNKNOWN_HANDLE;
+}
+
+
+void uv__io_dispatch_timed(uv_loop_t* loop,
+                           uv__io_t* w,
+                           unsigned int events,
+                           uv_metrics_phase phase) {
+  uv_handle_type type;
+  uint64_t start;
+  uv__io_cb cb;
+  int fd;
+
+  /* The callback may stop the watcher or close the handle, look at it first.
+   * The handle's memory stays valid until its close callback runs.
+   */
+  cb = w->cb;
+  fd = w->fd;
+  type = uv__io_handle_type(loop, w, cb);
+
+  start = uv_hrtime();
+  cb(loop, w, events);
+  uv__slow_cb_report(loop, start, phase, type, fd);
+}
+
+
 void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd) {
   assert(cb != NULL);
   assert(fd >= -1);
@@ -889,13 +1178,32 @@ void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd) {
 
 
 void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  uv__io_t* old;
+
   assert(0 == (events & ~(POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI)));
   assert(0 != events);
   assert(w->fd >= 0);
   assert(w->fd < INT_MAX);
 
   w->pevents |= events;
-  maybe_resize(loop, w->fd + 1);
+  /* The dense table also holds the backend's fake watcher list, see
+   * uv__platform_invalidate_fd(), it has to exist either way.
+   */
+  if (w->fd < UV__WATCHERS_DENSE_MAX)
+    maybe_resize(loop, w->fd + 1);
+  else
+    maybe_resize(loop, 1);
+
+#if defined(__linux__)
+  /* Edge-triggered watchers are registered for all events once. What the
+   * kernel reported while nobody was interested won't be reported again,
+   * deliver it from the pending queue instead. */
+  if (w->events & UV__POLLET) {
+    if (uv__io_ready(w, events | POLLERR | POLLHUP))
+      uv__io_feed(loop, w);
+    return;
+  }
+#endif
 
 #if !defined(__sun)
   /* The event ports backend needs to rearm all file descriptors on each and
@@ -909,8 +1217,22 @@ void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   if (QUEUE_EMPTY(&w->watcher_queue))
     QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
 
-  if (loop->watchers[w->fd] == NULL) {
-    loop->watchers[w->fd] = w;
+  old = uv__watcher_get(loop, w->fd);
+
+#if defined(__linux__)
+  /* An idle edge-triggered watcher still holds on to the fd, happens when
+   * several handles are opened on the same fd. Make way for this one.
+   */
+  if (old != NULL && old != w && old->pevents == 0) {
+    old->events = 0;
+    uv__watcher_set(loop, w->fd, NULL);
+    loop->nfds--;
+    old = NULL;
+  }
+#endif
+
+  if (old == NULL) {
+    uv__watcher_set(loop, w->fd, w);
     loop->nfds++;
   }
 }
@@ -925,20 +1247,22 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   assert(w->fd >= 0);
 
-  /* Happens when uv__io_stop() is called on a handle that was never started. */
-  if ((unsigned) w->fd >= loop->nwatchers)
-    return;
-
   w->pevents &= ~events;
 
+#if defined(__linux__)
+  /* Edge-triggered watchers stay registered until uv__io_close(). */
+  if (w->events & UV__POLLET)
+    return;
+#endif
+
   if (w->pevents == 0) {
     QUEUE_REMOVE(&w->watcher_queue);
     QUEUE_INIT(&w->watcher_queue);
     w->events = 0;
 
-    if (w == loop->watchers[w->fd]) {
+    if (w == uv__watcher_get(loop, w->fd)) {
       assert(loop->nfds > 0);
-      loop->watchers[w->fd] = NULL;
+      uv__watcher_set(loop, w->fd, NULL);
       loop->nfds--;
     }
   }
@@ -948,6 +1272,11 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
 
 void uv__io_close(uv_loop_t* loop, uv__io_t* w) {
+#if defined(__linux__)
+  if (w->events & UV__POLLET)
+    w->events = 0;
+#endif
+
   uv__io_stop(loop, w, POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI);
   QUEUE_REMOVE(&w->pending_queue);
 
@@ -970,8 +1299,53 @@ int uv__io_active(const uv__io_t* w, unsigned int events) {
 }
 
 
+/* Whether the watcher is to be registered edge-triggered, see uv__io_poll().
+ * Only streams opt in, see uv__stream_open(). Their callback consumes
+ * readiness until EAGAIN and reports that with uv__io_clear_ready().
+ */
+int uv__io_edge_triggered(const uv__io_t* w) {
+  const uv_stream_t* stream;
+
+  if (w->cb != uv__stream_io)
+    return 0;
+
+  stream = container_of(w, const uv_stream_t, io_watcher);
+  return 0 != (stream->flags & UV_HANDLE_EDGE_TRIGGERED);
+}
+
+
+/* Readiness reported to an edge-triggered watcher and not consumed yet. */
+unsigned int uv__io_ready(const uv__io_t* w, unsigned int events) {
+#if defined(__linux__)
+  if (w->events & UV__POLLET)
+    return (w->events >> UV__POLLET_READY_SHIFT) & events;
+#endif
+  return 0;
+}
+
+
+/* The fd reported EAGAIN for `events`, wait for the next edge. */
+void uv__io_clear_ready(uv__io_t* w, unsigned int events) {
+#if defined(__linux__)
+  if (w->events & UV__POLLET)
+    w->events &= ~(events << UV__POLLET_READY_SHIFT);
+#endif
+}
+
+
+/* Come back to a watcher that stopped before it consumed all readiness, the
+ * kernel won't report it again when the watcher is edge-triggered.
+ */
+void uv__io_feed_ready(uv_loop_t* loop, uv__io_t* w) {
+#if defined(__linux__)
+  if (w->events & UV__POLLET)
+    uv__io_feed(loop, w);
+#endif
+}
+
+
 int uv__fd_exists(uv_loop_t* loop, int fd) {
-  return (unsigned) fd < loop->nwatchers && loop->watchers[fd] != NULL;
+  return uv__watcher_get(loop, fd) != NULL;
 }
 
 
@@ -23,6 +23,48 @@
 #include "internal.h"
 #include <errno.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#ifndef SO_BUSY_POLL
+# define SO_BUSY_POLL 46
+#endif
+
+/* struct epoll_params from <linux/eventpoll.h>, Linux 6.9+. */
+struct uv__epoll_params {
+  uint32_t busy_poll_usecs;
+  uint16_t busy_poll_budget;
+  uint8_t prefer_busy_poll;
+  uint8_t pad;
+};
+
+#define UV__EPIOCSPARAMS _IOW(0x8A, 0x01, struct uv__epoll_params)
+
+/* The kernel's default, raising it requires CAP_NET_ADMIN. */
+#define UV__BUSY_POLL_BUDGET 8
+
+/* Bounds of the epoll_wait() event array, see uv__epoll_events_resize(). The
+ * smallest one lives on the stack of uv__io_poll().
+ */
+#define UV__EPOLL_EVENTS_MIN 64
+#define UV__EPOLL_EVENTS_MAX 8192
+
+/* Number of polls that have to use less than a quarter of the event array
+ * before it shrinks.
+ */
+#define UV__EPOLL_EVENTS_SHRINK 256
+
+/* Every change to the interest list goes through here so that it shows up in
+ * uv_metrics_info().
+ */
+static int uv__epoll_ctl(uv_loop_t* loop,
+                         int op,
+                         int fd,
+                         struct epoll_event* e) {
+  uv__get_loop_metrics(loop)->backend_ctl++;
+  return epoll_ctl(loop->backend_fd, op, fd, e);
+}
+
 
 int uv__epoll_init(uv_loop_t* loop) {
   int fd;
@@ -63,6 +105,11 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
       if (events[i].data.fd == fd)
         events[i].data.fd = -1;
 
+  if (uv__iou_poll_enabled(loop)) {
+    uv__iou_poll_invalidate_fd(loop, fd);
+    return;
+  }
+
   /* Remove the file descriptor from the epoll.
    * This avoids a problem where the same file description remains open
    * in another process, causing repeated junk epoll events.
@@ -74,11 +121,102 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
      * has the EPOLLWAKEUP flag set generates spurious audit syslog warnings.
      */
     memset(&dummy, 0, sizeof(dummy));
-    epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &dummy);
+    uv__epoll_ctl(loop, EPOLL_CTL_DEL, fd, &dummy);
   }
 }
 
 
+int uv__epoll_busy_poll(uv_loop_t* loop, unsigned int usec) {
+  struct uv__epoll_params params;
+
+  if (usec > 1000 * 1000)
+    return UV_EINVAL;
+
+  uv__get_internal_fields(loop)->busy_poll = usec;
+
+  /* Have epoll_wait() busy poll the device queues of the sockets it watches
+   * too. Best effort, it needs a recent kernel.
+   */
+  memset(&params, 0, sizeof(params));
+  params.busy_poll_usecs = usec;
+  params.busy_poll_budget = UV__BUSY_POLL_BUDGET;
+  ioctl(loop->backend_fd, UV__EPIOCSPARAMS, &params);
+
+  return 0;
+}
+
+
+/* Sockets of a busy polling loop busy poll their device queue when they're
+ * read from. Best effort, raising the value above net.core.busy_read requires
+ * CAP_NET_ADMIN.
+ */
+void uv__epoll_busy_poll_fd(uv_loop_t* loop, int fd) {
+  int usec;
+
+  usec = uv__get_internal_fields(loop)->busy_poll;
+  if (usec != 0)
+    setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+}
+
+
+/* Adapt the size of the event array to the load. It doubles when a poll fills
+ * it, which means fewer and larger batches and each watcher visited once per
+ * tick, and halves when the loop has been quiet for a while. Allocation
+ * failures aren't fatal, the loop just keeps the array it has.
+ */
+static void uv__epoll_events_resize(uv_loop_t* loop, int nfds) {
+  uv__loop_internal_fields_t* lfields;
+  struct epoll_event* events;
+  unsigned int size;
+
+  lfields = uv__get_internal_fields(loop);
+  size = lfields->npoll_events;
+  if (size == 0)
+    size = UV__EPOLL_EVENTS_MIN;
+
+  if ((unsigned int) nfds == size) {
+    lfields->poll_events_idle = 0;
+    if (size >= UV__EPOLL_EVENTS_MAX)
+      return;
+    size *= 2;
+  } else if ((unsigned int) nfds < size / 4) {
+    if (size == UV__EPOLL_EVENTS_MIN)
+      return;
+    if (++lfields->poll_events_idle < UV__EPOLL_EVENTS_SHRINK)
+      return;
+    lfields->poll_events_idle = 0;
+    size /= 2;
+  } else {
+    lfields->poll_events_idle = 0;
+    return;
+  }
+
+  events = NULL;
+  if (size > UV__EPOLL_EVENTS_MIN) {
+    events = uv__malloc(size * sizeof(*events));
+    if (events == NULL)
+      return;
+  } else {
+    size = 0;
+  }
+
+  uv__free(lfields->poll_events);
+  lfields->poll_events = events;
+  lfields->npoll_events = size;
+}
+
+
+void uv__epoll_delete(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  uv__free(lfields->poll_events);
+  lfields->poll_events = NULL;
+  lfields->npoll_events = 0;
+  lfields->poll_events_idle = 0;
+}
+
+
 int uv__io_check_fd(uv_loop_t* loop, int fd) {
   struct epoll_event e;
   int rc;
@@ -88,12 +226,12 @@ int uv__io_check_fd(uv_loop_t* loop, int fd) {
   e.data.fd = -1;
 
   rc = 0;
-  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, fd, &e))
+  if (uv__epoll_ctl(loop, EPOLL_CTL_ADD, fd, &e))
     if (errno != EEXIST)
       rc = UV__ERR(errno);
 
   if (rc == 0)
-    if (epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, &e))
+    if (uv__epoll_ctl(loop, EPOLL_CTL_DEL, fd, &e))
       abort();
 
   return rc;
@@ -114,7 +252,9 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   static int no_epoll_wait_cached;
   int no_epoll_pwait;
   int no_epoll_wait;
-  struct epoll_event events[1024];
+  struct epoll_event stack_events[UV__EPOLL_EVENTS_MIN];
+  struct epoll_event* events;
+  int maxevents;
   struct epoll_event* pe;
   struct epoll_event e;
   int real_timeout;
@@ -132,6 +272,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   int i;
   int user_timeout;
   int reset_timeout;
+  int iou_poll;
+  uint64_t spin_start;
+  uint64_t spin_time;
+  uint64_t spin_now;
+
+  /* Hand batched file system requests to the kernel before blocking. */
+  uv__iou_fs_flush(loop);
 
   if (loop->nfds == 0) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
@@ -139,8 +286,10 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   }
 
   memset(&e, 0, sizeof(e));
+  iou_poll = uv__iou_poll_enabled(loop);
 
-  while (!QUEUE_EMPTY(&loop->watcher_queue)) {
+  /* The io_uring backend arms watchers itself in uv__iou_poll_wait(). */
+  while (!iou_poll && !QUEUE_EMPTY(&loop->watcher_queue)) {
     q = QUEUE_HEAD(&loop->watcher_queue);
     QUEUE_REMOVE(q);
     QUEUE_INIT(q);
@@ -148,31 +297,40 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     w = QUEUE_DATA(q, uv__io_t, watcher_queue);
     assert(w->pevents != 0);
     assert(w->fd >= 0);
-    assert(w->fd < (int) loop->nwatchers);
+
+    /* The watcher stopped and started watching the same events since it
+     * was queued, the registration is still what it wants.
+     */
+    if (w->events == w->pevents)
+      continue;
 
     e.events = w->pevents;
     e.data.fd = w->fd;
 
+    /* Edge-triggered watchers are registered for everything once and never
+     * modified, uv__io_start() and uv__io_stop() only update w->pevents.
+     * The kernel reports the current state on registration.
+     */
+    if (uv__io_edge_triggered(w))
+      e.events = POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLET;
+
     if (w->events == 0)
       op = EPOLL_CTL_ADD;
     else
       op = EPOLL_CTL_MOD;
 
-    /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
-     * events, skip the syscall and squelch the events after epoll_wait().
-     */
-    if (epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
+    if (uv__epoll_ctl(loop, op, w->fd, &e)) {
       if (errno != EEXIST)
         abort();
 
       assert(op == EPOLL_CTL_ADD);
 
       /* We've reactivated a file descriptor that's been watched before. */
-      if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, w->fd, &e))
+      if (uv__epoll_ctl(loop, EPOLL_CTL_MOD, w->fd, &e))
         abort();
     }
 
-    w->events = w->pevents;
+    w->events = e.events;
   }
 
   sigmask = 0;
@@ -196,6 +354,24 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     user_timeout = 0;
   }
 
+  /* Busy polling, see UV_LOOP_BUSY_POLL. Poll without blocking until there
+   * is something to do or the spin time is up, then block for what is left
+   * of the timeout. Spinning doesn't count as idle time.
+   */
+  spin_start = 0;
+  spin_time = (uint64_t) uv__get_internal_fields(loop)->busy_poll * 1000;
+  if (spin_time != 0 && real_timeout != 0) {
+    if (real_timeout > 0 && spin_time > (uint64_t) real_timeout * 1000000)
+      spin_time = (uint64_t) real_timeout * 1000000;
+
+    spin_start = uv__hrtime(UV_CLOCK_FAST);
+    if (reset_timeout == 0) {
+      reset_timeout = 1;
+      user_timeout = timeout;
+      timeout = 0;
+    }
+  }
+
   /* You could argue there is a dependency between these two but
    * ultimately we don't care about their ordering with respect
    * to one another. Worst case, we make a few system calls that
@@ -206,6 +382,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   no_epoll_wait = uv__load_relaxed(&no_epoll_wait_cached);
 
   for (;;) {
+    events = uv__get_internal_fields(loop)->poll_events;
+    maxevents = uv__get_internal_fields(loop)->npoll_events;
+    if (events == NULL) {
+      events = stack_events;
+      maxevents = ARRAY_SIZE(stack_events);
+    }
+
     /* Only need to set the provider_entry_time if timeout != 0. The function
      * will return early if the loop isn't configured with UV_METRICS_IDLE_TIME.
      */
@@ -218,6 +401,15 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     if (sizeof(int32_t) == sizeof(long) && timeout >= max_safe_timeout)
       timeout = max_safe_timeout;
 
+    if (iou_poll) {
+      nfds = uv__iou_poll_wait(loop,
+                               events,
+                               maxevents,
+                               timeout,
+                               sigmask != 0 ? &sigset : NULL);
+      goto poll_done;
+    }
+
     if (sigmask != 0 && no_epoll_pwait != 0)
       if (pthread_sigmask(SIG_BLOCK, &sigset, NULL))
         abort();
@@ -225,7 +417,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     if (no_epoll_wait != 0 || (sigmask != 0 && no_epoll_pwait == 0)) {
       nfds = epoll_pwait(loop->backend_fd,
                          events,
-                         ARRAY_SIZE(events),
+                         maxevents,
                          timeout,
                          &sigset);
       if (nfds == -1 && errno == ENOSYS) {
@@ -235,7 +427,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     } else {
       nfds = epoll_wait(loop->backend_fd,
                         events,
-                        ARRAY_SIZE(events),
+                        maxevents,
                         timeout);
       if (nfds == -1 && errno == ENOSYS) {
         uv__store_relaxed(&no_epoll_wait_cached, 1);
@@ -247,14 +439,27 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       if (pthread_sigmask(SIG_UNBLOCK, &sigset, NULL))
         abort();
 
+poll_done:
+    uv__get_loop_metrics(loop)->backend_poll++;
+
     /* Update loop->time unconditionally. It's tempting to skip the update when
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
     SAVE_ERRNO(uv__update_time(loop));
 
+    if (spin_start != 0) {
+      spin_now = uv__hrtime(UV_CLOCK_FAST);
+      if (nfds == 0 && spin_now - spin_start < spin_time)
+        continue;
+
+      uv__get_loop_metrics(loop)->busy_poll_time += spin_now - spin_start;
+      spin_start = 0;
+    }
+
     if (nfds == 0) {
       assert(timeout != -1);
+      uv__epoll_events_resize(loop, 0);
 
       if (reset_timeout != 0) {
         timeout = user_timeout;
@@ -323,9 +528,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
 
       assert(fd >= 0);
-      assert((unsigned) fd < loop->nwatchers);
 
-      w = loop->watchers[fd];
+      w = uv__watcher_get(loop, fd);
 
       if (w == NULL) {
         /* File descriptor that we've stopped watching, disarm it.
@@ -333,10 +537,23 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
          * Ignore all errors because we may be racing with another thread
          * when the file descriptor is closed.
          */
-        epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, fd, pe);
+        if (!iou_poll)
+          uv__epoll_ctl(loop, EPOLL_CTL_DEL, fd, pe);
         continue;
       }
 
+      /* The kernel reports readiness of edge-triggered watchers only once.
+       * Remember it until the handle runs into EAGAIN, it may have to be
+       * delivered later on from uv__run_pending().
+       */
+      if (w->events & UV__POLLET) {
+        w->events |= (pe->events &
+                      (POLLIN | POLLOUT | UV__POLLRDHUP | POLLERR | POLLHUP))
+                     << UV__POLLET_READY_SHIFT;
+        if (w->pevents == 0)
+          continue;
+      }
+
       /* Give users only events they're interested in. Prevents spurious
        * callbacks when previous callback invocation in this loop has stopped
        * the current watcher. Also, filters out events that users has not
@@ -371,13 +588,15 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
           have_signals = 1;
         } else {
           uv__metrics_update_idle_time(loop);
-          w->cb(loop, w, pe->events);
+          uv__io_dispatch(loop, w, pe->events, UV_METRICS_PHASE_POLL);
         }
 
         nevents++;
       }
     }
 
+    uv__metrics_inc_events(loop, nevents);
+
     if (reset_timeout != 0) {
       timeout = user_timeout;
       reset_timeout = 0;
@@ -391,11 +610,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     loop->watchers[loop->nwatchers] = NULL;
     loop->watchers[loop->nwatchers + 1] = NULL;
 
+    uv__epoll_events_resize(loop, nfds);
+
     if (have_signals != 0)
       return;  /* Event loop should cycle now so don't poll again. */
 
     if (nevents != 0) {
-      if (nfds == ARRAY_SIZE(events) && --count != 0) {
+      if (nfds == maxevents && --count != 0) {
         /* Poll for more events but don't block this time. */
         timeout = 0;
         continue;
@@ -133,6 +133,13 @@ int uv__pthread_sigmask(int how, const sigset_t* set, sigset_t* oset);
 # define UV__POLLPRI 0
 #endif
 
+/* Same as EPOLLET. Set in uv__io_t.events of watchers that are registered
+ * edge-triggered. Those keep the readiness they haven't consumed yet in the
+ * upper half of uv__io_t.events, shifted by UV__POLLET_READY_SHIFT.
+ */
+#define UV__POLLET 0x80000000u
+#define UV__POLLET_READY_SHIFT 16
+
 #if !defined(O_CLOEXEC) && defined(__FreeBSD__)
 /*
  * It may be that we are just missing `__POSIX_VISIBLE >= 200809`.
@@ -145,9 +152,15 @@ typedef struct uv__stream_queued_fds_s uv__stream_queued_fds_t;
 
 /* loop flags */
 enum {
-  UV_LOOP_BLOCK_SIGPROF = 1
+  UV_LOOP_BLOCK_SIGPROF = 1,
+  UV_LOOP_ENABLE_IO_URING = 2,
+  UV_LOOP_EDGE_TRIGGERED = 4,
+  UV_LOOP_DEFER_READS = 8
 };
 
+/* Reads per readiness event before a stream yields to the others. */
+#define UV__READ_BUDGET 32
+
 /* flags of excluding ifaddr */
 enum {
   UV__EXCLUDE_IFPHYS,
@@ -208,16 +221,51 @@ ssize_t uv__recvmsg(int fd, struct msghdr *msg, int flags);
 void uv__make_close_pending(uv_handle_t* handle);
 int uv__getiovmax(void);
 
+/* File descriptors below this index loop->watchers directly. Higher ones,
+ * the norm in processes with many open files, go into a hash table that
+ * grows with the loop's own watchers instead of with the highest fd.
+ */
+#define UV__WATCHERS_DENSE_MAX (1 << 14)
+
+struct uv__watcher_slot {
+  int fd;  /* -1 if the slot is free */
+  uv__io_t* w;
+};
+
+uv__io_t* uv__watcher_find(uv_loop_t* loop, int fd);
+void uv__watcher_set(uv_loop_t* loop, int fd, uv__io_t* w);
+void uv__watchers_foreach(uv_loop_t* loop,
+                          void (*cb)(uv_loop_t* loop, uv__io_t* w));
+
 void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd);
 void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__io_close(uv_loop_t* loop, uv__io_t* w);
 void uv__io_feed(uv_loop_t* loop, uv__io_t* w);
 int uv__io_active(const uv__io_t* w, unsigned int events);
+int uv__io_edge_triggered(const uv__io_t* w);
+unsigned int uv__io_ready(const uv__io_t* w, unsigned int events);
+void uv__io_clear_ready(uv__io_t* w, unsigned int events);
+void uv__io_feed_ready(uv_loop_t* loop, uv__io_t* w);
 int uv__io_check_fd(uv_loop_t* loop, int fd);
 void uv__io_poll(uv_loop_t* loop, int timeout); /* in milliseconds or -1 */
 int uv__io_fork(uv_loop_t* loop);
 int uv__fd_exists(uv_loop_t* loop, int fd);
+void uv__io_dispatch_timed(uv_loop_t* loop,
+                           uv__io_t* w,
+                           unsigned int events,
+                           uv_metrics_phase phase);
+
+/* Runs the callback of `w`, timed if uv_loop_set_slow_callback() is in
+ * effect.
+ */
+#define uv__io_dispatch(loop, w, events, phase)                               \
+  do {                                                                        \
+    if (uv__get_internal_fields(loop)->slow_cb == NULL)                       \
+      (w)->cb((loop), (w), (events));                                         \
+    else                                                                      \
+      uv__io_dispatch_timed((loop), (w), (events), (phase));                  \
+  } while (0)
 
 /* async */
 void uv__async_stop(uv_loop_t* loop);
@@ -229,15 +277,64 @@ void uv__run_idle(uv_loop_t* loop);
 void uv__run_check(uv_loop_t* loop);
 void uv__run_prepare(uv_loop_t* loop);
 
+/* Every send with MSG_ZEROCOPY gets the next number from a per-socket
+ * counter. The kernel reports ranges of those numbers on the socket's error
+ * queue once it no longer needs the pages, usually in order.
+ */
+struct uv__tcp_zerocopy_range {
+  uint32_t lo;
+  uint32_t hi;
+};
+
+struct uv__tcp_zerocopy {
+  size_t threshold;
+  uint32_t next;   /* number of the next send */
+  uint32_t acked;  /* all sends before this one have completed */
+  int copied;      /* the kernel copied the data anyway, stop bothering */
+  QUEUE pending;   /* uv_write_t, waiting for their last send to complete */
+  struct uv__tcp_zerocopy_range* ranges;  /* completed out of order */
+  unsigned int nranges;
+};
+
+/* How a listening socket hands out connections, see uv__server_io(). */
+struct uv__tcp_accept {
+  unsigned int batch;      /* accept() calls per wakeup, 0 for one at a time */
+  unsigned int next;       /* channel that gets the next connection */
+  unsigned int nchannels;  /* 0 when connections stay on this loop */
+  uv_channel_t** channels;
+};
+
+/* State that only some streams need. It's allocated when a stream first
+ * needs it, see uv__stream_ext_alloc(), and hangs off the handle's
+ * u.reserved[0], which streams don't otherwise use on Unix. That way
+ * uv_stream_t and uv_tcp_t keep their layout.
+ */
+struct uv__stream_ext {
+  uv_stream_t* stream;
+  void* deferred_queue[2];  /* see uv__stream_run_deferred() */
+  unsigned int read_budget;
+  size_t read_budget_bytes;
+  struct uv__tcp_zerocopy zerocopy;
+  struct uv__tcp_accept accept;
+};
+
+UV_UNUSED(static struct uv__stream_ext* uv__stream_ext(
+    const uv_stream_t* stream)) {
+  return stream->u.reserved[0];
+}
+
 /* stream */
 void uv__stream_init(uv_loop_t* loop, uv_stream_t* stream,
     uv_handle_type type);
+struct uv__stream_ext* uv__stream_ext_alloc(uv_stream_t* stream);
 int uv__stream_open(uv_stream_t*, int fd, int flags);
 void uv__stream_destroy(uv_stream_t* stream);
 #if defined(__APPLE__)
 int uv__stream_try_select(uv_stream_t* stream, int* fd);
 #endif /* defined(__APPLE__) */
 void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+void uv__stream_run_deferred(uv_loop_t* loop);
 int uv__accept(int sockfd);
 int uv__dup2_cloexec(int oldfd, int newfd);
 int uv__open_cloexec(const char* path, int flags);
@@ -246,6 +343,15 @@ int uv__open_cloexec(const char* path, int flags);
 int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb);
 int uv__tcp_nodelay(int fd, int on);
 int uv__tcp_keepalive(int fd, int on, unsigned int delay);
+int uv__tcp_zerocopy_sockopt(int fd, int on);
+int uv__tcp_zerocopy_flags(uv_tcp_t* handle, size_t size);
+void uv__tcp_zerocopy_sent(uv_tcp_t* handle);
+int uv__tcp_zerocopy_defer(uv_tcp_t* handle, uv_write_t* req);
+int uv__tcp_zerocopy_pending(uv_tcp_t* handle);
+void uv__tcp_zerocopy_reap(uv_tcp_t* handle);
+void uv__tcp_zerocopy_destroy(uv_tcp_t* handle);
+unsigned int uv__tcp_accept_batch(uv_tcp_t* handle);
+int uv__tcp_accept_handoff(uv_tcp_t* handle, int fd);
 
 /* pipe */
 int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb);
@@ -271,6 +377,7 @@ void uv__fs_event_close(uv_fs_event_t* handle);
 void uv__idle_close(uv_idle_t* handle);
 void uv__pipe_close(uv_pipe_t* handle);
 void uv__poll_close(uv_poll_t* handle);
+void uv__poll_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__prepare_close(uv_prepare_t* handle);
 void uv__process_close(uv_process_t* handle);
 void uv__stream_close(uv_stream_t* handle);
@@ -278,6 +385,7 @@ void uv__tcp_close(uv_tcp_t* handle);
 size_t uv__thread_stack_size(void);
 void uv__udp_close(uv_udp_t* handle);
 void uv__udp_finish_close(uv_udp_t* handle);
+void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents);
 uv_handle_type uv__handle_type(int fd);
 FILE* uv__open_file(const char* path);
 int uv__getpwuid_r(uv_passwd_t* pwd);
@@ -313,6 +421,13 @@ UV_UNUSED(static void uv__update_time(uv_loop_t* loop)) {
   loop->time = uv__hrtime(UV_CLOCK_FAST) / 1000000;
 }
 
+/* Returns the watcher registered for `fd`, or NULL. */
+UV_UNUSED(static uv__io_t* uv__watcher_get(uv_loop_t* loop, int fd)) {
+  if ((unsigned) fd < loop->nwatchers)
+    return loop->watchers[fd];
+  return uv__watcher_find(loop, fd);
+}
+
 UV_UNUSED(static char* uv__basename_r(const char* path)) {
   char* s;
 
@@ -325,6 +440,31 @@ UV_UNUSED(static char* uv__basename_r(const char* path)) {
 
 #if defined(__linux__)
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
+int uv__epoll_busy_poll(uv_loop_t* loop, unsigned int usec);
+void uv__epoll_delete(uv_loop_t* loop);
+void uv__epoll_busy_poll_fd(uv_loop_t* loop, int fd);
+int uv__numa_read(const char* file, char* buf, size_t len);
+int uv__getcpu(void);
+
+/* io_uring */
+struct epoll_event;
+int uv__iou_loop_init(uv_loop_t* loop);
+void uv__iou_loop_delete(uv_loop_t* loop);
+void uv__iou_loop_fork(uv_loop_t* loop);
+int uv__iou_fs_post(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_cancel(uv_loop_t* loop, uv_fs_t* req);
+void uv__iou_fs_flush(uv_loop_t* loop);
+void uv__statx_to_stat(const struct uv__statx* statxbuf, uv_stat_t* buf);
+int uv__iou_poll_enabled(const uv_loop_t* loop);
+void uv__iou_poll_invalidate_fd(uv_loop_t* loop, int fd);
+int uv__iou_poll_use_epoll(uv_loop_t* loop, int fd);
+int uv__iou_poll_wait(uv_loop_t* loop,
+                      struct epoll_event* events,
+                      int maxevents,
+                      int timeout,
+                      const sigset_t* sigset);
+#else
+#define uv__iou_poll_use_epoll(loop, fd) 0
 #endif
 
 typedef int (*uv__peersockfunc)(int, struct sockaddr*, socklen_t*);
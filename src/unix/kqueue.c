@@ -147,7 +147,6 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     w = QUEUE_DATA(q, uv__io_t, watcher_queue);
     assert(w->pevents != 0);
     assert(w->fd >= 0);
-    assert(w->fd < (int) loop->nwatchers);
 
     if ((w->events & POLLIN) == 0 && (w->pevents & POLLIN) != 0) {
       filter = EVFILT_READ;
@@ -288,7 +287,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       /* Skip invalidated events, see uv__platform_invalidate_fd */
       if (fd == -1)
         continue;
-      w = loop->watchers[fd];
+      w = uv__watcher_get(loop, fd);
 
       if (w == NULL) {
         /* File descriptor that we've stopped watching, disarm it.
@@ -307,7 +306,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         assert(w->events == POLLIN);
         assert(w->pevents == POLLIN);
         uv__metrics_update_idle_time(loop);
-        w->cb(loop, w, ev->fflags); /* XXX always uv__fs_event() */
+        /* XXX always uv__fs_event() */
+        uv__io_dispatch(loop, w, ev->fflags, UV_METRICS_PHASE_POLL);
         nevents++;
         continue;
       }
@@ -371,12 +371,14 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         have_signals = 1;
       } else {
         uv__metrics_update_idle_time(loop);
-        w->cb(loop, w, revents);
+        uv__io_dispatch(loop, w, revents, UV_METRICS_PHASE_POLL);
       }
 
       nevents++;
     }
 
+    uv__metrics_inc_events(loop, nevents);
+
     if (reset_timeout != 0) {
       timeout = user_timeout;
       reset_timeout = 0;
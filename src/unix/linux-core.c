@@ -41,6 +41,7 @@
 #include <sys/sysinfo.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sched.h>  /* sched_getcpu() */
 #include <time.h>
 
 #define HAVE_IFADDRS_H 1
@@ -83,11 +84,32 @@ static void read_speeds(unsigned int numcpus, uv_cpu_info_t* ci);
 static uint64_t read_cpufreq(unsigned int cpunum);
 
 int uv__platform_loop_init(uv_loop_t* loop) {
-  
+  const char* val;
+  int err;
+
   loop->inotify_fd = -1;
   loop->inotify_watchers = NULL;
+  uv__get_internal_fields(loop)->poll_ring.ringfd = -1;
+  uv__get_internal_fields(loop)->fs_ring.ringfd = -1;
+
+  err = uv__epoll_init(loop);
+  if (err)
+    return err;
 
-  return uv__epoll_init(loop);
+  val = getenv("UV_USE_EDGE_TRIGGERED");
+  if (val != NULL && atoi(val) > 0)
+    loop->flags |= UV_LOOP_EDGE_TRIGGERED;
+
+  val = getenv("UV_USE_IO_URING");
+  if (val != NULL && atoi(val) > 0)
+    loop->flags |= UV_LOOP_ENABLE_IO_URING;
+
+  /* Stay with epoll when the kernel lacks io_uring or its features. */
+  if (loop->flags & UV_LOOP_ENABLE_IO_URING)
+    if (uv__iou_loop_init(loop))
+      loop->flags &= ~UV_LOOP_ENABLE_IO_URING;
+
+  return 0;
 }
 
 
@@ -99,6 +121,7 @@ int uv__io_fork(uv_loop_t* loop) {
 
   uv__close(loop->backend_fd);
   loop->backend_fd = -1;
+  uv__iou_loop_fork(loop);
   uv__platform_loop_delete(loop);
 
   err = uv__platform_loop_init(loop);
@@ -110,6 +133,9 @@ int uv__io_fork(uv_loop_t* loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_loop_delete(loop);
+  uv__epoll_delete(loop);
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
   uv__close(loop->inotify_fd);
@@ -236,6 +262,28 @@ static int uv__slurp(const char* filename, char* buf, size_t len) {
   return 0;
 }
 
+
+/* Reads `file` from the sysfs NUMA node directory, e.g. "online" or
+ * "node0/cpulist".
+ */
+int uv__numa_read(const char* file, char* buf, size_t len) {
+  char path[64];
+
+  snprintf(path, sizeof(path), "/sys/devices/system/node/%s", file);
+  return uv__slurp(path, buf, len);
+}
+
+
+int uv__getcpu(void) {
+  int cpu;
+
+  cpu = sched_getcpu();
+  if (cpu < 0)
+    return UV__ERR(errno);
+
+  return cpu;
+}
+
 int uv_uptime(double* uptime) {
   static volatile int no_clock_boottime;
   char buf[128];
@@ -0,0 +1,1414 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* io_uring support, enabled with UV_LOOP_USE_IO_URING. A loop owns two rings.
+ *
+ * The poll ring replaces epoll_ctl() and epoll_wait() with one-shot
+ * IORING_OP_POLL_ADD requests. uv__io_poll() in epoll.c remains in charge;
+ * this file only arms watchers and turns completions back into struct
+ * epoll_event.
+ *
+ * Listening and UDP sockets are the exception, they stay in the epoll set.
+ * A poll request holds a reference to its file and the kernel drops the
+ * ring's requests asynchronously when the process exits. Such a socket would
+ * keep its port for a moment after the process is gone and take connections
+ * or datagrams meant for its successor. The ring polls the epoll file
+ * descriptor instead.
+ *
+ * The fs ring runs file system requests that would otherwise go to the
+ * thread pool. Its file descriptor is an ordinary watcher that becomes
+ * readable when requests complete.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+
+#define UV__IORING_SETUP_CQSIZE 8u
+
+#define UV__IORING_FEAT_SINGLE_MMAP 1u
+#define UV__IORING_FEAT_NODROP 2u
+#define UV__IORING_FEAT_EXT_ARG 256u
+
+#define UV__IORING_OP_NOP 0
+#define UV__IORING_OP_READV 1
+#define UV__IORING_OP_WRITEV 2
+#define UV__IORING_OP_FSYNC 3
+#define UV__IORING_OP_POLL_ADD 6
+#define UV__IORING_OP_POLL_REMOVE 7
+#define UV__IORING_OP_OPENAT 18
+#define UV__IORING_OP_CLOSE 19
+#define UV__IORING_OP_STATX 21
+
+#define UV__IORING_FSYNC_DATASYNC 1u
+
+#define UV__IORING_ENTER_GETEVENTS 1u
+#define UV__IORING_ENTER_EXT_ARG 8u
+
+#define UV__IORING_OFF_SQ_RING 0
+#define UV__IORING_OFF_SQES 0x10000000
+
+/* Completions with this bit set in user_data carry no information we are
+ * interested in, like those of IORING_OP_POLL_REMOVE requests.
+ */
+#define UV__IOU_IGNORE ((uint64_t) 1 << 63)
+
+/* Set in the user_data of a file system request that uv_cancel() replaced
+ * with IORING_OP_NOP before it was submitted.
+ */
+#define UV__IOU_CANCELLED ((uint64_t) 1)
+
+struct uv__kernel_timespec {
+  int64_t tv_sec;
+  long long tv_nsec;
+};
+
+/* Per file descriptor state of the poll ring. There is at most one live
+ * poll request per file descriptor. Its user_data is (gen << 32) | fd, with
+ * gen taken from a counter the ring shares between all file descriptors so
+ * that completions of requests that have since been removed or replaced
+ * can be told apart from the live one, even when the state has been dropped
+ * and created anew in the meantime.
+ *
+ * Like loop->watchers, file descriptors below UV__WATCHERS_DENSE_MAX index
+ * an array, higher ones live in a hash table.
+ */
+struct uv__iou_pollfd {
+  uint32_t mask;  /* Events the live request waits for, 0 if none. */
+  uint32_t gen;   /* Generation of the live request, 0 if none. */
+  uint32_t flags;
+};
+
+struct uv__iou_pollslot {
+  int fd;  /* -1 if the slot is free */
+  struct uv__iou_pollfd p;
+};
+
+/* Set in uv__iou_pollfd.mask when the file descriptor is in the epoll set
+ * instead, the other bits then are the events of the one-shot registration.
+ */
+#define UV__IOU_POLL_EPOLL 0x80000000u
+
+/* Set in uv__iou_pollfd.flags for sockets that are always watched through
+ * the epoll set, see uv__iou_poll_use_epoll().
+ */
+#define UV__IOU_POLLFD_USE_EPOLL 1u
+
+
+static int uv__iou_init(struct uv__iou* iou,
+                        uint32_t entries,
+                        uint32_t cqentries) {
+  struct uv__io_uring_params params;
+  size_t cqlen;
+  size_t maxlen;
+  size_t sqlen;
+  size_t sqelen;
+  uint32_t i;
+  char* sq;
+  char* sqe;
+  int ringfd;
+  int err;
+
+  memset(&params, 0, sizeof(params));
+  params.flags = UV__IORING_SETUP_CQSIZE;
+  params.cq_entries = cqentries;
+
+  ringfd = uv__io_uring_setup(entries, &params);
+  if (ringfd == -1)
+    return UV__ERR(errno);
+
+  /* IORING_FEAT_EXT_ARG (linux v5.11) is what we need most, it lets
+   * io_uring_enter() take a timeout and a signal mask. The other two
+   * predate it but check them anyway, the ring relies on them.
+   */
+  err = UV_ENOSYS;
+  if (!(params.features & UV__IORING_FEAT_EXT_ARG))
+    goto fail;
+
+  if (!(params.features & UV__IORING_FEAT_SINGLE_MMAP))
+    goto fail;
+
+  if (!(params.features & UV__IORING_FEAT_NODROP))
+    goto fail;
+
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  maxlen = sqlen < cqlen ? cqlen : sqlen;
+  sqelen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+
+  sq = mmap(0,
+            maxlen,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ringfd,
+            UV__IORING_OFF_SQ_RING);
+
+  if (sq == MAP_FAILED) {
+    err = UV__ERR(errno);
+    goto fail;
+  }
+
+  sqe = mmap(0,
+             sqelen,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ringfd,
+             UV__IORING_OFF_SQES);
+
+  if (sqe == MAP_FAILED) {
+    err = UV__ERR(errno);
+    munmap(sq, maxlen);
+    goto fail;
+  }
+
+  iou->sqhead = (uint32_t*) (sq + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (sq + params.sq_off.tail);
+  iou->sqmask = *(uint32_t*) (sq + params.sq_off.ring_mask);
+  iou->sqarray = (uint32_t*) (sq + params.sq_off.array);
+  iou->sqflags = (uint32_t*) (sq + params.sq_off.flags);
+  iou->cqhead = (uint32_t*) (sq + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (sq + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (sq + params.cq_off.ring_mask);
+  iou->sq = sq;
+  iou->cqe = sq + params.cq_off.cqes;
+  iou->sqe = sqe;
+  iou->sqlen = sqlen;
+  iou->cqlen = cqlen;
+  iou->maxlen = maxlen;
+  iou->sqelen = sqelen;
+  iou->ringfd = ringfd;
+  iou->in_flight = 0;
+  iou->pollfds = NULL;
+  iou->npollfds = 0;
+  iou->pollslots = NULL;
+  iou->pollslots_mask = 0;
+  iou->pollslots_count = 0;
+  iou->pollgen = 0;
+
+  /* Submission queue entries map 1:1 to array slots. */
+  for (i = 0; i <= iou->sqmask; i++)
+    iou->sqarray[i] = i;
+
+  return 0;
+
+fail:
+  uv__close(ringfd);
+  return err;
+}
+
+
+/* Submit queued entries without waiting for completions. */
+static void uv__iou_flush(struct uv__iou* iou) {
+  uint32_t to_submit;
+  int rc;
+
+  for (;;) {
+    to_submit = *iou->sqtail - uv__load_acquire(iou->sqhead);
+    if (to_submit == 0)
+      return;
+
+    rc = uv__io_uring_enter(iou->ringfd, to_submit, 0, 0, NULL, 0);
+    if (rc >= 0)
+      continue;
+
+    if (errno == EINTR)
+      continue;
+
+    /* EAGAIN or EBUSY, the kernel is out of memory or the completion queue
+     * overflowed. Leave the entries in the ring, they are submitted again
+     * by the next io_uring_enter() call.
+     */
+    if (errno == EAGAIN || errno == EBUSY)
+      return;
+
+    abort();
+  }
+}
+
+
+/* Unmap the ring without submitting queued entries. */
+static void uv__iou_unmap(struct uv__iou* iou) {
+  if (iou->ringfd == -1)
+    return;
+
+  munmap(iou->sqe, iou->sqelen);
+  munmap(iou->sq, iou->maxlen);
+  uv__close(iou->ringfd);
+  uv__free(iou->pollfds);
+  uv__free(iou->pollslots);
+
+  iou->ringfd = -1;
+  iou->pollfds = NULL;
+  iou->npollfds = 0;
+  iou->pollslots = NULL;
+  iou->pollslots_mask = 0;
+  iou->pollslots_count = 0;
+}
+
+
+static void uv__iou_delete(struct uv__iou* iou) {
+  if (iou->ringfd == -1)
+    return;
+
+  uv__iou_flush(iou);
+  uv__iou_unmap(iou);
+}
+
+
+/* Returns NULL when the submission queue is full and the kernel won't take
+ * the queued entries.
+ */
+static struct uv__io_uring_sqe* uv__iou_try_get_sqe(struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t mask;
+
+  mask = iou->sqmask;
+  tail = *iou->sqtail;
+  head = uv__load_acquire(iou->sqhead);
+
+  if (tail - head > mask) {
+    /* Ring is full. Make room by submitting what we have. */
+    uv__iou_flush(iou);
+    head = uv__load_acquire(iou->sqhead);
+
+    if (tail - head > mask)
+      return NULL;
+  }
+
+  sqe = iou->sqe;
+  sqe = &sqe[tail & mask];
+  memset(sqe, 0, sizeof(*sqe));
+
+  return sqe;
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+
+  sqe = uv__iou_try_get_sqe(iou);
+  if (sqe == NULL)
+    abort();  /* Like epoll_ctl(), failing to arm a watcher is fatal. */
+
+  return sqe;
+}
+
+
+static void uv__iou_sqe_commit(struct uv__iou* iou) {
+  uv__store_release(iou->sqtail, *iou->sqtail + 1);
+}
+
+
+/* Multiplicative hashing spreads out the runs of consecutive fds. */
+static uint32_t uv__iou_pollfd_hash(int fd, uint32_t mask) {
+  uint32_t h;
+
+  h = (uint32_t) fd * 2654435769u;
+  return (h ^ (h >> 16)) & mask;
+}
+
+
+/* Returns the state of |fd|, NULL if it has none. */
+static struct uv__iou_pollfd* uv__iou_pollfd_find(struct uv__iou* iou,
+                                                  int fd) {
+  struct uv__iou_pollslot* slots;
+  struct uv__iou_pollfd* pollfds;
+  uint32_t mask;
+  uint32_t i;
+
+  if (fd < UV__WATCHERS_DENSE_MAX) {
+    if ((uint32_t) fd >= iou->npollfds)
+      return NULL;
+
+    pollfds = iou->pollfds;
+    return &pollfds[fd];
+  }
+
+  slots = iou->pollslots;
+  if (slots == NULL)
+    return NULL;
+
+  mask = iou->pollslots_mask;
+  for (i = uv__iou_pollfd_hash(fd, mask);
+       slots[i].fd != -1;
+       i = (i + 1) & mask) {
+    if (slots[i].fd == fd)
+      return &slots[i].p;
+  }
+
+  return NULL;
+}
+
+
+static int uv__iou_pollslots_rehash(struct uv__iou* iou, uint32_t nslots) {
+  struct uv__iou_pollslot* slots;
+  struct uv__iou_pollslot* old;
+  uint32_t nold;
+  uint32_t mask;
+  uint32_t i;
+  uint32_t j;
+
+  old = iou->pollslots;
+  nold = old != NULL ? iou->pollslots_mask + 1 : 0;
+
+  slots = NULL;
+  mask = 0;
+
+  if (nslots > 0) {
+    slots = uv__malloc(nslots * sizeof(*slots));
+    if (slots == NULL)
+      return UV_ENOMEM;
+
+    for (i = 0; i < nslots; i++)
+      slots[i].fd = -1;
+
+    mask = nslots - 1;
+    for (i = 0; i < nold; i++) {
+      if (old[i].fd == -1)
+        continue;
+
+      j = uv__iou_pollfd_hash(old[i].fd, mask);
+      while (slots[j].fd != -1)
+        j = (j + 1) & mask;
+
+      slots[j] = old[i];
+    }
+  }
+
+  uv__free(old);
+  iou->pollslots = slots;
+  iou->pollslots_mask = mask;
+
+  return 0;
+}
+
+
+/* Returns the state of |fd|, creating it if necessary. NULL when out of
+ * memory. May move the state of other file descriptors.
+ */
+static struct uv__iou_pollfd* uv__iou_pollfd_get(struct uv__iou* iou,
+                                                 int fd) {
+  struct uv__iou_pollslot* slots;
+  struct uv__iou_pollfd* pollfds;
+  struct uv__iou_pollfd* p;
+  uint32_t nslots;
+  uint32_t mask;
+  uint32_t n;
+  uint32_t i;
+
+  assert(fd >= 0);
+
+  p = uv__iou_pollfd_find(iou, fd);
+  if (p != NULL)
+    return p;
+
+  if (fd < UV__WATCHERS_DENSE_MAX) {
+    n = iou->npollfds;
+    if (n == 0)
+      n = 64;
+
+    while (n <= (uint32_t) fd)
+      n *= 2;
+
+    pollfds = uv__realloc(iou->pollfds, n * sizeof(*pollfds));
+    if (pollfds == NULL)
+      return NULL;
+
+    memset(pollfds + iou->npollfds,
+           0,
+           (n - iou->npollfds) * sizeof(*pollfds));
+
+    iou->pollfds = pollfds;
+    iou->npollfds = n;
+
+    return &pollfds[fd];
+  }
+
+  nslots = 0;
+  if (iou->pollslots != NULL)
+    nslots = iou->pollslots_mask + 1;
+
+  /* Keep the load factor at or below 1/2, probes stay short. */
+  if (2 * (iou->pollslots_count + 1) > nslots)
+    if (uv__iou_pollslots_rehash(iou, nslots > 0 ? 2 * nslots : 16))
+      return NULL;
+
+  slots = iou->pollslots;
+  mask = iou->pollslots_mask;
+  for (i = uv__iou_pollfd_hash(fd, mask);
+       slots[i].fd != -1;
+       i = (i + 1) & mask);
+
+  slots[i].fd = fd;
+  slots[i].p.mask = 0;
+  slots[i].p.gen = 0;
+  slots[i].p.flags = 0;
+  iou->pollslots_count++;
+
+  return &slots[i].p;
+}
+
+
+/* Drops the state of a file descriptor that is going away. Only the hash
+ * table shrinks, the array stays like loop->watchers does.
+ */
+static void uv__iou_pollfd_drop(struct uv__iou* iou, int fd) {
+  struct uv__iou_pollslot* slots;
+  uint32_t nslots;
+  uint32_t mask;
+  uint32_t home;
+  uint32_t i;
+  uint32_t j;
+
+  slots = iou->pollslots;
+  if (fd < UV__WATCHERS_DENSE_MAX || slots == NULL)
+    return;
+
+  mask = iou->pollslots_mask;
+  for (i = uv__iou_pollfd_hash(fd, mask); slots[i].fd != fd; i = (i + 1) & mask)
+    if (slots[i].fd == -1)
+      return;
+
+  /* Shift the rest of the cluster back instead of leaving a tombstone, see
+   * uv__watcher_remove().
+   */
+  for (j = i;;) {
+    j = (j + 1) & mask;
+    if (slots[j].fd == -1)
+      break;
+
+    home = uv__iou_pollfd_hash(slots[j].fd, mask);
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+      continue;
+
+    slots[i] = slots[j];
+    i = j;
+  }
+
+  slots[i].fd = -1;
+  iou->pollslots_count--;
+
+  /* Failing to shrink is harmless, the table stays as it is. */
+  nslots = mask + 1;
+  if (iou->pollslots_count == 0)
+    uv__iou_pollslots_rehash(iou, 0);
+  else if (nslots > 16 && 8 * iou->pollslots_count < nslots)
+    uv__iou_pollslots_rehash(iou, nslots / 2);
+}
+
+
+static uint32_t uv__iou_pollgen_next(struct uv__iou* iou) {
+  iou->pollgen = (iou->pollgen + 1) & 0x7FFFFFFF;
+  if (iou->pollgen == 0)
+    iou->pollgen = 1;
+
+  return iou->pollgen;
+}
+
+
+static uint32_t uv__iou_poll_events(uint32_t events) {
+  events &= POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  /* The kernel reads poll32_events in little endian halfword order. */
+  events = (events << 16) | (events >> 16);
+#endif
+
+  return events;
+}
+
+
+static void uv__iou_poll_remove(struct uv__iou* iou, int fd,
+                                struct uv__iou_pollfd* p) {
+  struct uv__io_uring_sqe* sqe;
+
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = ((uint64_t) p->gen << 32) | (uint32_t) fd;
+  sqe->user_data = UV__IOU_IGNORE;
+  uv__iou_sqe_commit(iou);
+
+  /* The removed request completes with -ECANCELED and an outdated
+   * generation number, making the reaper ignore it.
+   */
+  p->gen = 0;
+  p->mask = 0;
+}
+
+
+static void uv__iou_poll_rearm(uv_loop_t* loop, uv__io_t* w) {
+  if (w->pevents != 0 && QUEUE_EMPTY(&w->watcher_queue)) {
+    w->events = 0; /* Force re-registration in uv__io_poll. */
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+}
+
+
+static int uv__iou_poll_init(uv_loop_t* loop) {
+  struct uv__iou* iou;
+  uv_handle_t* h;
+  QUEUE* q;
+  int err;
+  int fd;
+
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  if (iou->ringfd != -1)
+    return 0;
+
+  /* Every armed watcher can have a completion pending, size the completion
+   * queue generously so it rarely needs the kernel's overflow list.
+   */
+  err = uv__iou_init(iou, 512, 4096);
+  if (err) {
+    iou->ringfd = -1;
+    return err;
+  }
+
+  /* Listening and UDP sockets opened before the ring existed. */
+  QUEUE_FOREACH(q, &loop->handle_queue) {
+    h = QUEUE_DATA(q, uv_handle_t, handle_queue);
+    fd = -1;
+
+    if (h->type == UV_UDP)
+      fd = ((uv_udp_t*) h)->io_watcher.fd;
+    else if (h->flags & UV_HANDLE_LISTENING)
+      fd = uv__stream_fd((uv_stream_t*) h);
+
+    if (fd == -1)
+      continue;
+
+    err = uv__iou_poll_use_epoll(loop, fd);
+    if (err) {
+      uv__iou_delete(iou);
+      return err;
+    }
+  }
+
+  /* Rearm active watchers, possibly watched by epoll until now. */
+  uv__watchers_foreach(loop, uv__iou_poll_rearm);
+
+  return 0;
+}
+
+
+static void uv__iou_fs_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+
+
+static void uv__iou_fs_init(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+  if (lfields->fs_ring.ringfd != -1)
+    return;
+
+  /* The completion queue is twice the size of the submission queue, which
+   * is also the limit for the number of requests in flight.
+   */
+  if (uv__iou_init(&lfields->fs_ring, 256, 512))
+    return;  /* Not fatal, file system requests use the thread pool. */
+
+  QUEUE_INIT(&lfields->fs_ring.reqs);
+  uv__io_init(&lfields->fs_ring_watcher,
+              uv__iou_fs_io,
+              lfields->fs_ring.ringfd);
+  uv__io_start(loop, &lfields->fs_ring_watcher, POLLIN);
+}
+
+
+int uv__iou_loop_init(uv_loop_t* loop) {
+  int err;
+
+  err = uv__iou_poll_init(loop);
+  if (err)
+    return err;
+
+  uv__iou_fs_init(loop);
+
+  return 0;
+}
+
+
+void uv__iou_loop_delete(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+
+  lfields = uv__get_internal_fields(loop);
+
+  if (lfields->fs_ring.ringfd != -1)
+    uv__io_stop(loop, &lfields->fs_ring_watcher, POLLIN);
+
+  uv__iou_delete(&lfields->fs_ring);
+  uv__iou_delete(&lfields->poll_ring);
+}
+
+
+static int uv__iou_fs_done(struct uv__iou* iou, uv_fs_t* req, int res);
+
+
+static void uv__iou_fs_orphaned(struct uv__work* w, int err) {
+  uv_fs_t* req;
+
+  req = container_of(w, uv_fs_t, work_req);
+  uv__iou_fs_done(NULL, req, UV_ECANCELED);
+  uv__req_unregister(req->loop, req);
+  req->cb(req);
+}
+
+
+/* The child shares the rings with the parent. Entries that are queued but
+ * not yet submitted belong to the parent, submitting them from the child
+ * would run the parent's requests twice. Only drop the mappings, the
+ * uv__iou_loop_delete() that follows then has nothing left to do.
+ *
+ * The completions of file system requests in flight go to the parent. The
+ * child reports them as cancelled through the thread pool's done queue,
+ * uv_loop_fork() wakes up the loop once the async handles work again.
+ */
+void uv__iou_loop_fork(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__work* w;
+  QUEUE* q;
+
+  lfields = uv__get_internal_fields(loop);
+
+  if (lfields->fs_ring.ringfd != -1) {
+    uv__io_stop(loop, &lfields->fs_ring_watcher, POLLIN);
+
+    while (!QUEUE_EMPTY(&lfields->fs_ring.reqs)) {
+      q = QUEUE_HEAD(&lfields->fs_ring.reqs);
+      QUEUE_REMOVE(q);
+
+      w = QUEUE_DATA(q, struct uv__work, wq);
+      w->done = uv__iou_fs_orphaned;
+
+      uv_mutex_lock(&loop->wq_mutex);
+      QUEUE_INSERT_TAIL(&loop->wq, q);
+      uv_mutex_unlock(&loop->wq_mutex);
+    }
+  }
+
+  uv__iou_unmap(&lfields->fs_ring);
+  uv__iou_unmap(&lfields->poll_ring);
+}
+
+
+int uv__iou_poll_enabled(const uv_loop_t* loop) {
+  return uv__get_internal_fields(loop)->poll_ring.ringfd != -1;
+}
+
+
+static void uv__iou_poll_add(struct uv__iou* iou,
+                             int fd,
+                             struct uv__iou_pollfd* p,
+                             uint32_t events) {
+  struct uv__io_uring_sqe* sqe;
+
+  p->gen = uv__iou_pollgen_next(iou);
+  p->mask = events;
+
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = uv__iou_poll_events(events);
+  sqe->user_data = ((uint64_t) p->gen << 32) | (uint32_t) fd;
+  uv__iou_sqe_commit(iou);
+}
+
+
+/* Registrations are one-shot like poll requests, an event disables the file
+ * descriptor until uv__iou_poll_arm_pending() rearms its watcher. A watcher
+ * that has been stopped in the meantime then stays quiet.
+ */
+static int uv__iou_poll_arm_epoll(uv_loop_t* loop,
+                                  uv__io_t* w,
+                                  uint32_t events) {
+  struct uv__iou_pollfd* p;
+  struct epoll_event e;
+  struct uv__iou* iou;
+  int op;
+
+  /* The epoll set is watched through a poll request of its own. Create
+   * both states first, creating one may move the other.
+   */
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  if (uv__iou_pollfd_get(iou, loop->backend_fd) == NULL)
+    return UV_ENOMEM;
+
+  if (uv__iou_pollfd_get(iou, w->fd) == NULL)
+    return UV_ENOMEM;
+
+  p = uv__iou_pollfd_find(iou, w->fd);
+
+  if (p->mask == (UV__IOU_POLL_EPOLL | events) && w->events != 0)
+    return 0;
+
+  if (p->mask != 0 && !(p->mask & UV__IOU_POLL_EPOLL))
+    uv__iou_poll_remove(iou, w->fd, p);
+
+  memset(&e, 0, sizeof(e));
+  e.events = events | EPOLLONESHOT;
+  e.data.fd = w->fd;
+
+  op = EPOLL_CTL_ADD;
+  if (p->mask & UV__IOU_POLL_EPOLL)
+    op = EPOLL_CTL_MOD;
+
+  uv__get_loop_metrics(loop)->backend_ctl++;
+  if (epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
+    if (errno != EEXIST && errno != ENOENT)
+      abort();
+
+    op = (op == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(loop->backend_fd, op, w->fd, &e))
+      abort();
+  }
+
+  p->mask = UV__IOU_POLL_EPOLL | events;
+
+  p = uv__iou_pollfd_find(iou, loop->backend_fd);
+  if (p->mask == 0)
+    uv__iou_poll_add(iou, loop->backend_fd, p, POLLIN);
+
+  return 0;
+}
+
+
+static int uv__iou_poll_arm(uv_loop_t* loop, uv__io_t* w) {
+  struct uv__iou_pollfd* p;
+  struct uv__iou* iou;
+  uint32_t events;
+
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  events = w->pevents & (POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI);
+
+  p = uv__iou_pollfd_get(iou, w->fd);
+  if (p == NULL)
+    return UV_ENOMEM;
+
+  if (p->flags & UV__IOU_POLLFD_USE_EPOLL)
+    return uv__iou_poll_arm_epoll(loop, w, events);
+
+  if (p->mask & UV__IOU_POLL_EPOLL)
+    p->mask = 0;  /* The file descriptor now belongs to another watcher. */
+
+  if (p->mask != 0) {
+    /* The live request already covers what we're interested in. Events we
+     * no longer want are filtered out by uv__io_poll() when it completes.
+     * A watcher that starts from scratch may refer to a new file behind
+     * the same file descriptor however, it always gets a new request.
+     */
+    if (w->events != 0 && (events & ~p->mask) == 0)
+      return 0;
+
+    uv__iou_poll_remove(iou, w->fd, p);
+  }
+
+  uv__get_loop_metrics(loop)->backend_ctl++;
+  uv__iou_poll_add(iou, w->fd, p, events);
+
+  return 0;
+}
+
+
+void uv__iou_poll_invalidate_fd(uv_loop_t* loop, int fd) {
+  struct uv__iou_pollfd* p;
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  p = uv__iou_pollfd_find(iou, fd);
+  if (p == NULL)
+    return;
+
+  if (p->mask & UV__IOU_POLL_EPOLL) {
+    /* Closing the file descriptor takes it out of the epoll set. */
+    p->mask = 0;
+  } else if (p->mask != 0) {
+    /* The poll request holds a reference to the file. Submit the removal
+     * right away, the caller is about to close the file descriptor and
+     * expects the socket or pipe to go away with it, like it does with
+     * epoll.
+     */
+    uv__iou_poll_remove(iou, fd, p);
+    uv__iou_flush(iou);
+  }
+
+  p->flags = 0;
+  uv__iou_pollfd_drop(iou, fd);
+}
+
+
+/* A poll request holds a reference to its socket until the kernel tears the
+ * ring down, which happens asynchronously after the process exits. Sockets
+ * that others may want to bind to once we're gone, listening and UDP
+ * sockets, are watched through the epoll set instead. Called by the paths
+ * that create such sockets, the mark goes away when the fd is invalidated.
+ */
+int uv__iou_poll_use_epoll(uv_loop_t* loop, int fd) {
+  struct uv__iou_pollfd* p;
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  if (iou->ringfd == -1)
+    return 0;  /* uv__iou_poll_init() takes care of it. */
+
+  p = uv__iou_pollfd_get(iou, fd);
+  if (p == NULL)
+    return UV_ENOMEM;
+
+  p->flags |= UV__IOU_POLLFD_USE_EPOLL;
+  return 0;
+}
+
+
+/* Arm pending watchers, this includes the ones whose one-shot poll request
+ * completed since the last call, even if uv__io_poll() filtered out the
+ * events. Returns UV_ENOMEM when a watcher's poll state can't be created,
+ * that watcher and the ones after it stay pending.
+ */
+static int uv__iou_poll_arm_pending(uv_loop_t* loop) {
+  struct uv__iou_pollfd* p;
+  struct uv__iou* iou;
+  QUEUE* q;
+  uv__io_t* w;
+  int err;
+
+  while (!QUEUE_EMPTY(&loop->watcher_queue)) {
+    q = QUEUE_HEAD(&loop->watcher_queue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    w = QUEUE_DATA(q, uv__io_t, watcher_queue);
+    assert(w->pevents != 0);
+    assert(w->fd >= 0);
+
+    err = uv__iou_poll_arm(loop, w);
+    if (err) {
+      QUEUE_INSERT_HEAD(&loop->watcher_queue, q);
+      return err;
+    }
+
+    w->events = w->pevents;
+  }
+
+  /* Keep a poll request on the epoll set once it has been used. */
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+  p = uv__iou_pollfd_find(iou, loop->backend_fd);
+  if (p != NULL && p->gen != 0 && p->mask == 0)
+    uv__iou_poll_add(iou, loop->backend_fd, p, POLLIN);
+
+  return 0;
+}
+
+
+/* Move the events of the epoll set to |events|, returns how many. */
+static int uv__iou_poll_reap_epoll(uv_loop_t* loop,
+                                   struct uv__iou* iou,
+                                   struct epoll_event* events,
+                                   int maxevents) {
+  struct uv__iou_pollfd* p;
+  uv__io_t* w;
+  int nevents;
+  int i;
+
+  nevents = epoll_wait(loop->backend_fd, events, maxevents, 0);
+  if (nevents == -1)
+    return 0;  /* EINTR, the epoll set stays readable. */
+
+  for (i = 0; i < nevents; i++) {
+    p = uv__iou_pollfd_find(iou, events[i].data.fd);
+    if (p != NULL)
+      p->mask = UV__IOU_POLL_EPOLL;
+
+    w = uv__watcher_get(loop, events[i].data.fd);
+    if (w != NULL && QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  return nevents;
+}
+
+
+static int uv__iou_poll_reap(uv_loop_t* loop,
+                             struct uv__iou* iou,
+                             struct epoll_event* events,
+                             int maxevents) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou_pollfd* p;
+  uv__io_t* w;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t mask;
+  uint32_t gen;
+  int nevents;
+  int fd;
+
+  head = *iou->cqhead;
+  tail = uv__load_acquire(iou->cqtail);
+  mask = iou->cqmask;
+  nevents = 0;
+
+  for (; head != tail && nevents < maxevents; head++) {
+    cqe = iou->cqe;
+    cqe = &cqe[head & mask];
+
+    if (cqe->user_data & UV__IOU_IGNORE)
+      continue;
+
+    fd = (int) (uint32_t) cqe->user_data;
+    gen = (uint32_t) (cqe->user_data >> 32);
+
+    p = uv__iou_pollfd_find(iou, fd);
+    if (p == NULL || p->gen != gen)
+      continue;  /* Removed or replaced in the meantime. */
+
+    /* The request is one-shot, rearm the watcher on the next tick. */
+    p->mask = 0;
+
+    if (fd == loop->backend_fd) {
+      nevents += uv__iou_poll_reap_epoll(loop,
+                                         iou,
+                                         events + nevents,
+                                         maxevents - nevents);
+      continue;
+    }
+
+    w = uv__watcher_get(loop, fd);
+    if (w == NULL)
+      continue;
+
+    if (QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+    if (cqe->res < 0)
+      events[nevents].events = POLLERR;
+    else
+      events[nevents].events = cqe->res;
+
+    events[nevents].data.fd = fd;
+    nevents++;
+  }
+
+  uv__store_release(iou->cqhead, head);
+
+  return nevents;
+}
+
+
+/* Like epoll_pwait(): returns the number of events stored in |events|,
+ * 0 on timeout or -1 with errno set to EINTR.
+ */
+int uv__iou_poll_wait(uv_loop_t* loop,
+                      struct epoll_event* events,
+                      int maxevents,
+                      int timeout,
+                      const sigset_t* sigset) {
+  struct uv__io_uring_getevents_arg arg;
+  struct uv__kernel_timespec ts;
+  struct uv__iou* iou;
+  unsigned min_complete;
+  unsigned flags;
+  uint32_t to_submit;
+  int nevents;
+  int err;
+  int rc;
+
+  iou = &uv__get_internal_fields(loop)->poll_ring;
+
+  memset(&arg, 0, sizeof(arg));
+  if (sigset != NULL) {
+    arg.sigmask = (uintptr_t) sigset;
+    arg.sigmask_sz = _NSIG / 8;
+  }
+
+  if (timeout > 0) {
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000LL;
+    arg.ts = (uintptr_t) &ts;
+  }
+
+  for (;;) {
+    /* Out of memory, some watchers aren't armed. Don't block, they are
+     * retried on the next pass.
+     */
+    err = uv__iou_poll_arm_pending(loop);
+
+    flags = UV__IORING_ENTER_EXT_ARG;
+    min_complete = 0;
+
+    if (timeout != 0 &&
+        err == 0 &&
+        *iou->cqhead == uv__load_acquire(iou->cqtail)) {
+      flags |= UV__IORING_ENTER_GETEVENTS;
+      min_complete = 1;
+    }
+
+    to_submit = *iou->sqtail - uv__load_acquire(iou->sqhead);
+
+    if (to_submit != 0 || min_complete != 0) {
+      rc = uv__io_uring_enter(iou->ringfd,
+                              to_submit,
+                              min_complete,
+                              flags,
+                              &arg,
+                              sizeof(arg));
+
+      if (rc == -1) {
+        if (errno == EINTR)
+          return -1;
+
+        /* ETIME is the timeout expiring, EAGAIN and EBUSY mean the kernel
+         * couldn't take the submissions right now. Reap what's there.
+         */
+        if (errno != ETIME && errno != EAGAIN && errno != EBUSY)
+          abort();
+      }
+    }
+
+    nevents = uv__iou_poll_reap(loop, iou, events, maxevents);
+
+    /* uv__io_poll() doesn't expect a timeout when blocking indefinitely,
+     * go back to sleep if all we got were stale completions.
+     */
+    if (nevents != 0 || timeout != -1)
+      return nevents;
+  }
+}
+
+
+static void uv__iou_fs_prep(uv_fs_t* req, struct uv__io_uring_sqe* sqe) {
+  unsigned int iovmax;
+  unsigned int nbufs;
+
+  sqe->user_data = (uintptr_t) req;
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    sqe->opcode = UV__IORING_OP_CLOSE;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_FDATASYNC:
+    sqe->fsync_flags = UV__IORING_FSYNC_DATASYNC;
+    /* Fall through. */
+  case UV_FS_FSYNC:
+    sqe->opcode = UV__IORING_OP_FSYNC;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_OPEN:
+    sqe->opcode = UV__IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = req->mode;
+    sqe->open_flags = req->flags | O_CLOEXEC;
+    break;
+
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    iovmax = uv__getiovmax();
+    nbufs = req->nbufs;
+    if (nbufs > iovmax)
+      nbufs = iovmax;
+
+    /* Like uv__fs_read(), reads are truncated to IOV_MAX buffers. Writes
+     * pick up the rest when the first batch completes.
+     */
+    if (req->fs_type == UV_FS_READ)
+      req->nbufs = nbufs;
+
+    sqe->opcode = req->fs_type == UV_FS_READ ? UV__IORING_OP_READV
+                                             : UV__IORING_OP_WRITEV;
+    sqe->fd = req->file;
+    sqe->addr = (uintptr_t) req->bufs;
+    sqe->len = nbufs;
+    sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+    break;
+
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    sqe->opcode = UV__IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->addr2 = (uintptr_t) req->ptr;
+    sqe->len = 0xFFF; /* STATX_BASIC_STATS + STATX_BTIME */
+
+    if (req->fs_type == UV_FS_FSTAT) {
+      sqe->fd = req->file;
+      sqe->addr = (uintptr_t) "";
+      sqe->statx_flags = 0x1000; /* AT_EMPTY_PATH */
+    }
+
+    if (req->fs_type == UV_FS_LSTAT)
+      sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+    break;
+
+  default:
+    abort();
+  }
+}
+
+
+/* Submit |req| to the fs ring. Returns 0 when the ring can't take it, the
+ * caller then hands it to the thread pool.
+ */
+int uv__iou_fs_post(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->fs_ring;
+  if (iou->ringfd == -1)
+    return 0;
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+  case UV_FS_FDATASYNC:
+  case UV_FS_FSTAT:
+  case UV_FS_FSYNC:
+  case UV_FS_LSTAT:
+  case UV_FS_OPEN:
+  case UV_FS_READ:
+  case UV_FS_STAT:
+  case UV_FS_WRITE:
+    break;
+  default:
+    return 0;
+  }
+
+  /* Never have more requests in flight than fit in the completion queue,
+   * that way it can't overflow.
+   */
+  if (iou->in_flight > iou->cqmask)
+    return 0;
+
+  sqe = uv__iou_try_get_sqe(iou);
+  if (sqe == NULL)
+    return 0;
+
+  if (req->fs_type == UV_FS_FSTAT ||
+      req->fs_type == UV_FS_LSTAT ||
+      req->fs_type == UV_FS_STAT) {
+    req->ptr = uv__malloc(sizeof(struct uv__statx));
+    if (req->ptr == NULL)
+      return 0;  /* The entry isn't committed, the next caller reuses it. */
+  }
+
+  uv__iou_fs_prep(req, sqe);
+  uv__iou_sqe_commit(iou);
+  iou->in_flight++;
+
+  /* No work callback tells uv_cancel() to come to uv__iou_fs_cancel(). */
+  req->work_req.loop = loop;
+  req->work_req.work = NULL;
+  req->work_req.done = NULL;
+  QUEUE_INSERT_TAIL(&iou->reqs, &req->work_req.wq);
+
+  return 1;
+}
+
+
+/* A request can be cancelled until uv__iou_fs_flush() hands it to the
+ * kernel. Its entry is turned into a no-op that completes it with
+ * UV_ECANCELED.
+ */
+int uv__iou_fs_cancel(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+  uint32_t head;
+  uint32_t tail;
+
+  iou = &uv__get_internal_fields(loop)->fs_ring;
+  if (iou->ringfd == -1 || QUEUE_EMPTY(&req->work_req.wq))
+    return UV_EBUSY;
+
+  /* Part of the data has been written already. */
+  if (req->fs_type == UV_FS_WRITE && req->result != 0)
+    return UV_EBUSY;
+
+  tail = *iou->sqtail;
+  for (head = uv__load_acquire(iou->sqhead); head != tail; head++) {
+    sqe = iou->sqe;
+    sqe = &sqe[head & iou->sqmask];
+
+    if (sqe->user_data != (uintptr_t) req)
+      continue;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = UV__IORING_OP_NOP;
+    sqe->user_data = (uintptr_t) req | UV__IOU_CANCELLED;
+    return 0;
+  }
+
+  return UV_EBUSY;
+}
+
+
+/* Submissions are batched, uv__io_poll() calls this before it blocks. */
+void uv__iou_fs_flush(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->fs_ring;
+  if (iou->ringfd != -1)
+    uv__iou_flush(iou);
+}
+
+
+/* Returns 1 when the request was resubmitted to finish a short write. */
+static int uv__iou_fs_write_done(struct uv__iou* iou, uv_fs_t* req, int res) {
+  struct uv__io_uring_sqe* sqe;
+  unsigned int n;
+  size_t size;
+
+  if (res <= 0) {
+    if (req->result == 0)
+      req->result = res;
+    return 0;
+  }
+
+  req->result += res;
+  if (req->off >= 0)
+    req->off += res;
+
+  /* Drop the buffers that have been written, like uv__fs_write_all(). */
+  size = res;
+  for (n = 0; n < req->nbufs && req->bufs[n].len <= size; n++)
+    size -= req->bufs[n].len;
+
+  if (n < req->nbufs && size > 0) {
+    req->bufs[n].base += size;
+    req->bufs[n].len -= size;
+  }
+
+  req->nbufs -= n;
+  if (req->nbufs == 0)
+    return 0;
+
+  memmove(req->bufs, req->bufs + n, req->nbufs * sizeof(*req->bufs));
+
+  sqe = uv__iou_try_get_sqe(iou);
+  if (sqe == NULL)
+    return 0;  /* Report a short write. */
+
+  uv__iou_fs_prep(req, sqe);
+  uv__iou_sqe_commit(iou);
+  iou->in_flight++;
+
+  return 1;
+}
+
+
+static int uv__iou_fs_done(struct uv__iou* iou, uv_fs_t* req, int res) {
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    /* Same as uv__fs_close(), the file descriptor is gone either way. */
+    if (res == UV_EINTR || res == UV__ERR(EINPROGRESS))
+      res = 0;
+    break;
+
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    if (res == 0)
+      uv__statx_to_stat(req->ptr, &req->statbuf);
+
+    uv__free(req->ptr);
+    req->ptr = NULL;
+
+    if (res == 0)
+      req->ptr = &req->statbuf;
+    break;
+
+  case UV_FS_WRITE:
+    if (uv__iou_fs_write_done(iou, req, res))
+      return 1;
+
+    res = req->result;
+    /* Fall through. */
+  case UV_FS_READ:
+    /* Early cleanup of bufs allocation, like uv__fs_read(). */
+    if (req->bufs != req->bufsml)
+      uv__free(req->bufs);
+
+    req->bufs = NULL;
+    req->nbufs = 0;
+    break;
+
+  default:
+    break;
+  }
+
+  req->result = res;
+  return 0;
+}
+
+
+static void uv__iou_fs_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou* iou;
+  uv_fs_t* req;
+  uint32_t head;
+  uint32_t tail;
+  int res;
+
+  iou = &uv__get_internal_fields(loop)->fs_ring;
+  assert(w == &uv__get_internal_fields(loop)->fs_ring_watcher);
+
+  for (;;) {
+    head = *iou->cqhead;
+    tail = uv__load_acquire(iou->cqtail);
+
+    if (head == tail)
+      break;
+
+    cqe = iou->cqe;
+    cqe = &cqe[head & iou->cqmask];
+    req = (uv_fs_t*) (uintptr_t) (cqe->user_data & ~UV__IOU_CANCELLED);
+    res = cqe->res;
+
+    if (cqe->user_data & UV__IOU_CANCELLED)
+      res = UV_ECANCELED;
+
+    /* Release the entry before running the callback, which may submit new
+     * requests.
+     */
+    uv__store_release(iou->cqhead, head + 1);
+    iou->in_flight--;
+
+    if (uv__iou_fs_done(iou, req, res))
+      continue;
+
+    QUEUE_REMOVE(&req->work_req.wq);
+    QUEUE_INIT(&req->work_req.wq);
+    uv__req_unregister(loop, req);
+    req->cb(req);
+  }
+}
@@ -140,6 +140,21 @@
 # endif
 #endif /* __NR_getrandom */
 
+/* The io_uring system calls have the same number on all architectures
+ * except alpha, which libuv doesn't support.
+ */
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup 425
+#endif /* __NR_io_uring_setup */
+
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter 426
+#endif /* __NR_io_uring_enter */
+
+#ifndef __NR_io_uring_register
+# define __NR_io_uring_register 427
+#endif /* __NR_io_uring_register */
+
 struct uv__mmsghdr;
 
 int uv__sendmmsg(int fd, struct uv__mmsghdr* mmsg, unsigned int vlen) {
@@ -262,3 +277,41 @@ ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags) {
   return syscall(__NR_getrandom, buf, buflen, flags);
 #endif
 }
+
+
+int uv__io_uring_setup(int entries, struct uv__io_uring_params* params) {
+#if defined(__ANDROID_API__) && __ANDROID_API__ < 30
+  return errno = ENOSYS, -1;
+#else
+  return syscall(__NR_io_uring_setup, entries, params);
+#endif
+}
+
+
+int uv__io_uring_enter(int fd,
+                       unsigned to_submit,
+                       unsigned min_complete,
+                       unsigned flags,
+                       const void* arg,
+                       size_t argsz) {
+#if defined(__ANDROID_API__) && __ANDROID_API__ < 30
+  return errno = ENOSYS, -1;
+#else
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 arg,
+                 argsz);
+#endif
+}
+
+
+int uv__io_uring_register(int fd, unsigned opcode, void* arg, unsigned nargs) {
+#if defined(__ANDROID_API__) && __ANDROID_API__ < 30
+  return errno = ENOSYS, -1;
+#else
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+#endif
+}
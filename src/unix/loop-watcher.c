@@ -49,13 +49,17 @@
     uv_##name##_t* h;                                                         \
     QUEUE queue;                                                              \
     QUEUE* q;                                                                 \
+    uint64_t start;                                                           \
     QUEUE_MOVE(&loop->name##_handles, &queue);                                \
     while (!QUEUE_EMPTY(&queue)) {                                            \
       q = QUEUE_HEAD(&queue);                                                 \
       h = QUEUE_DATA(q, uv_##name##_t, queue);                                \
       QUEUE_REMOVE(q);                                                        \
       QUEUE_INSERT_TAIL(&loop->name##_handles, q);                            \
+      start = uv__slow_cb_start(loop);                                        \
       h->name##_cb(h);                                                        \
+      uv__slow_cb_end(loop, start, UV_METRICS_PHASE_##type, UV_##type, -1);   \
+      uv__metrics_inc_callbacks(loop, 1);                                     \
     }                                                                         \
   }                                                                           \
                                                                               \
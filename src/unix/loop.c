@@ -30,6 +30,7 @@
 int uv_loop_init(uv_loop_t* loop) {
   uv__loop_internal_fields_t* lfields;
   void* saved_data;
+  const char* val;
   int err;
 
 
@@ -61,6 +62,8 @@ int uv_loop_init(uv_loop_t* loop) {
   loop->nwatchers = 0;
   QUEUE_INIT(&loop->pending_queue);
   QUEUE_INIT(&loop->watcher_queue);
+  QUEUE_INIT(&lfields->deferred_reads);
+  lfields->read_budget = UV__READ_BUDGET;
 
   loop->closing_handles = NULL;
   uv__update_time(loop);
@@ -102,6 +105,11 @@ int uv_loop_init(uv_loop_t* loop) {
   uv__handle_unref(&loop->wq_async);
   loop->wq_async.flags |= UV_HANDLE_INTERNAL;
 
+  /* Best effort, timers stay in the heap if this fails. */
+  val = getenv("UV_USE_TIMER_WHEEL");
+  if (val != NULL && atoi(val) > 0)
+    uv__timer_wheel_init(loop);
+
   return 0;
 
 fail_async_init:
@@ -129,10 +137,24 @@ fail_metrics_mutex_init:
 }
 
 
+static void uv__loop_fork_rearm(uv_loop_t* loop, uv__io_t* w) {
+  /* An idle edge-triggered watcher, it registers again when started. */
+  if (w->pevents == 0) {
+    w->events = 0;
+    uv__watcher_set(loop, w->fd, NULL);
+    loop->nfds--;
+    return;
+  }
+
+  if (QUEUE_EMPTY(&w->watcher_queue)) {
+    w->events = 0; /* Force re-registration in uv__io_poll. */
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+}
+
+
 int uv_loop_fork(uv_loop_t* loop) {
   int err;
-  unsigned int i;
-  uv__io_t* w;
 
   err = uv__io_fork(loop);
   if (err)
@@ -142,21 +164,18 @@ int uv_loop_fork(uv_loop_t* loop) {
   if (err)
     return err;
 
+  /* Deliver requests that uv__io_fork() had to abandon, if any. */
+  uv_mutex_lock(&loop->wq_mutex);
+  if (!QUEUE_EMPTY(&loop->wq))
+    uv_async_send(&loop->wq_async);
+  uv_mutex_unlock(&loop->wq_mutex);
+
   err = uv__signal_loop_fork(loop);
   if (err)
     return err;
 
   /* Rearm all the watchers that aren't re-queued by the above. */
-  for (i = 0; i < loop->nwatchers; i++) {
-    w = loop->watchers[i];
-    if (w == NULL)
-      continue;
-
-    if (w->pevents != 0 && QUEUE_EMPTY(&w->watcher_queue)) {
-      w->events = 0; /* Force re-registration in uv__io_poll. */
-      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
-    }
-  }
+  uv__watchers_foreach(loop, uv__loop_fork_rearm);
 
   return 0;
 }
@@ -202,7 +221,11 @@ void uv__loop_close(uv_loop_t* loop) {
   loop->nwatchers = 0;
 
   lfields = uv__get_internal_fields(loop);
+  uv__free(lfields->sparse_watchers);
+  lfields->sparse_watchers = NULL;
+  lfields->sparse_watchers_count = 0;
   uv_mutex_destroy(&lfields->loop_metrics.lock);
+  uv__free(lfields->loop_metrics.phases);
   uv__free(lfields);
   loop->internal_fields = NULL;
 }
@@ -210,6 +233,11 @@ void uv__loop_close(uv_loop_t* loop) {
 
 int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
   uv__loop_internal_fields_t* lfields;
+  unsigned int reads;
+  size_t bytes;
+#if defined(__linux__)
+  int err;
+#endif
 
   lfields = uv__get_internal_fields(loop);
   if (option == UV_METRICS_IDLE_TIME) {
@@ -217,6 +245,44 @@ int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
     return 0;
   }
 
+  if (option == UV_METRICS_PHASES)
+    return uv__metrics_phases_init(loop);
+
+  if (option == UV_LOOP_READ_BUDGET) {
+    reads = va_arg(ap, unsigned int);
+    bytes = va_arg(ap, size_t);
+    if (reads == 0 && bytes == 0)
+      return UV_EINVAL;
+
+    lfields->read_budget = reads;
+    lfields->read_budget_bytes = bytes;
+    return 0;
+  }
+
+  if (option == UV_LOOP_READ_ROUND_ROBIN) {
+    loop->flags |= UV_LOOP_DEFER_READS;
+    return 0;
+  }
+
+#if defined(__linux__)
+  if (option == UV_LOOP_USE_IO_URING) {
+    err = uv__iou_loop_init(loop);
+    if (err)
+      return err;
+
+    loop->flags |= UV_LOOP_ENABLE_IO_URING;
+    return 0;
+  }
+
+  if (option == UV_LOOP_USE_EDGE_TRIGGERED) {
+    loop->flags |= UV_LOOP_EDGE_TRIGGERED;
+    return 0;
+  }
+
+  if (option == UV_LOOP_BUSY_POLL)
+    return uv__epoll_busy_poll(loop, va_arg(ap, unsigned int));
+#endif
+
   if (option != UV_LOOP_BLOCK_SIGNAL)
     return UV_ENOSYS;
 
@@ -680,7 +680,6 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
     stream= container_of(w, uv_stream_t, io_watcher);
 
-    assert(w->fd < (int) loop->nwatchers);
 
     e.events = w->pevents;
     e.fd = w->fd;
@@ -800,9 +799,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       }
 
       assert(fd >= 0);
-      assert((unsigned) fd < loop->nwatchers);
 
-      w = loop->watchers[fd];
+      w = uv__watcher_get(loop, fd);
 
       if (w == NULL) {
         /* File descriptor that we've stopped watching, disarm it.
@@ -826,13 +824,15 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
       if (pe->events != 0) {
         uv__metrics_update_idle_time(loop);
-        w->cb(loop, w, pe->events);
+        uv__io_dispatch(loop, w, pe->events, UV_METRICS_PHASE_POLL);
         nevents++;
       }
     }
     loop->watchers[loop->nwatchers] = NULL;
     loop->watchers[loop->nwatchers + 1] = NULL;
 
+    uv__metrics_inc_events(loop, nevents);
+
     if (reset_timeout != 0) {
       timeout = user_timeout;
       reset_timeout = 0;
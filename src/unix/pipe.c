@@ -92,6 +92,8 @@ err_socket:
 
 
 int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb) {
+  int err;
+
   if (uv__stream_fd(handle) == -1)
     return UV_EINVAL;
 
@@ -110,8 +112,15 @@ int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb) {
   if (listen(uv__stream_fd(handle), backlog))
     return UV__ERR(errno);
 
+  err = uv__iou_poll_use_epoll(handle->loop, uv__stream_fd(handle));
+  if (err)
+    return err;
+
+  handle->flags |= UV_HANDLE_LISTENING;
   handle->connection_cb = cb;
   handle->io_watcher.cb = uv__server_io;
+  /* uv__server_io() doesn't always accept until EAGAIN. */
+  handle->flags &= ~UV_HANDLE_EDGE_TRIGGERED;
   uv__io_start(handle->loop, &handle->io_watcher, POLLIN);
   return 0;
 }
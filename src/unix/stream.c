@@ -35,6 +35,12 @@
 #include <unistd.h>
 #include <limits.h> /* IOV_MAX */
 
+/* Upper bound on the buffers that uv__write() gathers from queued requests
+ * for a single writev(), uv__getiovmax() permitting. The array lives on the
+ * stack, longer queues go out in several writev() calls.
+ */
+#define UV__WRITE_GATHER_MAX 64
+
 #if defined(__APPLE__)
 # include <sys/event.h>
 # include <sys/time.h>
@@ -63,7 +69,7 @@ struct uv__stream_select_s {
 static void uv__stream_connect(uv_stream_t*);
 static void uv__write(uv_stream_t* stream);
 static void uv__read(uv_stream_t* stream);
-static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+static int uv__stream_queue_fd(uv_stream_t* stream, int fd);
 static void uv__write_callbacks(uv_stream_t* stream);
 static size_t uv__write_req_size(uv_write_t* req);
 
@@ -85,6 +91,7 @@ void uv__stream_init(uv_loop_t* loop,
   stream->delayed_error = 0;
   QUEUE_INIT(&stream->write_queue);
   QUEUE_INIT(&stream->write_completed_queue);
+  stream->u.reserved[0] = NULL;
   stream->write_queue_size = 0;
 
   if (loop->emfile_fd == -1) {
@@ -393,6 +400,7 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
 #if defined(__APPLE__)
   int enable;
 #endif
+  int err;
 
   if (!(stream->io_watcher.fd == -1 || stream->io_watcher.fd == fd))
     return UV_EBUSY;
@@ -409,6 +417,12 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
         uv__tcp_keepalive(fd, 1, 60)) {
       return UV__ERR(errno);
     }
+
+    if (stream->flags & UV_HANDLE_TCP_ZEROCOPY) {
+      err = uv__tcp_zerocopy_sockopt(fd, 1);
+      if (err)
+        return err;
+    }
   }
 
 #if defined(__APPLE__)
@@ -422,6 +436,16 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
 
   stream->io_watcher.fd = fd;
 
+  if ((stream->loop->flags & UV_LOOP_EDGE_TRIGGERED) &&
+      (stream->type == UV_TCP || stream->type == UV_NAMED_PIPE)) {
+    stream->flags |= UV_HANDLE_EDGE_TRIGGERED;
+  }
+
+#if defined(__linux__)
+  if (stream->type == UV_TCP)
+    uv__epoll_busy_poll_fd(stream->loop, fd);
+#endif
+
   return 0;
 }
 
@@ -451,6 +475,12 @@ void uv__stream_destroy(uv_stream_t* stream) {
     stream->connect_req = NULL;
   }
 
+  /* Written but maybe not yet sent zero-copy writes complete first, they're
+   * older than what is still queued.
+   */
+  if (stream->type == UV_TCP)
+    uv__tcp_zerocopy_destroy((uv_tcp_t*) stream);
+
   uv__stream_flush_write_queue(stream, UV_ECANCELED);
   uv__write_callbacks(stream);
 
@@ -466,6 +496,32 @@ void uv__stream_destroy(uv_stream_t* stream) {
   }
 
   assert(stream->write_queue_size == 0);
+
+  uv__free(uv__stream_ext(stream));
+  stream->u.reserved[0] = NULL;
+}
+
+
+/* Returns the stream's struct uv__stream_ext, allocates it the first time.
+ * NULL when out of memory.
+ */
+struct uv__stream_ext* uv__stream_ext_alloc(uv_stream_t* stream) {
+  struct uv__stream_ext* ext;
+
+  ext = uv__stream_ext(stream);
+  if (ext != NULL)
+    return ext;
+
+  ext = uv__calloc(1, sizeof(*ext));
+  if (ext == NULL)
+    return NULL;
+
+  ext->stream = stream;
+  QUEUE_INIT(&ext->deferred_queue);
+  QUEUE_INIT(&ext->zerocopy.pending);
+  stream->u.reserved[0] = ext;
+
+  return ext;
 }
 
 
@@ -511,8 +567,85 @@ static int uv__emfile_trick(uv_loop_t* loop, int accept_fd) {
 #endif /* defined(UV_HAVE_KQUEUE) */
 
 
+/* Takes up to `batch` connections off the backlog with back to back accept()
+ * calls before any callback runs. Those that don't go to another loop wait in
+ * accepted_fd and queued_fds, where uv_accept() picks them up.
+ */
+static void uv__server_io_batch(uv_loop_t* loop,
+                                uv_stream_t* stream,
+                                unsigned int batch) {
+  unsigned int n;
+  int err;
+  int fd;
+
+  err = 0;
+
+  for (n = 0; n < batch; n++) {
+#if defined(UV_HAVE_KQUEUE)
+    if (stream->io_watcher.rcount <= 0)
+      break;
+#endif /* defined(UV_HAVE_KQUEUE) */
+
+    fd = uv__accept(uv__stream_fd(stream));
+    if (fd < 0) {
+      if (fd == UV_EAGAIN || fd == UV__ERR(EWOULDBLOCK))
+        break;  /* Not an error. */
+
+      if (fd == UV_ECONNABORTED)
+        continue;  /* Ignore. Nothing we can do about that. */
+
+      err = fd;
+      if (err == UV_EMFILE || err == UV_ENFILE) {
+        err = uv__emfile_trick(loop, uv__stream_fd(stream));
+        if (err == UV_EAGAIN || err == UV__ERR(EWOULDBLOCK))
+          err = 0;
+      }
+      break;
+    }
+
+    UV_DEC_BACKLOG((&stream->io_watcher))
+
+    if (stream->type == UV_TCP &&
+        uv__tcp_accept_handoff((uv_tcp_t*) stream, fd) == 0) {
+      continue;
+    }
+
+    if (stream->accepted_fd == -1) {
+      stream->accepted_fd = fd;
+    } else {
+      err = uv__stream_queue_fd(stream, fd);
+      if (err) {
+        uv__close(fd);
+        break;
+      }
+    }
+  }
+
+  /* Once per connection for as long as the user keeps accepting, whether
+   * one per callback or all of them in the first.
+   */
+  while (stream->accepted_fd != -1) {
+    fd = stream->accepted_fd;
+    stream->connection_cb(stream, 0);
+
+    if (uv__stream_fd(stream) == -1)
+      return;  /* connection_cb closed the server. */
+
+    if (stream->accepted_fd == fd) {
+      /* Not accepted, wait until uv_accept() drained the queue. */
+      uv__io_stop(loop, &stream->io_watcher, POLLIN);
+      return;
+    }
+  }
+
+  if (err != 0)
+    stream->connection_cb(stream, err);
+}
+
+
 void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   uv_stream_t* stream;
+  unsigned int batch;
   int err;
 
   stream = container_of(w, uv_stream_t, io_watcher);
@@ -522,6 +655,14 @@ void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
 
+  if (stream->type == UV_TCP) {
+    batch = uv__tcp_accept_batch((uv_tcp_t*) stream);
+    if (batch != 0) {
+      uv__server_io_batch(loop, stream, batch);
+      return;
+    }
+  }
+
   /* connection_cb can close the server socket while we're
    * in the loop so check it on each iteration.
    */
@@ -670,6 +811,10 @@ static void uv__drain(uv_stream_t* stream) {
   uv__io_stop(stream->loop, &stream->io_watcher, POLLOUT);
   uv__stream_osx_interrupt_select(stream);
 
+  /* Let the zero-copy writes complete before their shutdown request. */
+  if (stream->type == UV_TCP && uv__tcp_zerocopy_pending((uv_tcp_t*) stream))
+    return;
+
   /* Shutdown? */
   if ((stream->flags & UV_HANDLE_SHUTTING) &&
       !(stream->flags & UV_HANDLE_CLOSING) &&
@@ -714,30 +859,37 @@ static size_t uv__write_req_size(uv_write_t* req) {
 }
 
 
-/* Returns 1 if all write request data has been written, or 0 if there is still
- * more data to write.
+/* Consumes up to `*n` bytes of the request's data, subtracting what it took
+ * from `*n`. Returns 1 if all write request data has been written, or 0 if
+ * there is still more data to write.
  *
  * Note: the return value only says something about the *current* request.
  * There may still be other write requests sitting in the queue.
  */
 static int uv__write_req_update(uv_stream_t* stream,
                                 uv_write_t* req,
-                                size_t n) {
+                                size_t* n) {
   uv_buf_t* buf;
+  uv_buf_t* end;
   size_t len;
 
-  assert(n <= stream->write_queue_size);
-  stream->write_queue_size -= n;
+  assert(*n <= stream->write_queue_size);
 
   buf = req->bufs + req->write_index;
+  end = req->bufs + req->nbufs;
 
-  do {
-    len = n < buf->len ? n : buf->len;
+  while (buf != end) {
+    len = *n < buf->len ? *n : buf->len;
     buf->base += len;
     buf->len -= len;
-    buf += (buf->len == 0);  /* Advance to next buffer if this one is empty. */
-    n -= len;
-  } while (n > 0);
+    stream->write_queue_size -= len;
+    *n -= len;
+
+    if (buf->len != 0)
+      break;
+
+    buf++;  /* Advance to next buffer, this one is empty. */
+  }
 
   req->write_index = buf - req->bufs;
 
@@ -763,6 +915,9 @@ static void uv__write_req_finish(uv_write_t* req) {
     req->bufs = NULL;
   }
 
+  if (stream->type == UV_TCP && uv__tcp_zerocopy_defer((uv_tcp_t*) stream, req))
+    return;
+
   /* Add it to the write_completed_queue where it will have its
    * callback called in the near future.
    */
@@ -788,7 +943,8 @@ static int uv__handle_fd(uv_handle_t* handle) {
 static int uv__try_write(uv_stream_t* stream,
                          const uv_buf_t bufs[],
                          unsigned int nbufs,
-                         uv_stream_t* send_handle) {
+                         uv_stream_t* send_handle,
+                         int flags) {
   struct iovec* iov;
   int iovmax;
   int iovcnt;
@@ -853,6 +1009,20 @@ static int uv__try_write(uv_stream_t* stream,
     do
       n = sendmsg(uv__stream_fd(stream), &msg, 0);
     while (n == -1 && errno == EINTR);
+  } else if (flags != 0) {
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    do
+      n = sendmsg(uv__stream_fd(stream), &msg, flags);
+    while (n == -1 && errno == EINTR);
+
+    /* Out of memory for completion notifications, copying still works. */
+    if (n == -1 && errno == ENOBUFS)
+      return UV_ENOBUFS;
   } else {
     do
       n = uv__writev(uv__stream_fd(stream), iov, iovcnt);
@@ -882,10 +1052,52 @@ static int uv__try_write(uv_stream_t* stream,
   return UV__ERR(errno);
 }
 
-static void uv__write(uv_stream_t* stream) {
+/* Collects the unwritten buffers of the queued requests, starting with the
+ * head of the queue, into `bufs`. Stops at a request that sends a handle, the
+ * handle goes out with the first byte of its request. Returns the number of
+ * buffers and stores their total size in `*size`.
+ */
+static unsigned int uv__write_gather(uv_stream_t* stream,
+                                     uv_buf_t* bufs,
+                                     unsigned int nbufs,
+                                     size_t* size) {
+  uv_write_t* req;
+  unsigned int n;
+  unsigned int i;
   QUEUE* q;
+
+  n = 0;
+  *size = 0;
+
+  QUEUE_FOREACH(q, &stream->write_queue) {
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (n > 0 && req->send_handle != NULL)
+      break;
+
+    for (i = req->write_index; i < req->nbufs && n < nbufs; i++) {
+      bufs[n] = req->bufs[i];
+      *size += bufs[n].len;
+      n++;
+    }
+
+    if (n == nbufs || req->send_handle != NULL)
+      break;
+  }
+
+  return n;
+}
+
+
+static void uv__write(uv_stream_t* stream) {
+  uv_buf_t gathered[UV__WRITE_GATHER_MAX];
+  unsigned int nbufs;
   uv_write_t* req;
+  uv_buf_t* bufs;
+  size_t size;
+  size_t left;
   ssize_t n;
+  QUEUE* q;
+  int flags;
 
   assert(uv__stream_fd(stream) >= 0);
 
@@ -897,18 +1109,52 @@ static void uv__write(uv_stream_t* stream) {
     req = QUEUE_DATA(q, uv_write_t, queue);
     assert(req->handle == stream);
 
-    n = uv__try_write(stream,
-                      &(req->bufs[req->write_index]),
-                      req->nbufs - req->write_index,
-                      req->send_handle);
+    if (QUEUE_NEXT(q) == &stream->write_queue || req->send_handle != NULL) {
+      /* Just the one request, its buffers can go out as they are. */
+      bufs = &(req->bufs[req->write_index]);
+      nbufs = req->nbufs - req->write_index;
+      size = uv__write_req_size(req);
+    } else {
+      /* Write as many queued requests as fit in one writev(). */
+      nbufs = uv__getiovmax();
+      if (nbufs > ARRAY_SIZE(gathered))
+        nbufs = ARRAY_SIZE(gathered);
+
+      bufs = gathered;
+      nbufs = uv__write_gather(stream, bufs, nbufs, &size);
+    }
+
+    flags = 0;
+    if (stream->type == UV_TCP && req->send_handle == NULL)
+      flags = uv__tcp_zerocopy_flags((uv_tcp_t*) stream, size);
+
+    n = uv__try_write(stream, bufs, nbufs, req->send_handle, flags);
+
+    if (n == UV_ENOBUFS && flags != 0)
+      n = uv__try_write(stream, bufs, nbufs, NULL, 0);
+    else if (n > 0 && flags != 0)
+      uv__tcp_zerocopy_sent((uv_tcp_t*) stream);
 
-    /* Ensure the handle isn't sent again in case this is a partial write. */
     if (n >= 0) {
+      /* Ensure the handle isn't sent again in case this is a partial write. */
       req->send_handle = NULL;
-      if (uv__write_req_update(stream, req, n)) {
+
+      /* Hand the written bytes to the requests in queue order. */
+      left = n;
+      do {
+        q = QUEUE_HEAD(&stream->write_queue);
+        req = QUEUE_DATA(q, uv_write_t, queue);
+        if (!uv__write_req_update(stream, req, &left))
+          break;
+
         uv__write_req_finish(req);
-        return;  /* TODO(bnoordhuis) Start trying to write the next request. */
-      }
+      } while (left > 0 && !QUEUE_EMPTY(&stream->write_queue));
+
+      assert(left == 0);
+
+      /* Everything went out, the socket may take more. */
+      if ((size_t) n == size)
+        continue;
     } else if (n != UV_EAGAIN)
       break;
 
@@ -917,6 +1163,7 @@ static void uv__write(uv_stream_t* stream) {
       continue;
 
     /* We're not done. */
+    uv__io_clear_ready(&stream->io_watcher, POLLOUT);
     uv__io_start(stream->loop, &stream->io_watcher, POLLOUT);
 
     /* Notify select() thread about state change */
@@ -1115,6 +1362,67 @@ static int uv__stream_recv_cmsg(uv_stream_t* stream, struct msghdr* msg) {
 }
 
 
+/* Let the other streams have their turn before reading more. Level-triggered
+ * watchers are reported again by the next poll, edge-triggered watchers are
+ * fed back to the loop. With UV_LOOP_READ_ROUND_ROBIN the stream instead goes
+ * to the back of the loop's deferred queue, which runs after the current poll
+ * phase, and readiness reported for it in the meantime is ignored. Without
+ * memory for the queue entry the stream falls back to the former.
+ */
+static void uv__read_defer(uv_stream_t* stream) {
+  uv__loop_internal_fields_t* lfields;
+  struct uv__stream_ext* ext;
+
+  ext = NULL;
+  if (stream->loop->flags & UV_LOOP_DEFER_READS)
+    ext = uv__stream_ext_alloc(stream);
+
+  if (ext == NULL) {
+    uv__io_feed_ready(stream->loop, &stream->io_watcher);
+    return;
+  }
+
+  lfields = uv__get_internal_fields(stream->loop);
+  QUEUE_INSERT_TAIL(&lfields->deferred_reads, &ext->deferred_queue);
+  stream->flags |= UV_HANDLE_READ_DEFERRED;
+}
+
+
+static void uv__read_undefer(uv_stream_t* stream) {
+  struct uv__stream_ext* ext;
+
+  if (!(stream->flags & UV_HANDLE_READ_DEFERRED))
+    return;
+
+  ext = uv__stream_ext(stream);
+  QUEUE_REMOVE(&ext->deferred_queue);
+  QUEUE_INIT(&ext->deferred_queue);
+  stream->flags &= ~UV_HANDLE_READ_DEFERRED;
+}
+
+
+void uv__stream_run_deferred(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
+  uv_stream_t* stream;
+  QUEUE queue;
+  QUEUE* q;
+
+  lfields = uv__get_internal_fields(loop);
+  if (QUEUE_EMPTY(&lfields->deferred_reads))
+    return;
+
+  /* Streams that run out of budget again wait for the next round. */
+  QUEUE_MOVE(&lfields->deferred_reads, &queue);
+
+  while (!QUEUE_EMPTY(&queue)) {
+    q = QUEUE_HEAD(&queue);
+    stream = QUEUE_DATA(q, struct uv__stream_ext, deferred_queue)->stream;
+    uv__read_undefer(stream);
+    uv__io_dispatch(loop, &stream->io_watcher, POLLIN, UV_METRICS_PHASE_POLL);
+  }
+}
+
+
 #ifdef __clang__
 # pragma clang diagnostic push
 # pragma clang diagnostic ignored "-Wgnu-folding-constant"
@@ -1126,27 +1434,55 @@ static void uv__read(uv_stream_t* stream) {
   ssize_t nread;
   struct msghdr msg;
   char cmsg_space[CMSG_SPACE(UV__CMSG_FD_SIZE)];
-  int count;
+  uv__loop_internal_fields_t* lfields;
+  struct uv__stream_ext* ext;
+  unsigned int count;
+  size_t nbytes;
+  size_t max_bytes;
   int err;
   int is_ipc;
 
+  /* Waiting for its turn, see uv__stream_run_deferred(). */
+  if (stream->flags & UV_HANDLE_READ_DEFERRED)
+    return;
+
   stream->flags &= ~UV_HANDLE_READ_PARTIAL;
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Streams that run out of budget are handed back to the loop
+   * by uv__read_defer().
    */
-  count = 32;
+  ext = uv__stream_ext(stream);
+  if (ext != NULL && (ext->read_budget != 0 || ext->read_budget_bytes != 0)) {
+    count = ext->read_budget;
+    max_bytes = ext->read_budget_bytes;
+  } else {
+    lfields = uv__get_internal_fields(stream->loop);
+    count = lfields->read_budget;
+    max_bytes = lfields->read_budget_bytes;
+  }
+
+  if (count == 0)
+    count = UINT_MAX;
+  if (max_bytes == 0)
+    max_bytes = SIZE_MAX;
+  nbytes = 0;
 
   is_ipc = stream->type == UV_NAMED_PIPE && ((uv_pipe_t*) stream)->ipc;
 
   /* XXX: Maybe instead of having UV_HANDLE_READING we just test if
    * tcp->read_cb is NULL or not?
    */
-  while (stream->read_cb
-      && (stream->flags & UV_HANDLE_READING)
-      && (count-- > 0)) {
+  while (stream->read_cb && (stream->flags & UV_HANDLE_READING)) {
     assert(stream->alloc_cb != NULL);
 
+    if (count == 0 || nbytes >= max_bytes) {
+      /* Ran out of budget with data still pending. */
+      uv__read_defer(stream);
+      return;
+    }
+    count--;
+
     buf = uv_buf_init(NULL, 0);
     stream->alloc_cb((uv_handle_t*)stream, 64 * 1024, &buf);
     if (buf.base == NULL || buf.len == 0) {
@@ -1184,10 +1520,16 @@ static void uv__read(uv_stream_t* stream) {
       /* Error */
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* Wait for the next one. */
+        uv__io_clear_ready(&stream->io_watcher, POLLIN);
         if (stream->flags & UV_HANDLE_READING) {
           uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
           uv__stream_osx_interrupt_select(stream);
         }
+        /* Pool buffers are only held while there is data to hold. */
+        if (stream->alloc_cb == uv_read_pool_alloc) {
+          uv_read_pool_release(stream->loop, &buf);
+          buf = uv_buf_init(NULL, 0);
+        }
         stream->read_cb(stream, 0, &buf);
 #if defined(__CYGWIN__) || defined(__MSYS__)
       } else if (errno == ECONNRESET && stream->type == UV_NAMED_PIPE) {
@@ -1245,11 +1587,18 @@ static void uv__read(uv_stream_t* stream) {
       }
 #endif
       stream->read_cb(stream, nread, &buf);
+      nbytes += nread;
 
       /* Return if we didn't fill the buffer, there is no more data to read. */
       if (nread < buflen) {
         stream->flags |= UV_HANDLE_READ_PARTIAL;
-        return;
+        /* Unless the peer hung up, in which case the EOF won't be reported
+         * again to an edge-triggered watcher.
+         */
+        if (!uv__io_ready(&stream->io_watcher, UV__POLLRDHUP)) {
+          uv__io_clear_ready(&stream->io_watcher, POLLIN);
+          return;
+        }
       }
     }
   }
@@ -1293,7 +1642,7 @@ int uv_shutdown(uv_shutdown_t* req, uv_stream_t* stream, uv_shutdown_cb cb) {
 }
 
 
-static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   uv_stream_t* stream;
 
   stream = container_of(w, uv_stream_t, io_watcher);
@@ -1310,6 +1659,10 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   assert(uv__stream_fd(stream) >= 0);
 
+  /* Completed zero-copy writes, they're reported as socket errors. */
+  if ((events & POLLERR) && stream->type == UV_TCP)
+    uv__tcp_zerocopy_reap((uv_tcp_t*) stream);
+
   /* Ignore POLLHUP here. Even if it's set, there may still be data to read. */
   if (events & (POLLIN | POLLERR | POLLHUP))
     uv__read(stream);
@@ -1539,7 +1892,7 @@ int uv_try_write2(uv_stream_t* stream,
   if (err < 0)
     return err;
 
-  return uv__try_write(stream, bufs, nbufs, send_handle);
+  return uv__try_write(stream, bufs, nbufs, send_handle, 0);
 }
 
 
@@ -1573,6 +1926,7 @@ int uv_read_stop(uv_stream_t* stream) {
   if (!(stream->flags & UV_HANDLE_READING))
     return 0;
 
+  uv__read_undefer(stream);
   stream->flags &= ~UV_HANDLE_READING;
   uv__io_stop(stream->loop, &stream->io_watcher, POLLIN);
   uv__handle_stop(stream);
@@ -1672,3 +2026,18 @@ int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
    */
   return uv__nonblock(uv__stream_fd(handle), !blocking);
 }
+
+
+int uv_stream_set_read_budget(uv_stream_t* handle,
+                              unsigned int reads,
+                              size_t bytes) {
+  struct uv__stream_ext* ext;
+
+  ext = uv__stream_ext_alloc(handle);
+  if (ext == NULL)
+    return UV_ENOMEM;
+
+  ext->read_budget = reads;
+  ext->read_budget_bytes = bytes;
+  return 0;
+}
@@ -293,9 +293,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
 
       assert(fd >= 0);
-      assert((unsigned) fd < loop->nwatchers);
 
-      w = loop->watchers[fd];
+      w = uv__watcher_get(loop, fd);
 
       /* File descriptor that we've stopped watching, ignore. */
       if (w == NULL)
@@ -308,12 +307,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         have_signals = 1;
       } else {
         uv__metrics_update_idle_time(loop);
-        w->cb(loop, w, pe->portev_events);
+        uv__io_dispatch(loop, w, pe->portev_events, UV_METRICS_PHASE_POLL);
       }
 
       nevents++;
 
-      if (w != loop->watchers[fd])
+      if (w != uv__watcher_get(loop, fd))
         continue;  /* Disabled by callback. */
 
       /* Events Ports operates in oneshot mode, rearm timer on next run. */
@@ -321,6 +320,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
     }
 
+    uv__metrics_inc_events(loop, nevents);
+
     if (reset_timeout != 0) {
       timeout = user_timeout;
       reset_timeout = 0;
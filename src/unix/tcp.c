@@ -27,6 +27,32 @@
 #include <assert.h>
 #include <errno.h>
 
+#if defined(__linux__)
+# include <linux/errqueue.h>
+# include <linux/filter.h>
+# ifndef SO_ATTACH_REUSEPORT_CBPF
+#  define SO_ATTACH_REUSEPORT_CBPF 51
+# endif
+# ifndef SO_ZEROCOPY
+#  define SO_ZEROCOPY 60
+# endif
+# ifndef MSG_ZEROCOPY
+#  define MSG_ZEROCOPY 0x4000000
+# endif
+# ifndef SO_EE_ORIGIN_ZEROCOPY
+#  define SO_EE_ORIGIN_ZEROCOPY 5
+# endif
+# ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#  define SO_EE_CODE_ZEROCOPY_COPIED 1
+# endif
+#endif
+
+/* accept() calls per wakeup of a handle that hands off connections, when
+ * uv_tcp_accept_batch() didn't set a number. The other loops do the work,
+ * but the rest of this one shouldn't wait on a backlog that keeps filling up.
+ */
+#define UV__TCP_HANDOFF_BATCH 32
+
 
 static int new_socket(uv_tcp_t* handle, int domain, unsigned long flags) {
   struct sockaddr_storage saddr;
@@ -164,6 +190,29 @@ int uv__tcp_bind(uv_tcp_t* tcp,
   if (setsockopt(tcp->io_watcher.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)))
     return UV__ERR(errno);
 
+  if (flags & UV_TCP_REUSEPORT) {
+    /* Only where the kernel balances connections between the sockets, the
+     * BSDs and macOS hand them all to the last socket that bound.
+     */
+#if defined(__linux__) || defined(__DragonFly__)
+    if (setsockopt(tcp->io_watcher.fd,
+                   SOL_SOCKET,
+                   SO_REUSEPORT,
+                   &on,
+                   sizeof(on)))
+      return UV__ERR(errno);
+#elif defined(SO_REUSEPORT_LB)
+    if (setsockopt(tcp->io_watcher.fd,
+                   SOL_SOCKET,
+                   SO_REUSEPORT_LB,
+                   &on,
+                   sizeof(on)))
+      return UV__ERR(errno);
+#else
+    return UV_ENOTSUP;
+#endif
+  }
+
 #ifndef __OpenBSD__
 #ifdef IPV6_V6ONLY
   if (addr->sa_family == AF_INET6) {
@@ -201,6 +250,40 @@ int uv__tcp_bind(uv_tcp_t* tcp,
 }
 
 
+/* Attaches a classic BPF program to the SO_REUSEPORT group of `tcp` that
+ * picks socket number cpu % nsockets for a new connection, where cpu is the
+ * CPU that handles the connection request.
+ */
+int uv__tcp_reuseport_steer_cpu(uv_tcp_t* tcp, unsigned int nsockets) {
+#if defined(__linux__)
+  struct sock_filter code[] = {
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, 0 },
+    { BPF_RET | BPF_A, 0, 0, 0 },
+  };
+  struct sock_fprog prog;
+
+  if (nsockets == 0)
+    return UV_EINVAL;
+
+  code[1].k = nsockets;
+  prog.len = ARRAY_SIZE(code);
+  prog.filter = code;
+
+  if (setsockopt(tcp->io_watcher.fd,
+                 SOL_SOCKET,
+                 SO_ATTACH_REUSEPORT_CBPF,
+                 &prog,
+                 sizeof(prog)))
+    return UV__ERR(errno);
+
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
 int uv__tcp_connect(uv_connect_t* req,
                     uv_tcp_t* handle,
                     const struct sockaddr* addr,
@@ -362,11 +445,17 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
   if (listen(tcp->io_watcher.fd, backlog))
     return UV__ERR(errno);
 
+  err = uv__iou_poll_use_epoll(tcp->loop, tcp->io_watcher.fd);
+  if (err)
+    return err;
+
   tcp->connection_cb = cb;
-  tcp->flags |= UV_HANDLE_BOUND;
+  tcp->flags |= UV_HANDLE_BOUND | UV_HANDLE_LISTENING;
 
   /* Start listening for connections. */
   tcp->io_watcher.cb = uv__server_io;
+  /* uv__server_io() doesn't always accept until EAGAIN. */
+  tcp->flags &= ~UV_HANDLE_EDGE_TRIGGERED;
   uv__io_start(tcp->loop, &tcp->io_watcher, POLLIN);
 
   return 0;
@@ -450,6 +539,283 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int on, unsigned int delay) {
 }
 
 
+int uv__tcp_zerocopy_sockopt(int fd, int on) {
+#if defined(__linux__)
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+    return UV__ERR(errno);
+
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
+static struct uv__tcp_zerocopy* uv__tcp_zerocopy_state(uv_tcp_t* handle) {
+  struct uv__stream_ext* ext;
+
+  ext = uv__stream_ext((uv_stream_t*) handle);
+  if (ext == NULL)
+    return NULL;
+
+  return &ext->zerocopy;
+}
+
+
+int uv_tcp_zerocopy(uv_tcp_t* handle, int on, size_t threshold) {
+#if defined(__linux__)
+  struct uv__stream_ext* ext;
+  struct uv__tcp_zerocopy* zc;
+  int err;
+
+  if (uv__stream_fd(handle) != -1) {
+    err = uv__tcp_zerocopy_sockopt(uv__stream_fd(handle), on);
+    if (err)
+      return err;
+  }
+
+  if (!on) {
+    /* Writes in flight still complete as usual. */
+    handle->flags &= ~UV_HANDLE_TCP_ZEROCOPY;
+    return 0;
+  }
+
+  ext = uv__stream_ext_alloc((uv_stream_t*) handle);
+  if (ext == NULL)
+    return UV_ENOMEM;
+
+  zc = &ext->zerocopy;
+  zc->threshold = threshold;
+  zc->copied = 0;
+  handle->flags |= UV_HANDLE_TCP_ZEROCOPY;
+
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
+/* Returns the flags to send `size` bytes with. */
+int uv__tcp_zerocopy_flags(uv_tcp_t* handle, size_t size) {
+#if defined(__linux__)
+  struct uv__tcp_zerocopy* zc;
+
+  if (!(handle->flags & UV_HANDLE_TCP_ZEROCOPY))
+    return 0;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  if (zc->copied)
+    return 0;
+
+  if (size < zc->threshold)
+    return 0;
+
+  return MSG_ZEROCOPY;
+#else
+  return 0;
+#endif
+}
+
+
+/* Called after every successful send with MSG_ZEROCOPY. */
+void uv__tcp_zerocopy_sent(uv_tcp_t* handle) {
+  struct uv__tcp_zerocopy* zc;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  if (zc->next++ != zc->acked)
+    return;
+
+  /* The kernel signals completions with POLLERR, which epoll and friends
+   * only report for file descriptors they watch. Watch for urgent data,
+   * the one event that doesn't otherwise happen on the stream, until all
+   * sends have completed. Unclaimed completions keep POLLERR raised, and
+   * they use up the socket's option memory that further sends need.
+   */
+  uv__io_start(handle->loop, &handle->io_watcher, UV__POLLPRI);
+}
+
+
+/* Holds on to a write request that would otherwise complete now, if the
+ * kernel may still read from its buffers or those of an earlier request.
+ * Returns 1 if it did.
+ */
+int uv__tcp_zerocopy_defer(uv_tcp_t* handle, uv_write_t* req) {
+  struct uv__tcp_zerocopy* zc;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  if (zc == NULL || zc->next == zc->acked)
+    return 0;
+
+  /* Not necessarily sent with MSG_ZEROCOPY itself, the callbacks still have
+   * to run in order. Remember the last send it has to wait for.
+   */
+  req->reserved[0] = (void*) (uintptr_t) (zc->next - 1);
+  QUEUE_INSERT_TAIL(&zc->pending, &req->queue);
+
+  return 1;
+}
+
+
+int uv__tcp_zerocopy_pending(uv_tcp_t* handle) {
+  struct uv__tcp_zerocopy* zc;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  return zc != NULL && !QUEUE_EMPTY(&zc->pending);
+}
+
+
+/* Moves the requests that are done to the stream's write_completed_queue. */
+static void uv__tcp_zerocopy_complete(uv_tcp_t* handle) {
+  struct uv__tcp_zerocopy* zc;
+  uv_write_t* req;
+  uint32_t seq;
+  QUEUE* q;
+
+  zc = uv__tcp_zerocopy_state(handle);
+
+  while (!QUEUE_EMPTY(&zc->pending)) {
+    q = QUEUE_HEAD(&zc->pending);
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    seq = (uint32_t) (uintptr_t) req->reserved[0];
+
+    if ((int32_t) (seq - zc->acked) >= 0)
+      break;
+
+    QUEUE_REMOVE(q);
+    QUEUE_INSERT_TAIL(&handle->write_completed_queue, q);
+    uv__io_feed(handle->loop, &handle->io_watcher);
+  }
+
+  if (zc->next == zc->acked)
+    uv__io_stop(handle->loop, &handle->io_watcher, UV__POLLPRI);
+}
+
+
+#if defined(__linux__)
+static void uv__tcp_zerocopy_ack(struct uv__tcp_zerocopy* zc,
+                                 uint32_t lo,
+                                 uint32_t hi) {
+  struct uv__tcp_zerocopy_range* ranges;
+  unsigned int i;
+
+  if (lo != zc->acked) {
+    ranges = uv__reallocf(zc->ranges, (zc->nranges + 1) * sizeof(*ranges));
+    if (ranges == NULL)
+      abort();
+
+    ranges[zc->nranges].lo = lo;
+    ranges[zc->nranges].hi = hi;
+    zc->ranges = ranges;
+    zc->nranges++;
+    return;
+  }
+
+  zc->acked = hi + 1;
+
+  /* Pick up the ranges that completed early. */
+  i = 0;
+  while (i < zc->nranges) {
+    if (zc->ranges[i].lo != zc->acked) {
+      i++;
+      continue;
+    }
+
+    zc->acked = zc->ranges[i].hi + 1;
+    zc->ranges[i] = zc->ranges[--zc->nranges];
+    i = 0;
+  }
+
+  if (zc->nranges == 0) {
+    uv__free(zc->ranges);
+    zc->ranges = NULL;
+  }
+}
+#endif
+
+
+/* Reads the completion notifications from the socket's error queue. */
+void uv__tcp_zerocopy_reap(uv_tcp_t* handle) {
+#if defined(__linux__)
+  struct sock_extended_err* serr;
+  struct uv__tcp_zerocopy* zc;
+  struct cmsghdr* cmsg;
+  struct msghdr msg;
+  union {
+    char data[CMSG_SPACE(sizeof(*serr)) + 64];
+    struct cmsghdr alias;
+  } scratch;
+  ssize_t r;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  if (zc == NULL || zc->next == zc->acked)
+    return;
+
+  for (;;) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = &scratch.alias;
+    msg.msg_controllen = sizeof(scratch.data);
+
+    do
+      r = recvmsg(uv__stream_fd(handle), &msg, MSG_ERRQUEUE);
+    while (r == -1 && errno == EINTR);
+
+    if (r == -1) {
+      /* The error queue is empty. Edge-triggered watchers see POLLERR again
+       * with the next completion, don't let it stick until then.
+       */
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        uv__io_clear_ready(&handle->io_watcher, POLLERR);
+      break;  /* Or a socket error that reading or writing reports. */
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+
+      serr = (struct sock_extended_err*) CMSG_DATA(cmsg);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        zc->copied = 1;
+
+      uv__tcp_zerocopy_ack(zc, serr->ee_info, serr->ee_data);
+    }
+  }
+
+  uv__tcp_zerocopy_complete(handle);
+#endif
+}
+
+
+/* The handle is going away, hand out what is still pending. The watcher is
+ * closed already, uv__stream_destroy() runs the callbacks right after.
+ */
+void uv__tcp_zerocopy_destroy(uv_tcp_t* handle) {
+  struct uv__tcp_zerocopy* zc;
+  QUEUE* q;
+
+  zc = uv__tcp_zerocopy_state(handle);
+  if (zc == NULL)
+    return;
+
+  while (!QUEUE_EMPTY(&zc->pending)) {
+    q = QUEUE_HEAD(&zc->pending);
+    QUEUE_REMOVE(q);
+    QUEUE_INSERT_TAIL(&handle->write_completed_queue, q);
+  }
+
+  uv__free(zc->ranges);
+  zc->ranges = NULL;
+  zc->nranges = 0;
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   if (enable)
     handle->flags &= ~UV_HANDLE_TCP_SINGLE_ACCEPT;
@@ -459,8 +825,113 @@ int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
 }
 
 
+static struct uv__tcp_accept* uv__tcp_accept_state(uv_tcp_t* handle) {
+  struct uv__stream_ext* ext;
+
+  ext = uv__stream_ext((uv_stream_t*) handle);
+  if (ext == NULL)
+    return NULL;
+
+  return &ext->accept;
+}
+
+
+int uv_tcp_accept_batch(uv_tcp_t* handle, unsigned int batch) {
+  struct uv__stream_ext* ext;
+
+  ext = uv__stream_ext_alloc((uv_stream_t*) handle);
+  if (ext == NULL)
+    return UV_ENOMEM;
+
+  ext->accept.batch = batch > 1 ? batch : 0;
+  return 0;
+}
+
+
+int uv_tcp_accept_handoff(uv_tcp_t* handle,
+                          uv_channel_t* channels[],
+                          unsigned int nchannels) {
+  struct uv__stream_ext* ext;
+  struct uv__tcp_accept* ctx;
+  uv_channel_t** copy;
+
+  if (nchannels != 0 && channels == NULL)
+    return UV_EINVAL;
+
+  ext = uv__stream_ext_alloc((uv_stream_t*) handle);
+  if (ext == NULL)
+    return UV_ENOMEM;
+
+  copy = NULL;
+  if (nchannels != 0) {
+    copy = uv__malloc(nchannels * sizeof(*copy));
+    if (copy == NULL)
+      return UV_ENOMEM;
+    memcpy(copy, channels, nchannels * sizeof(*copy));
+  }
+
+  ctx = &ext->accept;
+  uv__free(ctx->channels);
+  ctx->channels = copy;
+  ctx->nchannels = nchannels;
+  ctx->next = 0;
+
+  return 0;
+}
+
+
+/* Returns 0 when `handle` accepts connections one at a time. */
+unsigned int uv__tcp_accept_batch(uv_tcp_t* handle) {
+  struct uv__tcp_accept* ctx;
+
+  ctx = uv__tcp_accept_state(handle);
+  if (ctx == NULL)
+    return 0;
+
+  /* Connections that go to other loops don't queue up here. */
+  if (ctx->batch == 0 && ctx->nchannels != 0)
+    return UV__TCP_HANDOFF_BATCH;
+
+  return ctx->batch;
+}
+
+
+/* Sends `fd` to the next channel that has room. Returns UV_EAGAIN when the
+ * connection should be accepted on this loop.
+ */
+int uv__tcp_accept_handoff(uv_tcp_t* handle, int fd) {
+  struct uv__tcp_accept* ctx;
+  uv_channel_t* channel;
+  unsigned int i;
+
+  ctx = uv__tcp_accept_state(handle);
+  if (ctx == NULL)
+    return UV_EAGAIN;
+
+  for (i = 0; i < ctx->nchannels; i++) {
+    channel = ctx->channels[ctx->next];
+    ctx->next = (ctx->next + 1) % ctx->nchannels;
+
+    /* Anything but UV_EAGAIN means the message is in the channel. */
+    if (uv_channel_send(channel, (void*) (intptr_t) fd) != UV_EAGAIN)
+      return 0;
+  }
+
+  return UV_EAGAIN;
+}
+
+
 void uv__tcp_close(uv_tcp_t* handle) {
+  struct uv__tcp_accept* ctx;
+
   uv__stream_close((uv_stream_t*)handle);
+
+  ctx = uv__tcp_accept_state(handle);
+  if (ctx != NULL) {
+    uv__free(ctx->channels);
+    ctx->channels = NULL;
+    ctx->nchannels = 0;
+  }
 }
 
 
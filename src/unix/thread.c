@@ -41,6 +41,11 @@
 #include <gnu/libc-version.h>  /* gnu_get_libc_version() */
 #endif
 
+#if defined(__linux__) && defined(__GLIBC__)
+#include <sched.h>  /* cpu_set_t */
+#define UV__HAVE_THREAD_AFFINITY 1
+#endif
+
 #undef NANOSEC
 #define NANOSEC ((uint64_t) 1e9)
 
@@ -213,6 +218,51 @@ int uv_thread_create(uv_thread_t *tid, void (*entry)(void *arg), void *arg) {
   return uv_thread_create_ex(tid, &params, entry, arg);
 }
 
+int uv_cpumask_size(void) {
+#ifdef UV__HAVE_THREAD_AFFINITY
+  return CPU_SETSIZE;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
+/* Initializes `*attr` when it's still NULL. */
+static int uv__thread_attr_setaffinity(pthread_attr_t** attr,
+                                       pthread_attr_t* attr_storage,
+                                       const uv_thread_options_t* params) {
+#ifdef UV__HAVE_THREAD_AFFINITY
+  cpu_set_t cpuset;
+  size_t i;
+
+  if (params->cpumask == NULL)
+    return UV_EINVAL;
+
+  CPU_ZERO(&cpuset);
+  for (i = 0; i < params->mask_size; i++) {
+    if (params->cpumask[i] == 0)
+      continue;
+    if (i >= CPU_SETSIZE)
+      return UV_EINVAL;
+    CPU_SET(i, &cpuset);
+  }
+
+  if (CPU_COUNT(&cpuset) == 0)
+    return UV_EINVAL;
+
+  if (*attr == NULL) {
+    *attr = attr_storage;
+    if (pthread_attr_init(*attr))
+      abort();
+  }
+
+  return UV__ERR(pthread_attr_setaffinity_np(*attr, sizeof(cpuset), &cpuset));
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
 int uv_thread_create_ex(uv_thread_t* tid,
                         const uv_thread_options_t* params,
                         void (*entry)(void *arg),
@@ -255,6 +305,15 @@ int uv_thread_create_ex(uv_thread_t* tid,
       abort();
   }
 
+  if (params->flags & UV_THREAD_HAS_AFFINITY) {
+    err = uv__thread_attr_setaffinity(&attr, &attr_storage, params);
+    if (err) {
+      if (attr != NULL)
+        pthread_attr_destroy(attr);
+      return err;
+    }
+  }
+
   f.in = entry;
   err = pthread_create(tid, attr, f.out, arg);
 
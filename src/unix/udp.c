@@ -47,7 +47,6 @@ union uv__sockaddr {
 };
 
 static void uv__udp_run_completed(uv_udp_t* handle);
-static void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents);
 static void uv__udp_recvmsg(uv_udp_t* handle);
 static void uv__udp_sendmsg(uv_udp_t* handle);
 static int uv__udp_maybe_deferred_bind(uv_udp_t* handle,
@@ -168,7 +167,7 @@ static void uv__udp_run_completed(uv_udp_t* handle) {
 }
 
 
-static void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents) {
+void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents) {
   uv_udp_t* handle;
 
   handle = container_of(w, uv_udp_t, io_watcher);
@@ -551,6 +550,13 @@ int uv__udp_bind(uv_udp_t* handle,
       return err;
     fd = err;
     handle->io_watcher.fd = fd;
+#if defined(__linux__)
+    uv__epoll_busy_poll_fd(handle->loop, fd);
+#endif
+
+    err = uv__iou_poll_use_epoll(handle->loop, fd);
+    if (err)
+      return err;
   }
 
   if (flags & UV_UDP_LINUX_RECVERR) {
@@ -1027,6 +1033,7 @@ int uv__udp_init_ex(uv_loop_t* loop,
                     uv_udp_t* handle,
                     unsigned flags,
                     int domain) {
+  int err;
   int fd;
 
   fd = -1;
@@ -1034,6 +1041,12 @@ int uv__udp_init_ex(uv_loop_t* loop,
     fd = uv__socket(domain, SOCK_DGRAM, 0);
     if (fd < 0)
       return fd;
+
+    err = uv__iou_poll_use_epoll(loop, fd);
+    if (err) {
+      uv__close(fd);
+      return err;
+    }
   }
 
   uv__handle_init(loop, (uv_handle_t*)handle, UV_UDP);
@@ -1043,6 +1056,10 @@ int uv__udp_init_ex(uv_loop_t* loop,
   handle->send_queue_count = 0;
   uv__io_init(&handle->io_watcher, uv__udp_io, fd);
   QUEUE_INIT(&handle->write_queue);
+#if defined(__linux__)
+  if (fd != -1)
+    uv__epoll_busy_poll_fd(loop, fd);
+#endif
   QUEUE_INIT(&handle->write_completed_queue);
 
   return 0;
@@ -1078,7 +1095,14 @@ int uv_udp_open(uv_udp_t* handle, uv_os_sock_t sock) {
   if (err)
     return err;
 
+  err = uv__iou_poll_use_epoll(handle->loop, sock);
+  if (err)
+    return err;
+
   handle->io_watcher.fd = sock;
+#if defined(__linux__)
+  uv__epoll_busy_poll_fd(handle->loop, sock);
+#endif
   if (uv__udp_is_connected(handle))
     handle->flags |= UV_HANDLE_UDP_CONNECTED;
 
@@ -763,7 +763,10 @@ int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...) {
 
   va_start(ap, option);
   /* Any platform-agnostic options should be handled here. */
-  err = uv__loop_configure(loop, option, ap);
+  if (option == UV_LOOP_USE_TIMER_WHEEL)
+    err = uv__timer_wheel_init(loop);
+  else
+    err = uv__loop_configure(loop, option, ap);
   va_end(ap);
 
   return err;
@@ -818,6 +821,8 @@ int uv_loop_close(uv_loop_t* loop) {
       return UV_EBUSY;
   }
 
+  uv__timer_wheel_delete(loop);
+  uv__read_pool_delete(loop);
   uv__loop_close(loop);
 
 #ifndef NDEBUG
@@ -865,6 +870,100 @@ int uv_read_start(uv_stream_t* stream,
 }
 
 
+static void uv__read_pool_trim(struct uv__read_pool* pool,
+                               unsigned int max_free) {
+  void* block;
+
+  while (pool->nfree > max_free) {
+    block = pool->free;
+    pool->free = *(void**) block;
+    pool->nfree--;
+    uv__free(block);
+  }
+}
+
+
+int uv_read_pool_init(uv_loop_t* loop, size_t buf_size, unsigned int max_free) {
+  struct uv__read_pool* pool;
+
+  if (loop == NULL)
+    return UV_EINVAL;
+
+  if (buf_size != 0 && buf_size < sizeof(void*))
+    return UV_EINVAL;
+
+  pool = &uv__get_internal_fields(loop)->read_pool;
+
+  if (buf_size != pool->buf_size) {
+    /* Buffers that are still out there must go back to a pool of their
+     * own size.
+     */
+    if (pool->nused != 0)
+      return UV_EBUSY;
+    uv__read_pool_trim(pool, 0);
+  }
+
+  pool->buf_size = buf_size;
+  pool->max_free = max_free;
+  uv__read_pool_trim(pool, max_free);
+
+  return 0;
+}
+
+
+void uv_read_pool_alloc(uv_handle_t* handle,
+                        size_t suggested_size,
+                        uv_buf_t* buf) {
+  struct uv__read_pool* pool;
+  void* block;
+
+  pool = &uv__get_internal_fields(handle->loop)->read_pool;
+  *buf = uv_buf_init(NULL, 0);
+
+  if (pool->buf_size == 0)
+    return;  /* Not initialized, the read callback gets UV_ENOBUFS. */
+
+  block = pool->free;
+  if (block != NULL) {
+    pool->free = *(void**) block;
+    pool->nfree--;
+  } else {
+    block = uv__malloc(pool->buf_size);
+    if (block == NULL)
+      return;
+  }
+
+  pool->nused++;
+  *buf = uv_buf_init(block, pool->buf_size);
+}
+
+
+void uv_read_pool_release(uv_loop_t* loop, const uv_buf_t* buf) {
+  struct uv__read_pool* pool;
+
+  if (buf->base == NULL)
+    return;
+
+  pool = &uv__get_internal_fields(loop)->read_pool;
+  assert(pool->nused > 0);
+  pool->nused--;
+
+  if (pool->nfree >= pool->max_free) {
+    uv__free(buf->base);
+    return;
+  }
+
+  *(void**) buf->base = pool->free;
+  pool->free = buf->base;
+  pool->nfree++;
+}
+
+
+void uv__read_pool_delete(uv_loop_t* loop) {
+  uv__read_pool_trim(&uv__get_internal_fields(loop)->read_pool, 0);
+}
+
+
 void uv_os_free_environ(uv_env_item_t* envitems, int count) {
   int i;
 
@@ -953,6 +1052,244 @@ void uv__metrics_set_provider_entry_time(uv_loop_t* loop) {
 }
 
 
+void uv__metrics_inc_loop_count(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  loop_metrics->loop_count++;
+  loop_metrics->backend_ctl_last =
+      loop_metrics->backend_ctl - loop_metrics->backend_ctl_mark;
+  loop_metrics->backend_ctl_mark = loop_metrics->backend_ctl;
+}
+
+
+int uv_metrics_info(uv_loop_t* loop, uv_metrics_t* metrics) {
+  uv__loop_metrics_t* loop_metrics;
+
+  if (loop == NULL || metrics == NULL)
+    return UV_EINVAL;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  memset(metrics, 0, sizeof(*metrics));
+  metrics->loop_count = loop_metrics->loop_count;
+  metrics->backend_ctl = loop_metrics->backend_ctl;
+  metrics->backend_ctl_last = loop_metrics->backend_ctl_last;
+  metrics->busy_poll_time = loop_metrics->busy_poll_time;
+  metrics->events = loop_metrics->events;
+  metrics->callbacks = loop_metrics->callbacks;
+  metrics->backend_poll = loop_metrics->backend_poll;
+#ifndef _WIN32
+  /* Every I/O event runs exactly one watcher callback. */
+  metrics->callbacks += loop_metrics->events;
+#endif
+
+  return 0;
+}
+
+
+int uv__metrics_phases_init(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  if (loop_metrics->phases == NULL) {
+    loop_metrics->phases = uv__calloc(UV_METRICS_PHASE_MAX,
+                                      sizeof(*loop_metrics->phases));
+    if (loop_metrics->phases == NULL)
+      return UV_ENOMEM;
+  }
+
+  /* Time blocked in the kernel is subtracted from the poll phase. */
+  uv__get_internal_fields(loop)->flags |= UV_METRICS_IDLE_TIME;
+  return 0;
+}
+
+
+/* HDR-style log-linear buckets, see uv_metrics_histogram_t. */
+static unsigned int uv__metrics_bucket(uint64_t duration) {
+  unsigned int shift;
+
+  if (duration < 8)
+    return (unsigned int) duration;
+
+  if (duration >> 34 != 0)
+    return UV_METRICS_HISTOGRAM_SIZE - 1;
+
+  for (shift = 0; duration >> shift >= 16; shift++);
+
+  /* duration >> shift is in [8, 16). */
+  return 8 * (shift + 1) + (unsigned int) (duration >> shift) - 8;
+}
+
+
+static uint64_t uv__metrics_bucket_max(unsigned int bucket) {
+  unsigned int shift;
+
+  if (bucket < 8)
+    return bucket;
+
+  shift = bucket / 8 - 1;
+  return ((uint64_t) (bucket % 8 + 9) << shift) - 1;
+}
+
+
+static void uv__metrics_record(uv_metrics_histogram_t* h, uint64_t duration) {
+  unsigned int bucket;
+
+  bucket = uv__metrics_bucket(duration);
+  uv__store_relaxed(&h->buckets[bucket], h->buckets[bucket] + 1);
+  uv__store_relaxed(&h->sum, h->sum + duration);
+  if (duration > h->max)
+    uv__store_relaxed(&h->max, duration);
+  uv__store_relaxed(&h->count, h->count + 1);
+}
+
+
+void uv__metrics_tick_begin(uv_loop_t* loop) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  loop_metrics->tick_start = uv_hrtime();
+  loop_metrics->tick_idle = loop_metrics->provider_idle_time;
+  loop_metrics->phase_start = loop_metrics->tick_start;
+  loop_metrics->phase_idle = loop_metrics->tick_idle;
+}
+
+
+void uv__metrics_phase_end(uv_loop_t* loop, uv_metrics_phase phase) {
+  uv__loop_metrics_t* loop_metrics;
+  uint64_t start;
+  uint64_t idle;
+  uint64_t now;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  now = uv_hrtime();
+
+  /* Only the loop thread updates provider_idle_time, no need to lock. */
+  if (phase == UV_METRICS_PHASE_TICK) {
+    start = loop_metrics->tick_start;
+    idle = loop_metrics->provider_idle_time - loop_metrics->tick_idle;
+  } else {
+    start = loop_metrics->phase_start;
+    idle = loop_metrics->provider_idle_time - loop_metrics->phase_idle;
+    loop_metrics->phase_start = now;
+    loop_metrics->phase_idle = loop_metrics->provider_idle_time;
+  }
+
+  /* Enabled halfway through an iteration. */
+  if (start == 0)
+    return;
+
+  if (now - start < idle)
+    idle = now - start;
+
+  uv__metrics_record(&loop_metrics->phases[phase], now - start - idle);
+}
+
+
+int uv_metrics_phase_info(uv_loop_t* loop,
+                          uv_metrics_phase phase,
+                          uv_metrics_histogram_t* histogram) {
+  uv_metrics_histogram_t* h;
+  unsigned int i;
+
+  if (loop == NULL || histogram == NULL)
+    return UV_EINVAL;
+
+  if ((unsigned int) phase >= UV_METRICS_PHASE_MAX)
+    return UV_EINVAL;
+
+  if (uv__get_loop_metrics(loop)->phases == NULL)
+    return UV_EINVAL;  /* UV_METRICS_PHASES not enabled. */
+
+  /* Safe to call from any thread. The copy isn't a snapshot, it may count a
+   * duration in a bucket but not yet in count or sum.
+   */
+  h = &uv__get_loop_metrics(loop)->phases[phase];
+  histogram->count = uv__load_relaxed(&h->count);
+  histogram->sum = uv__load_relaxed(&h->sum);
+  histogram->max = uv__load_relaxed(&h->max);
+  for (i = 0; i < UV_METRICS_HISTOGRAM_SIZE; i++)
+    histogram->buckets[i] = uv__load_relaxed(&h->buckets[i]);
+
+  return 0;
+}
+
+
+int uv_loop_set_slow_callback(uv_loop_t* loop,
+                              uint64_t threshold,
+                              uv_slow_callback_cb cb) {
+  uv__loop_internal_fields_t* lfields;
+
+  if (loop == NULL)
+    return UV_EINVAL;
+
+  lfields = uv__get_internal_fields(loop);
+  lfields->slow_cb_threshold = threshold;
+  lfields->slow_cb = cb;
+
+  return 0;
+}
+
+
+void uv__slow_cb_report(uv_loop_t* loop,
+                        uint64_t start,
+                        uv_metrics_phase phase,
+                        uv_handle_type type,
+                        int fd) {
+  uv__loop_internal_fields_t* lfields;
+  uv_slow_callback_info_t info;
+  uint64_t duration;
+
+  duration = uv_hrtime() - start;
+  lfields = uv__get_internal_fields(loop);
+
+  /* The callback may have removed the hook. */
+  if (lfields->slow_cb == NULL || duration < lfields->slow_cb_threshold)
+    return;
+
+  info.phase = phase;
+  info.type = type;
+  info.fd = fd;
+  info.duration = duration;
+  lfields->slow_cb(loop, &info);
+}
+
+
+uint64_t uv_metrics_histogram_percentile(
+    const uv_metrics_histogram_t* histogram,
+    double percentile) {
+  uint64_t target;
+  uint64_t seen;
+  uint64_t value;
+  unsigned int i;
+
+  if (histogram->count == 0)
+    return 0;
+
+  if (percentile <= 0)
+    percentile = 0;
+  if (percentile >= 100)
+    return histogram->max;
+
+  target = (uint64_t) (histogram->count * (percentile / 100));
+  if (target == 0)
+    target = 1;
+
+  seen = 0;
+  for (i = 0; i < UV_METRICS_HISTOGRAM_SIZE - 1; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= target)
+      break;
+  }
+
+  value = uv__metrics_bucket_max(i);
+  if (i == UV_METRICS_HISTOGRAM_SIZE - 1 || value > histogram->max)
+    value = histogram->max;
+
+  return value;
+}
+
+
 uint64_t uv_metrics_idle_time(uv_loop_t* loop) {
   uv__loop_metrics_t* loop_metrics;
   uint64_t entry_time;
@@ -63,9 +63,13 @@ extern int snprintf(char*, size_t, const char*, ...);
 #if defined(__GNUC__) && (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 7)
 #define uv__load_relaxed(p) __atomic_load_n(p, __ATOMIC_RELAXED)
 #define uv__store_relaxed(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define uv__load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define uv__store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
 #else
 #define uv__load_relaxed(p) (*p)
 #define uv__store_relaxed(p, v) do *p = v; while (0)
+#define uv__load_acquire(p) (__sync_synchronize(), *p)
+#define uv__store_release(p, v) do { __sync_synchronize(); *p = v; } while (0)
 #endif
 
 #define UV__UDP_DGRAM_MAXSIZE (64 * 1024)
@@ -99,6 +103,8 @@ enum {
   UV_HANDLE_EMULATE_IOCP                = 0x00080000,
   UV_HANDLE_BLOCKING_WRITES             = 0x00100000,
   UV_HANDLE_CANCELLATION_PENDING        = 0x00200000,
+  UV_HANDLE_READ_DEFERRED               = 0x00800000,
+  UV_HANDLE_EDGE_TRIGGERED              = 0x40000000,
 
   /* Used by uv_tcp_t and uv_udp_t handles */
   UV_HANDLE_IPV6                        = 0x00400000,
@@ -109,6 +115,7 @@ enum {
   UV_HANDLE_TCP_SINGLE_ACCEPT           = 0x04000000,
   UV_HANDLE_TCP_ACCEPT_STATE_CHANGING   = 0x08000000,
   UV_HANDLE_SHARED_TCP_SOCKET           = 0x10000000,
+  UV_HANDLE_TCP_ZEROCOPY                = 0x20000000,
 
   /* Only used by uv_udp_t handles. */
   UV_HANDLE_UDP_PROCESSING              = 0x01000000,
@@ -152,6 +159,8 @@ int uv__tcp_connect(uv_connect_t* req,
                    unsigned int addrlen,
                    uv_connect_cb cb);
 
+int uv__tcp_reuseport_steer_cpu(uv_tcp_t* tcp, unsigned int nsockets);
+
 int uv__udp_init_ex(uv_loop_t* loop,
                     uv_udp_t* handle,
                     unsigned flags,
@@ -196,7 +205,8 @@ int uv__getaddrinfo_translate_error(int sys_err);    /* EAI_* error. */
 enum uv__work_kind {
   UV__WORK_CPU,
   UV__WORK_FAST_IO,
-  UV__WORK_SLOW_IO
+  UV__WORK_SLOW_IO,
+  UV__WORK_LATENCY  /* UV_WORK_PRIORITY_HIGH */
 };
 
 void uv__work_submit(uv_loop_t* loop,
@@ -218,6 +228,21 @@ uv_dirent_type_t uv__fs_get_dirent_type(uv__dirent_t* dent);
 int uv__next_timeout(const uv_loop_t* loop);
 void uv__run_timers(uv_loop_t* loop);
 void uv__timer_close(uv_timer_t* handle);
+int uv__timer_wheel_init(uv_loop_t* loop);
+void uv__timer_wheel_delete(uv_loop_t* loop);
+
+/* Buffers handed out by uv_read_pool_alloc(). Released buffers are kept on a
+ * free list that is linked through their first word.
+ */
+struct uv__read_pool {
+  size_t buf_size;        /* 0 when the pool is not in use */
+  unsigned int max_free;  /* free buffers kept around for reuse */
+  unsigned int nfree;
+  unsigned int nused;
+  void* free;
+};
+
+void uv__read_pool_delete(uv_loop_t* loop);
 
 void uv__process_title_cleanup(void);
 void uv__signal_cleanup(void);
@@ -360,14 +385,126 @@ struct uv__loop_metrics_s {
   uint64_t provider_entry_time;
   uint64_t provider_idle_time;
   uv_mutex_t lock;
+  uint64_t loop_count;
+  uint64_t backend_ctl;
+  uint64_t backend_ctl_mark;  /* backend_ctl when the iteration started */
+  uint64_t backend_ctl_last;
+  uint64_t busy_poll_time;
+  uint64_t events;
+  uint64_t callbacks;  /* Excludes I/O callbacks on Unix, see events. */
+  uint64_t backend_poll;
+  /* UV_METRICS_PHASES, NULL when not enabled. Only the loop thread writes the
+   * histograms, other threads read them with relaxed loads. */
+  uv_metrics_histogram_t* phases;
+  uint64_t phase_start;
+  uint64_t phase_idle;  /* provider_idle_time at phase_start */
+  uint64_t tick_start;
+  uint64_t tick_idle;   /* provider_idle_time at tick_start */
 };
 
+void uv__metrics_inc_loop_count(uv_loop_t* loop);
 void uv__metrics_update_idle_time(uv_loop_t* loop);
 void uv__metrics_set_provider_entry_time(uv_loop_t* loop);
+int uv__metrics_phases_init(uv_loop_t* loop);
+void uv__metrics_tick_begin(uv_loop_t* loop);
+void uv__metrics_phase_end(uv_loop_t* loop, uv_metrics_phase phase);
+
+#define uv__metrics_inc_events(loop, n)                                       \
+  (uv__get_loop_metrics(loop)->events += (n))
+
+#define uv__metrics_inc_callbacks(loop, n)                                    \
+  (uv__get_loop_metrics(loop)->callbacks += (n))
+
+/* Cheap enough to call unconditionally between the phases of uv_run(). */
+#define uv__metrics_phase(loop, phase)                                        \
+  do {                                                                        \
+    if (uv__get_loop_metrics(loop)->phases != NULL)                           \
+      uv__metrics_phase_end((loop), (phase));                                 \
+  } while (0)
+
+#define uv__metrics_tick(loop)                                                \
+  do {                                                                        \
+    if (uv__get_loop_metrics(loop)->phases != NULL)                           \
+      uv__metrics_tick_begin(loop);                                           \
+  } while (0)
+
+void uv__slow_cb_report(uv_loop_t* loop,
+                        uint64_t start,
+                        uv_metrics_phase phase,
+                        uv_handle_type type,
+                        int fd);
+
+/* Times a callback when uv_loop_set_slow_callback() is in effect, start is 0
+ * when it isn't.
+ */
+#define uv__slow_cb_start(loop)                                               \
+  (uv__get_internal_fields(loop)->slow_cb != NULL ? uv_hrtime() : 0)
+
+#define uv__slow_cb_end(loop, start, phase, type, fd)                         \
+  do {                                                                        \
+    if ((start) != 0)                                                         \
+      uv__slow_cb_report((loop), (start), (phase), (type), (fd));             \
+  } while (0)
+
+#ifdef __linux__
+struct epoll_event;
+
+struct uv__iou {
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t* sqarray;
+  uint32_t sqmask;
+  uint32_t* sqflags;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  void* sq;   /* pointer to munmap() on event loop teardown */
+  void* cqe;  /* pointer to array of struct uv__io_uring_cqe */
+  void* sqe;  /* pointer to array of struct uv__io_uring_sqe */
+  size_t sqlen;
+  size_t cqlen;
+  size_t maxlen;
+  size_t sqelen;
+  int ringfd;
+  uint32_t in_flight;  /* fs requests submitted to the ring */
+  QUEUE reqs;  /* the same requests, linked through work_req.wq */
+  void* pollfds;  /* per-fd poll state, see linux-iouring.c */
+  uint32_t npollfds;
+  void* pollslots;  /* the same for fds >= UV__WATCHERS_DENSE_MAX */
+  uint32_t pollslots_mask;  /* number of slots - 1 */
+  uint32_t pollslots_count;
+  uint32_t pollgen;  /* generation of the last poll request */
+};
+#endif  /* __linux__ */
 
 struct uv__loop_internal_fields_s {
   unsigned int flags;
+  unsigned int wq_shard;  /* threadpool shard + 1, 0 if not yet assigned */
+  struct uv__timer_wheel* timer_wheel;  /* NULL when timers use the heap */
+  unsigned int busy_poll;  /* UV_LOOP_BUSY_POLL spin time in microseconds */
+  void* async_pending;  /* stack of async handles sent since the last drain */
+  uv_slow_callback_cb slow_cb;  /* NULL unless uv_loop_set_slow_callback() */
+  uint64_t slow_cb_threshold;   /* nanoseconds */
+  struct uv__read_pool read_pool;
   uv__loop_metrics_t loop_metrics;
+#ifndef _WIN32
+  /* Watchers of fds >= UV__WATCHERS_DENSE_MAX, NULL when there are none. */
+  struct uv__watcher_slot* sparse_watchers;
+  unsigned int sparse_watchers_mask;  /* number of slots - 1 */
+  unsigned int sparse_watchers_count;
+  /* Streams that ran out of read budget, see UV_LOOP_READ_ROUND_ROBIN. */
+  void* deferred_reads[2];
+  unsigned int read_budget;  /* reads per readiness event, 0 for no limit */
+  size_t read_budget_bytes;  /* 0 for no limit */
+#endif  /* !_WIN32 */
+#ifdef __linux__
+  struct epoll_event* poll_events;  /* NULL while the stack array suffices */
+  unsigned int npoll_events;
+  unsigned int poll_events_idle;
+  struct uv__iou poll_ring;
+  struct uv__iou fs_ring;
+  uv__io_t fs_ring_watcher;
+#endif  /* __linux__ */
 };
 
 #endif /* UV_COMMON_H_ */
@@ -224,6 +224,7 @@ static void uv_init(void) {
 int uv_loop_init(uv_loop_t* loop) {
   uv__loop_internal_fields_t* lfields;
   struct heap* timer_heap;
+  const char* val;
   int err;
 
   /* Initialize libuv itself first */
@@ -297,6 +298,11 @@ int uv_loop_init(uv_loop_t* loop) {
   if (err)
     goto fail_async_init;
 
+  /* Best effort, timers stay in the heap if this fails. */
+  val = getenv("UV_USE_TIMER_WHEEL");
+  if (val != NULL && atoi(val) > 0)
+    uv__timer_wheel_init(loop);
+
   return 0;
 
 fail_async_init:
@@ -365,6 +371,7 @@ void uv__loop_close(uv_loop_t* loop) {
 
   lfields = uv__get_internal_fields(loop);
   uv_mutex_destroy(&lfields->loop_metrics.lock);
+  uv__free(lfields->loop_metrics.phases);
   uv__free(lfields);
   loop->internal_fields = NULL;
 
@@ -381,6 +388,9 @@ int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
     return 0;
   }
 
+  if (option == UV_METRICS_PHASES)
+    return uv__metrics_phases_init(loop);
+
   return UV_ENOSYS;
 }
 
@@ -464,6 +474,7 @@ static void uv__poll_wine(uv_loop_t* loop, DWORD timeout) {
       /* Package was dequeued */
       req = uv_overlapped_to_req(overlapped);
       uv_insert_pending_req(loop, req);
+      uv__metrics_inc_events(loop, 1);
 
       /* Some time might have passed waiting for I/O,
        * so update the loop time here.
@@ -549,6 +560,7 @@ static void uv__poll(uv_loop_t* loop, DWORD timeout) {
         if (overlappeds[i].lpOverlapped) {
           req = uv_overlapped_to_req(overlappeds[i].lpOverlapped);
           uv_insert_pending_req(loop, req);
+          uv__metrics_inc_events(loop, 1);
         }
       }
 
@@ -603,12 +615,18 @@ int uv_run(uv_loop_t *loop, uv_run_mode mode) {
     uv_update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    uv__metrics_inc_loop_count(loop);
+    uv__metrics_tick(loop);
     uv_update_time(loop);
     uv__run_timers(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
 
     ran_pending = uv_process_reqs(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PENDING);
     uv_idle_invoke(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_IDLE);
     uv_prepare_invoke(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PREPARE);
 
     timeout = 0;
     if ((mode == UV_RUN_ONCE && !ran_pending) || mode == UV_RUN_DEFAULT)
@@ -625,9 +643,12 @@ int uv_run(uv_loop_t *loop, uv_run_mode mode) {
      * the timeout == 0) or was already updated b/c an event was received.
      */
     uv__metrics_update_idle_time(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
 
     uv_check_invoke(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CHECK);
     uv_process_endgames(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CLOSING);
 
     if (mode == UV_RUN_ONCE) {
       /* UV_RUN_ONCE implies forward progress: at least one callback must have
@@ -639,8 +660,10 @@ int uv_run(uv_loop_t *loop, uv_run_mode mode) {
        * the check.
        */
       uv__run_timers(loop);
+      uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
     }
 
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TICK);
     r = uv__loop_alive(loop);
     if (mode == UV_RUN_ONCE || mode == UV_RUN_NOWAIT)
       break;
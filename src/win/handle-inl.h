@@ -101,6 +101,7 @@ INLINE static void uv_process_endgames(uv_loop_t* loop) {
   while (loop->endgame_handles) {
     handle = loop->endgame_handles;
     loop->endgame_handles = handle->endgame_next;
+    uv__metrics_inc_callbacks(loop, 1);
 
     handle->flags &= ~UV_HANDLE_ENDGAME_QUEUED;
 
@@ -106,6 +106,7 @@ void uv_loop_watcher_endgame(uv_loop_t* loop, uv_handle_t* handle) {
                                                                               \
   void uv_##name##_invoke(uv_loop_t* loop) {                                  \
     uv_##name##_t* handle;                                                    \
+    uint64_t start;                                                           \
                                                                               \
     (loop)->next_##name##_handle = (loop)->name##_handles;                    \
                                                                               \
@@ -113,7 +114,10 @@ void uv_loop_watcher_endgame(uv_loop_t* loop, uv_handle_t* handle) {
       handle = (loop)->next_##name##_handle;                                  \
       (loop)->next_##name##_handle = handle->name##_next;                     \
                                                                               \
+      start = uv__slow_cb_start(loop);                                        \
       handle->name##_cb(handle);                                              \
+      uv__slow_cb_end(loop, start, UV_METRICS_PHASE_##NAME, UV_##NAME, -1);   \
+      uv__metrics_inc_callbacks(loop, 1);                                     \
     }                                                                         \
   }
 
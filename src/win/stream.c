@@ -244,3 +244,11 @@ int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
 
   return 0;
 }
+
+
+int uv_stream_set_read_budget(uv_stream_t* handle,
+                              unsigned int reads,
+                              size_t bytes) {
+  /* Every read completes through the IOCP on its own. */
+  return UV_ENOTSUP;
+}
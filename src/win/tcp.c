@@ -1372,6 +1372,23 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
 }
 
 
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_tcp_accept_batch(uv_tcp_t* handle, unsigned int batch) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_tcp_accept_handoff(uv_tcp_t* handle,
+                          uv_channel_t* channels[],
+                          unsigned int nchannels) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   if (handle->flags & UV_HANDLE_CONNECTION) {
     return UV_EINVAL;
@@ -1555,6 +1572,9 @@ int uv__tcp_bind(uv_tcp_t* handle,
                  unsigned int flags) {
   int err;
 
+  if (flags & UV_TCP_REUSEPORT)
+    return UV_ENOTSUP;
+
   err = uv_tcp_try_bind(handle, addr, addrlen, flags);
   if (err)
     return uv_translate_sys_error(err);
@@ -1563,6 +1583,11 @@ int uv__tcp_bind(uv_tcp_t* handle,
 }
 
 
+int uv__tcp_reuseport_steer_cpu(uv_tcp_t* tcp, unsigned int nsockets) {
+  return UV_ENOTSUP;
+}
+
+
 /* This function is an egress point, i.e. it returns libuv errors rather than
  * system errors.
  */
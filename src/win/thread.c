@@ -117,6 +117,11 @@ int uv_thread_create(uv_thread_t *tid, void (*entry)(void *arg), void *arg) {
   return uv_thread_create_ex(tid, &params, entry, arg);
 }
 
+int uv_cpumask_size(void) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_thread_create_ex(uv_thread_t* tid,
                         const uv_thread_options_t* params,
                         void (*entry)(void *arg),
@@ -128,6 +133,9 @@ int uv_thread_create_ex(uv_thread_t* tid,
   size_t stack_size;
   size_t pagesize;
 
+  if (params->flags & UV_THREAD_HAS_AFFINITY)
+    return UV_ENOTSUP;
+
   stack_size =
       params->flags & UV_THREAD_HAS_STACK_SIZE ? params->stack_size : 0;
 
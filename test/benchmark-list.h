@@ -23,20 +23,29 @@ BENCHMARK_DECLARE (sizes)
 BENCHMARK_DECLARE (loop_count)
 BENCHMARK_DECLARE (loop_count_timed)
 BENCHMARK_DECLARE (ping_pongs)
+BENCHMARK_DECLARE (ping_pongs_io_uring)
 BENCHMARK_DECLARE (ping_udp)
 BENCHMARK_DECLARE (tcp_write_batch)
+BENCHMARK_DECLARE (tcp_write_batch_queued)
 BENCHMARK_DECLARE (tcp4_pound_100)
 BENCHMARK_DECLARE (tcp4_pound_1000)
 BENCHMARK_DECLARE (pipe_pound_100)
 BENCHMARK_DECLARE (pipe_pound_1000)
+BENCHMARK_DECLARE (tcp4_pound_100_io_uring)
+BENCHMARK_DECLARE (tcp4_pound_1000_io_uring)
 BENCHMARK_DECLARE (tcp_pump100_client)
 BENCHMARK_DECLARE (tcp_pump1_client)
+BENCHMARK_DECLARE (tcp_pump100_client_io_uring)
+BENCHMARK_DECLARE (tcp_pump1_client_io_uring)
 BENCHMARK_DECLARE (pipe_pump100_client)
 BENCHMARK_DECLARE (pipe_pump1_client)
 
 BENCHMARK_DECLARE (tcp_multi_accept2)
 BENCHMARK_DECLARE (tcp_multi_accept4)
 BENCHMARK_DECLARE (tcp_multi_accept8)
+BENCHMARK_DECLARE (tcp_multi_accept2_reuseport)
+BENCHMARK_DECLARE (tcp_multi_accept4_reuseport)
+BENCHMARK_DECLARE (tcp_multi_accept8_reuseport)
 
 /* Run until X packets have been sent/received. */
 BENCHMARK_DECLARE (udp_pummel_1v1)
@@ -76,6 +85,7 @@ BENCHMARK_DECLARE (spawn)
 BENCHMARK_DECLARE (thread_create)
 BENCHMARK_DECLARE (million_async)
 BENCHMARK_DECLARE (million_timers)
+BENCHMARK_DECLARE (queue_work_scaling)
 HELPER_DECLARE    (tcp4_blackhole_server)
 HELPER_DECLARE    (tcp_pump_server)
 HELPER_DECLARE    (pipe_pump_server)
@@ -90,21 +100,39 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (ping_pongs)
   BENCHMARK_HELPER (ping_pongs, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (ping_pongs_io_uring)
+  BENCHMARK_HELPER (ping_pongs_io_uring, tcp4_echo_server)
+
   BENCHMARK_ENTRY  (tcp_write_batch)
   BENCHMARK_HELPER (tcp_write_batch, tcp4_blackhole_server)
 
+  BENCHMARK_ENTRY  (tcp_write_batch_queued)
+  BENCHMARK_HELPER (tcp_write_batch_queued, tcp4_blackhole_server)
+
   BENCHMARK_ENTRY  (tcp_pump100_client)
   BENCHMARK_HELPER (tcp_pump100_client, tcp_pump_server)
 
   BENCHMARK_ENTRY  (tcp_pump1_client)
   BENCHMARK_HELPER (tcp_pump1_client, tcp_pump_server)
 
+  BENCHMARK_ENTRY  (tcp_pump100_client_io_uring)
+  BENCHMARK_HELPER (tcp_pump100_client_io_uring, tcp_pump_server)
+
+  BENCHMARK_ENTRY  (tcp_pump1_client_io_uring)
+  BENCHMARK_HELPER (tcp_pump1_client_io_uring, tcp_pump_server)
+
   BENCHMARK_ENTRY  (tcp4_pound_100)
   BENCHMARK_HELPER (tcp4_pound_100, tcp4_echo_server)
 
   BENCHMARK_ENTRY  (tcp4_pound_1000)
   BENCHMARK_HELPER (tcp4_pound_1000, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (tcp4_pound_100_io_uring)
+  BENCHMARK_HELPER (tcp4_pound_100_io_uring, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (tcp4_pound_1000_io_uring)
+  BENCHMARK_HELPER (tcp4_pound_1000_io_uring, tcp4_echo_server)
+
   BENCHMARK_ENTRY  (pipe_pump100_client)
   BENCHMARK_HELPER (pipe_pump100_client, pipe_pump_server)
 
@@ -120,6 +148,9 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (tcp_multi_accept2)
   BENCHMARK_ENTRY  (tcp_multi_accept4)
   BENCHMARK_ENTRY  (tcp_multi_accept8)
+  BENCHMARK_ENTRY  (tcp_multi_accept2_reuseport)
+  BENCHMARK_ENTRY  (tcp_multi_accept4_reuseport)
+  BENCHMARK_ENTRY  (tcp_multi_accept8_reuseport)
 
   BENCHMARK_ENTRY  (udp_pummel_1v1)
   BENCHMARK_ENTRY  (udp_pummel_1v10)
@@ -160,4 +191,5 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (thread_create)
   BENCHMARK_ENTRY  (million_async)
   BENCHMARK_ENTRY  (million_timers)
+  BENCHMARK_ENTRY  (queue_work_scaling)
 TASK_LIST_END
@@ -38,10 +38,11 @@ static void close_cb(uv_handle_t* handle) {
 }
 
 
-BENCHMARK_IMPL(million_timers) {
+static void million_timers(const char* name, int use_timer_wheel) {
   uv_timer_t* timers;
-  uv_loop_t* loop;
+  uv_loop_t loop;
   uint64_t before_all;
+  uint64_t before_restart;
   uint64_t before_run;
   uint64_t after_run;
   uint64_t after_all;
@@ -51,35 +52,61 @@ BENCHMARK_IMPL(million_timers) {
   timers = malloc(NUM_TIMERS * sizeof(timers[0]));
   ASSERT_NOT_NULL(timers);
 
-  loop = uv_default_loop();
+  ASSERT(0 == uv_loop_init(&loop));
+  if (use_timer_wheel)
+    ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL));
+
+  timer_cb_called = 0;
+  close_cb_called = 0;
   timeout = 0;
 
   before_all = uv_hrtime();
   for (i = 0; i < NUM_TIMERS; i++) {
     if (i % 1000 == 0) timeout++;
-    ASSERT(0 == uv_timer_init(loop, timers + i));
+    ASSERT(0 == uv_timer_init(&loop, timers + i));
     ASSERT(0 == uv_timer_start(timers + i, timer_cb, timeout, 0));
   }
 
+  /* Push every timeout back once, like an idle timeout on activity. */
+  before_restart = uv_hrtime();
+  for (i = 0; i < NUM_TIMERS; i++)
+    ASSERT(0 == uv_timer_start(timers + i,
+                               timer_cb,
+                               uv_timer_get_due_in(timers + i) + 1,
+                               0));
+
   before_run = uv_hrtime();
-  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
   after_run = uv_hrtime();
 
   for (i = 0; i < NUM_TIMERS; i++)
     uv_close((uv_handle_t*) (timers + i), close_cb);
 
-  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
   after_all = uv_hrtime();
 
   ASSERT(timer_cb_called == NUM_TIMERS);
   ASSERT(close_cb_called == NUM_TIMERS);
+  ASSERT(0 == uv_loop_close(&loop));
   free(timers);
 
-  fprintf(stderr, "%.2f seconds total\n", (after_all - before_all) / 1e9);
-  fprintf(stderr, "%.2f seconds init\n", (before_run - before_all) / 1e9);
-  fprintf(stderr, "%.2f seconds dispatch\n", (after_run - before_run) / 1e9);
-  fprintf(stderr, "%.2f seconds cleanup\n", (after_all - after_run) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds total\n",
+          name, (after_all - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds init\n",
+          name, (before_restart - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds restart\n",
+          name, (before_run - before_restart) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds dispatch\n",
+          name, (after_run - before_run) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds cleanup\n",
+          name, (after_all - after_run) / 1e9);
   fflush(stderr);
+}
+
+
+BENCHMARK_IMPL(million_timers) {
+  million_timers("heap", 0);
+  million_timers("timer wheel", 1);
 
   MAKE_VALGRIND_HAPPY();
   return 0;
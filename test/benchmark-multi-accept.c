@@ -92,6 +92,7 @@ static void ipc_alloc_cb(uv_handle_t* handle,
 
 static void sv_async_cb(uv_async_t* handle);
 static void sv_connection_cb(uv_stream_t* server_handle, int status);
+static void sv_group_connection_cb(uv_stream_t* server_handle, int status);
 static void sv_read_cb(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf);
 static void sv_alloc_cb(uv_handle_t* handle,
                         size_t suggested_size,
@@ -103,6 +104,13 @@ static void cl_close_cb(uv_handle_t* handle);
 
 static struct sockaddr_in listen_addr;
 
+/* The loop group variant, every loop listens on a SO_REUSEPORT socket of its
+ * own and the kernel balances connections between them.
+ */
+#define MAX_GROUP_SERVERS 8
+static uv_tcp_t group_servers[MAX_GROUP_SERVERS];
+static unsigned int group_connects[MAX_GROUP_SERVERS];
+
 
 static void ipc_connection_cb(uv_stream_t* ipc_pipe, int status) {
   struct ipc_server_ctx* sc;
@@ -310,6 +318,20 @@ static void sv_connection_cb(uv_stream_t* server_handle, int status) {
 }
 
 
+static void sv_group_connection_cb(uv_stream_t* server_handle, int status) {
+  uv_tcp_t* conn;
+
+  ASSERT(status == 0);
+
+  conn = malloc(sizeof(*conn));
+  ASSERT_NOT_NULL(conn);
+  ASSERT(0 == uv_tcp_init(server_handle->loop, conn));
+  ASSERT(0 == uv_accept(server_handle, (uv_stream_t*) conn));
+  ASSERT(0 == uv_read_start((uv_stream_t*) conn, sv_alloc_cb, sv_read_cb));
+  group_connects[(uv_tcp_t*) server_handle - group_servers]++;
+}
+
+
 static void sv_alloc_cb(uv_handle_t* handle,
                         size_t suggested_size,
                         uv_buf_t* buf) {
@@ -359,9 +381,12 @@ static void cl_close_cb(uv_handle_t* handle) {
 }
 
 
-static int test_tcp(unsigned int num_servers, unsigned int num_clients) {
+static int test_tcp(unsigned int num_servers,
+                    unsigned int num_clients,
+                    int use_group) {
   struct server_ctx* servers;
   struct client_ctx* clients;
+  uv_loop_group_t group;
   uv_loop_t* loop;
   uv_tcp_t* handle;
   unsigned int i;
@@ -379,14 +404,26 @@ static int test_tcp(unsigned int num_servers, unsigned int num_clients) {
    * OS scheduler, threads are functionally equivalent to and interchangeable
    * with full-blown processes.
    */
-  for (i = 0; i < num_servers; i++) {
-    struct server_ctx* ctx = servers + i;
-    ASSERT(0 == uv_sem_init(&ctx->semaphore, 0));
-    ASSERT(0 == uv_thread_create(&ctx->thread_id, server_cb, ctx));
+  if (use_group) {
+    ASSERT(num_servers <= MAX_GROUP_SERVERS);
+    ASSERT(0 == uv_loop_group_init(&group, num_servers, 0));
+    ASSERT(0 == uv_loop_group_listen(&group,
+                                     group_servers,
+                                     (const struct sockaddr*) &listen_addr,
+                                     128,
+                                     0,
+                                     sv_group_connection_cb));
+    ASSERT(0 == uv_loop_group_start(&group));
+  } else {
+    for (i = 0; i < num_servers; i++) {
+      struct server_ctx* ctx = servers + i;
+      ASSERT(0 == uv_sem_init(&ctx->semaphore, 0));
+      ASSERT(0 == uv_thread_create(&ctx->thread_id, server_cb, ctx));
+    }
+
+    send_listen_handles(UV_TCP, num_servers, servers);
   }
 
-  send_listen_handles(UV_TCP, num_servers, servers);
-
   for (i = 0; i < num_clients; i++) {
     struct client_ctx* ctx = clients + i;
     ctx->num_connects = NUM_CONNECTS / num_clients;
@@ -407,15 +444,23 @@ static int test_tcp(unsigned int num_servers, unsigned int num_clients) {
     time = t / 1e9;
   }
 
-  for (i = 0; i < num_servers; i++) {
-    struct server_ctx* ctx = servers + i;
-    uv_async_send(&ctx->async_handle);
-    ASSERT(0 == uv_thread_join(&ctx->thread_id));
-    uv_sem_destroy(&ctx->semaphore);
+  if (use_group) {
+    ASSERT(0 == uv_loop_group_stop(&group));
+    for (i = 0; i < num_servers; i++)
+      servers[i].num_connects = group_connects[i];
+    ASSERT(0 == uv_loop_group_close(&group));
+  } else {
+    for (i = 0; i < num_servers; i++) {
+      struct server_ctx* ctx = servers + i;
+      uv_async_send(&ctx->async_handle);
+      ASSERT(0 == uv_thread_join(&ctx->thread_id));
+      uv_sem_destroy(&ctx->semaphore);
+    }
   }
 
-  printf("accept%u: %.0f accepts/sec (%u total)\n",
+  printf("accept%u%s: %.0f accepts/sec (%u total)\n",
          num_servers,
+         use_group ? "_reuseport" : "",
          NUM_CONNECTS / time,
          NUM_CONNECTS);
 
@@ -437,15 +482,39 @@ static int test_tcp(unsigned int num_servers, unsigned int num_clients) {
 
 
 BENCHMARK_IMPL(tcp_multi_accept2) {
-  return test_tcp(2, 40);
+  return test_tcp(2, 40, 0);
 }
 
 
 BENCHMARK_IMPL(tcp_multi_accept4) {
-  return test_tcp(4, 40);
+  return test_tcp(4, 40, 0);
 }
 
 
 BENCHMARK_IMPL(tcp_multi_accept8) {
-  return test_tcp(8, 40);
+  return test_tcp(8, 40, 0);
+}
+
+
+BENCHMARK_IMPL(tcp_multi_accept2_reuseport) {
+#ifdef _WIN32
+  RETURN_SKIP("SO_REUSEPORT load balancing is not supported.");
+#endif
+  return test_tcp(2, 40, 1);
+}
+
+
+BENCHMARK_IMPL(tcp_multi_accept4_reuseport) {
+#ifdef _WIN32
+  RETURN_SKIP("SO_REUSEPORT load balancing is not supported.");
+#endif
+  return test_tcp(4, 40, 1);
+}
+
+
+BENCHMARK_IMPL(tcp_multi_accept8_reuseport) {
+#ifdef _WIN32
+  RETURN_SKIP("SO_REUSEPORT load balancing is not supported.");
+#endif
+  return test_tcp(8, 40, 1);
 }
@@ -50,6 +50,7 @@ static uv_loop_t* loop;
 static buf_t* buf_freelist = NULL;
 static int pinger_shutdown_cb_called;
 static int completed_pingers = 0;
+static const char* name = "ping_pongs";
 static int64_t start_time;
 
 
@@ -80,7 +81,7 @@ static void pinger_close_cb(uv_handle_t* handle) {
   pinger_t* pinger;
 
   pinger = (pinger_t*)handle->data;
-  fprintf(stderr, "ping_pongs: %d roundtrips/s\n", (1000 * pinger->pongs) / TIME);
+  fprintf(stderr, "%s: %d roundtrips/s\n", name, (1000 * pinger->pongs) / TIME);
   fflush(stderr);
 
   free(pinger);
@@ -206,9 +207,15 @@ static void pinger_new(void) {
 }
 
 
-BENCHMARK_IMPL(ping_pongs) {
+static int ping_pongs(int use_io_uring) {
   loop = uv_default_loop();
 
+  if (use_io_uring) {
+    if (uv_loop_configure(loop, UV_LOOP_USE_IO_URING))
+      RETURN_SKIP("io_uring is not available.");
+    name = "ping_pongs_io_uring";
+  }
+
   start_time = uv_now(loop);
 
   pinger_new();
@@ -219,3 +226,13 @@ BENCHMARK_IMPL(ping_pongs) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+BENCHMARK_IMPL(ping_pongs) {
+  return ping_pongs(0);
+}
+
+
+BENCHMARK_IMPL(ping_pongs_io_uring) {
+  return ping_pongs(1);
+}
@@ -273,7 +273,8 @@ static int pound_it(int concurrency,
                     setup_fn do_setup,
                     connect_fn do_connect,
                     make_connect_fn make_connect,
-                    void* arg) {
+                    void* arg,
+                    int use_io_uring) {
   double secs;
   int r;
   uint64_t start_time; /* in ns */
@@ -281,6 +282,9 @@ static int pound_it(int concurrency,
 
   loop = uv_default_loop();
 
+  if (use_io_uring && uv_loop_configure(loop, UV_LOOP_USE_IO_URING))
+    RETURN_SKIP("io_uring is not available.");
+
   uv_update_time(loop);
   start = uv_now(loop);
 
@@ -299,9 +303,10 @@ static int pound_it(int concurrency,
   /* Number of fractional seconds it took to run the benchmark. */
   secs = (double)(end_time - start_time) / NANOSEC;
 
-  fprintf(stderr, "%s-conn-pound-%d: %.0f accepts/s (%d failed)\n",
+  fprintf(stderr, "%s-conn-pound-%d%s: %.0f accepts/s (%d failed)\n",
           type,
           concurrency,
+          use_io_uring ? "-io_uring" : "",
           closed_streams / secs,
           conns_failed);
   fflush(stderr);
@@ -317,7 +322,8 @@ BENCHMARK_IMPL(tcp4_pound_100) {
                   tcp_do_setup,
                   tcp_do_connect,
                   tcp_make_connect,
-                  NULL);
+                  NULL,
+                  0);
 }
 
 
@@ -327,7 +333,8 @@ BENCHMARK_IMPL(tcp4_pound_1000) {
                   tcp_do_setup,
                   tcp_do_connect,
                   tcp_make_connect,
-                  NULL);
+                  NULL,
+                  0);
 }
 
 
@@ -337,7 +344,8 @@ BENCHMARK_IMPL(pipe_pound_100) {
                   pipe_do_setup,
                   pipe_do_connect,
                   pipe_make_connect,
-                  NULL);
+                  NULL,
+                  0);
 }
 
 
@@ -347,5 +355,28 @@ BENCHMARK_IMPL(pipe_pound_1000) {
                   pipe_do_setup,
                   pipe_do_connect,
                   pipe_make_connect,
-                  NULL);
+                  NULL,
+                  0);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_100_io_uring) {
+  return pound_it(100,
+                  "tcp",
+                  tcp_do_setup,
+                  tcp_do_connect,
+                  tcp_make_connect,
+                  NULL,
+                  1);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_1000_io_uring) {
+  return pound_it(1000,
+                  "tcp",
+                  tcp_do_setup,
+                  tcp_do_connect,
+                  tcp_make_connect,
+                  NULL,
+                  1);
 }
@@ -420,13 +420,16 @@ HELPER_IMPL(pipe_pump_server) {
 }
 
 
-static void tcp_pump(int n) {
+static int tcp_pump(int n, int use_io_uring) {
   ASSERT(n <= MAX_WRITE_HANDLES);
   TARGET_CONNECTIONS = n;
   type = TCP;
 
   loop = uv_default_loop();
 
+  if (use_io_uring && uv_loop_configure(loop, UV_LOOP_USE_IO_URING))
+    RETURN_SKIP("io_uring is not available.");
+
   ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &connect_addr));
 
   /* Start making connections */
@@ -435,6 +438,7 @@ static void tcp_pump(int n) {
   uv_run(loop, UV_RUN_DEFAULT);
 
   MAKE_VALGRIND_HAPPY();
+  return 0;
 }
 
 
@@ -455,14 +459,22 @@ static void pipe_pump(int n) {
 
 
 BENCHMARK_IMPL(tcp_pump100_client) {
-  tcp_pump(100);
-  return 0;
+  return tcp_pump(100, 0);
 }
 
 
 BENCHMARK_IMPL(tcp_pump1_client) {
-  tcp_pump(1);
-  return 0;
+  return tcp_pump(1, 0);
+}
+
+
+BENCHMARK_IMPL(tcp_pump100_client_io_uring) {
+  return tcp_pump(100, 1);
+}
+
+
+BENCHMARK_IMPL(tcp_pump1_client_io_uring) {
+  return tcp_pump(1, 1);
 }
 
 
@@ -0,0 +1,135 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Total number of work items, split evenly across the loops. */
+#define NUM_WORK_ITEMS (2 * 1000 * 1000)
+/* Number of work items each loop keeps in flight. */
+#define WINDOW 64
+#define MAX_LOOPS 16
+
+struct ctx {
+  uv_loop_t loop;
+  uv_thread_t thread;
+  uv_work_t reqs[WINDOW];
+  unsigned int todo;
+  unsigned int done;
+};
+
+
+static void work_cb(uv_work_t* req) {
+  /* Intentionally empty, this measures the queueing overhead. */
+}
+
+
+static void after_work_cb(uv_work_t* req, int status) {
+  struct ctx* ctx = req->data;
+
+  ASSERT(status == 0);
+  ctx->done++;
+
+  if (ctx->todo == 0)
+    return;
+
+  ctx->todo--;
+  ASSERT(0 == uv_queue_work(&ctx->loop, req, work_cb, after_work_cb));
+}
+
+
+static void loop_thread(void* arg) {
+  struct ctx* ctx = arg;
+  unsigned int i;
+
+  for (i = 0; i < WINDOW && ctx->todo > 0; i++) {
+    ctx->reqs[i].data = ctx;
+    ctx->todo--;
+    ASSERT(0 == uv_queue_work(&ctx->loop,
+                              &ctx->reqs[i],
+                              work_cb,
+                              after_work_cb));
+  }
+
+  ASSERT(0 == uv_run(&ctx->loop, UV_RUN_DEFAULT));
+}
+
+
+static double run_loops(unsigned int nloops) {
+  struct ctx* ctxs;
+  uint64_t time;
+  unsigned int i;
+
+  ctxs = calloc(nloops, sizeof(ctxs[0]));
+  ASSERT_NOT_NULL(ctxs);
+
+  for (i = 0; i < nloops; i++) {
+    ASSERT(0 == uv_loop_init(&ctxs[i].loop));
+    ctxs[i].todo = NUM_WORK_ITEMS / nloops;
+  }
+
+  time = uv_hrtime();
+
+  for (i = 0; i < nloops; i++)
+    ASSERT(0 == uv_thread_create(&ctxs[i].thread, loop_thread, &ctxs[i]));
+
+  for (i = 0; i < nloops; i++)
+    ASSERT(0 == uv_thread_join(&ctxs[i].thread));
+
+  time = uv_hrtime() - time;
+
+  for (i = 0; i < nloops; i++) {
+    ASSERT(ctxs[i].done == NUM_WORK_ITEMS / nloops);
+    ASSERT(0 == uv_loop_close(&ctxs[i].loop));
+  }
+
+  free(ctxs);
+
+  return (NUM_WORK_ITEMS / nloops) * nloops / (time / 1e9);
+}
+
+
+BENCHMARK_IMPL(queue_work_scaling) {
+  unsigned int nloops;
+  double base;
+  double rate;
+
+  /* Start the threadpool so its startup isn't part of the first result. */
+  run_loops(1);
+
+  base = 0;
+  for (nloops = 1; nloops <= MAX_LOOPS; nloops *= 2) {
+    rate = run_loops(nloops);
+    if (base == 0)
+      base = rate;
+    printf("queue_work_scaling: %2u loop(s): %.0f work items/s (%.2fx)\n",
+           nloops,
+           rate,
+           rate / base);
+    fflush(stdout);
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
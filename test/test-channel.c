@@ -0,0 +1,169 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NUM_PRODUCERS 4
+#define NUM_MESSAGES 10000
+
+static uv_channel_t channel;
+static unsigned int next_seq[NUM_PRODUCERS];
+static unsigned int received;
+static unsigned int batches;
+static unsigned int max_batch;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*) &channel.async);
+  close_cb_called++;
+}
+
+
+static void producer(void* arg) {
+  uintptr_t id;
+  uintptr_t i;
+  int r;
+
+  id = (uintptr_t) arg;
+
+  for (i = 0; i < NUM_MESSAGES; i++) {
+    /* Never 0, the consumer can tell a message from a NULL slot. */
+    while ((r = uv_channel_send(&channel,
+                                (void*) (id * NUM_MESSAGES + i + 1))) != 0) {
+      ASSERT(r == UV_EAGAIN);
+      uv_sleep(0);
+    }
+  }
+}
+
+
+static void channel_cb(uv_channel_t* handle, void** msgs, unsigned int n) {
+  uintptr_t msg;
+  unsigned int i;
+
+  ASSERT(handle == &channel);
+  ASSERT(n > 0);
+  ASSERT(n <= 64);
+
+  for (i = 0; i < n; i++) {
+    msg = (uintptr_t) msgs[i] - 1;
+    ASSERT(msg / NUM_MESSAGES < NUM_PRODUCERS);
+    /* Messages from one producer arrive in the order they were sent. */
+    ASSERT(msg % NUM_MESSAGES == next_seq[msg / NUM_MESSAGES]);
+    next_seq[msg / NUM_MESSAGES]++;
+  }
+
+  received += n;
+  batches++;
+  if (n > max_batch)
+    max_batch = n;
+
+  if (received == NUM_PRODUCERS * NUM_MESSAGES)
+    uv_channel_close(handle, close_cb);
+}
+
+
+TEST_IMPL(channel) {
+  uv_thread_t threads[NUM_PRODUCERS];
+  uintptr_t i;
+
+  ASSERT(0 == uv_channel_init(uv_default_loop(), &channel, 100, channel_cb));
+
+  for (i = 0; i < NUM_PRODUCERS; i++)
+    ASSERT(0 == uv_thread_create(&threads[i], producer, (void*) i));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  for (i = 0; i < NUM_PRODUCERS; i++) {
+    ASSERT(0 == uv_thread_join(&threads[i]));
+    ASSERT(next_seq[i] == NUM_MESSAGES);
+  }
+
+  ASSERT(received == NUM_PRODUCERS * NUM_MESSAGES);
+  ASSERT(batches <= received);
+  ASSERT(close_cb_called == 1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void full_cb(uv_channel_t* handle, void** msgs, unsigned int n) {
+  unsigned int i;
+
+  /* The capacity is rounded up to 4, all of them arrive in one batch. */
+  ASSERT(n == 4);
+  for (i = 0; i < n; i++)
+    ASSERT(msgs[i] == (void*) (uintptr_t) (i + 1));
+
+  received += n;
+  batches++;
+  uv_channel_close(handle, close_cb);
+}
+
+
+TEST_IMPL(channel_full) {
+  uintptr_t i;
+
+  ASSERT(UV_EINVAL == uv_channel_init(uv_default_loop(), &channel, 0, full_cb));
+  ASSERT(UV_EINVAL == uv_channel_init(uv_default_loop(), &channel, 4, NULL));
+  ASSERT(0 == uv_channel_init(uv_default_loop(), &channel, 3, full_cb));
+
+  for (i = 0; i < 4; i++)
+    ASSERT(0 == uv_channel_send(&channel, (void*) (i + 1)));
+  ASSERT(UV_EAGAIN == uv_channel_send(&channel, (void*) (i + 1)));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(received == 4);
+  ASSERT(batches == 1);
+  ASSERT(close_cb_called == 1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void close_pending_cb(uv_channel_t* handle,
+                             void** msgs,
+                             unsigned int n) {
+  ASSERT(0 && "should not have been called");
+}
+
+
+TEST_IMPL(channel_close_pending) {
+  ASSERT(0 == uv_channel_init(uv_default_loop(),
+                              &channel,
+                              8,
+                              close_pending_cb));
+  ASSERT(0 == uv_channel_send(&channel, &channel));
+  /* Undelivered messages are dropped. */
+  uv_channel_close(&channel, close_cb);
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(close_cb_called == 1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
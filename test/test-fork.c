@@ -676,6 +676,57 @@ TEST_IMPL(fork_threadpool_queue_work_simple) {
 }
 #endif /* !__MVS__ */
 
+
+static int fs_cb_called;
+
+
+static void fs_cb(uv_fs_t* req) {
+  /* The child never sees the completion of the parent's request. */
+  if (getpid() == (pid_t) (uintptr_t) req->data)
+    ASSERT(req->result == 0);
+  else
+    ASSERT(req->result == UV_ECANCELED);
+
+  fs_cb_called++;
+  uv_fs_req_cleanup(req);
+}
+
+
+TEST_IMPL(fork_fs_request_pending) {
+  /* File system requests on the io_uring that the parent started are
+   * cancelled in the child.
+   */
+  pid_t child_pid;
+  uv_fs_t req;
+
+#ifndef __linux__
+  RETURN_SKIP("io_uring is Linux only");
+#endif
+  if (getenv("UV_USE_IO_URING") == NULL)
+    RETURN_SKIP("Needs UV_USE_IO_URING=1");
+
+  req.data = (void*) (uintptr_t) getpid();
+  ASSERT(0 == uv_fs_stat(uv_default_loop(), &req, ".", fs_cb));
+
+  child_pid = fork();
+  ASSERT(child_pid != -1);
+
+  if (child_pid != 0) {
+    /* parent */
+    ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    ASSERT(1 == fs_cb_called);
+    assert_wait_child(child_pid);
+  } else {
+    /* child */
+    ASSERT(0 == uv_loop_fork(uv_default_loop()));
+    ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    ASSERT(1 == fs_cb_called);
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
 #else
 
 typedef int file_has_no_tests; /* ISO C forbids an empty translation unit. */
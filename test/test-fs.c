@@ -73,6 +73,7 @@ static int mkstemp_cb_count;
 static int rmdir_cb_count;
 static int scandir_cb_count;
 static int stat_cb_count;
+static int cancelled_stat_cb_count;
 static int rename_cb_count;
 static int fsync_cb_count;
 static int fdatasync_cb_count;
@@ -670,6 +671,15 @@ static void stat_cb(uv_fs_t* req) {
 }
 
 
+static void cancelled_stat_cb(uv_fs_t* req) {
+  ASSERT(req == &stat_req);
+  ASSERT(req->result == UV_ECANCELED);
+  ASSERT_NULL(req->ptr);
+  cancelled_stat_cb_count++;
+  uv_fs_req_cleanup(req);
+}
+
+
 static void sendfile_cb(uv_fs_t* req) {
   ASSERT(req == &sendfile_req);
   ASSERT(req->fs_type == UV_FS_SENDFILE);
@@ -903,15 +913,13 @@ static void lutime_cb(uv_fs_t* req) {
 }
 
 
-TEST_IMPL(fs_file_async) {
+static void fs_file_async(void) {
   int r;
 
   /* Setup. */
   unlink("test_file");
   unlink("test_file2");
 
-  loop = uv_default_loop();
-
   r = uv_fs_open(loop, &open_req1, "test_file", O_WRONLY | O_CREAT,
       S_IRUSR | S_IWUSR, create_cb);
   ASSERT(r == 0);
@@ -960,12 +968,56 @@ TEST_IMPL(fs_file_async) {
   /* Cleanup. */
   unlink("test_file");
   unlink("test_file2");
+}
+
+
+TEST_IMPL(fs_file_async) {
+  loop = uv_default_loop();
+  fs_file_async();
 
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
 
 
+TEST_IMPL(fs_file_async_io_uring) {
+#ifndef __linux__
+  RETURN_SKIP("io_uring is Linux only.");
+#else
+  uv_loop_t iou_loop;
+  int r;
+
+  ASSERT(0 == uv_loop_init(&iou_loop));
+  r = uv_loop_configure(&iou_loop, UV_LOOP_USE_IO_URING);
+  if (r == UV_ENOSYS || r == UV_EPERM) {
+    ASSERT(0 == uv_loop_close(&iou_loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  loop = &iou_loop;
+  fs_file_async();
+
+  /* Requests in the ring can be cancelled until the loop submits them. */
+  ASSERT(0 == uv_fs_stat(loop, &stat_req, ".", cancelled_stat_cb));
+  ASSERT(0 == uv_cancel((uv_req_t*) &stat_req));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(1 == cancelled_stat_cb_count);
+
+  ASSERT(0 == uv_fs_stat(loop, &stat_req, ".", stat_cb));
+  uv_run(loop, UV_RUN_NOWAIT);
+  ASSERT(UV_EBUSY == uv_cancel((uv_req_t*) &stat_req));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_fs_lstat(loop, &stat_req, ".", stat_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(2 == stat_cb_count);
+
+  ASSERT(0 == uv_loop_close(loop));
+  return 0;
+#endif
+}
+
+
 static void fs_file_sync(int add_flags) {
   int r;
 
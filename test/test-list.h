@@ -33,6 +33,10 @@ TEST_DECLARE   (loop_stop)
 TEST_DECLARE   (loop_update_time)
 TEST_DECLARE   (loop_backend_timeout)
 TEST_DECLARE   (loop_configure)
+TEST_DECLARE   (loop_configure_io_uring)
+TEST_DECLARE   (loop_configure_edge_triggered)
+TEST_DECLARE   (loop_configure_busy_poll)
+TEST_DECLARE   (loop_group)
 TEST_DECLARE   (default_loop_close)
 TEST_DECLARE   (barrier_1)
 TEST_DECLARE   (barrier_2)
@@ -111,6 +115,12 @@ TEST_DECLARE   (tcp_write_fail)
 TEST_DECLARE   (tcp_try_write)
 TEST_DECLARE   (tcp_try_write_error)
 TEST_DECLARE   (tcp_write_queue_order)
+TEST_DECLARE   (tcp_write_gather)
+TEST_DECLARE   (tcp_zerocopy)
+TEST_DECLARE   (tcp_zerocopy_large_write)
+TEST_DECLARE   (tcp_zerocopy_close)
+TEST_DECLARE   (tcp_accept_batch)
+TEST_DECLARE   (tcp_accept_handoff)
 TEST_DECLARE   (tcp_open)
 TEST_DECLARE   (tcp_open_twice)
 TEST_DECLARE   (tcp_open_bound)
@@ -226,6 +236,8 @@ TEST_DECLARE   (timer_from_check)
 TEST_DECLARE   (timer_is_closing)
 TEST_DECLARE   (timer_null_callback)
 TEST_DECLARE   (timer_early_check)
+TEST_DECLARE   (timer_wheel)
+TEST_DECLARE   (timer_slack)
 TEST_DECLARE   (idle_starvation)
 TEST_DECLARE   (loop_handles)
 TEST_DECLARE   (get_loadavg)
@@ -265,6 +277,9 @@ TEST_DECLARE   (active)
 TEST_DECLARE   (embed)
 TEST_DECLARE   (async)
 TEST_DECLARE   (async_null_cb)
+TEST_DECLARE   (channel)
+TEST_DECLARE   (channel_full)
+TEST_DECLARE   (channel_close_pending)
 TEST_DECLARE   (eintr_handling)
 TEST_DECLARE   (get_currentexe)
 TEST_DECLARE   (process_title)
@@ -332,6 +347,7 @@ TEST_DECLARE   (fs_file_noent)
 TEST_DECLARE   (fs_file_nametoolong)
 TEST_DECLARE   (fs_file_loop)
 TEST_DECLARE   (fs_file_async)
+TEST_DECLARE   (fs_file_async_io_uring)
 TEST_DECLARE   (fs_file_sync)
 TEST_DECLARE   (fs_file_write_null_buffer)
 TEST_DECLARE   (fs_async_dir)
@@ -426,6 +442,12 @@ TEST_DECLARE   (fs_get_system_error)
 TEST_DECLARE   (strscpy)
 TEST_DECLARE   (threadpool_queue_work_simple)
 TEST_DECLARE   (threadpool_queue_work_einval)
+TEST_DECLARE   (threadpool_queue_work_priority)
+TEST_DECLARE   (threadpool_queue_work_done_early)
+TEST_DECLARE   (threadpool_resize)
+TEST_DECLARE   (threadpool_autoscale)
+TEST_DECLARE   (threadpool_metrics)
+TEST_DECLARE   (threadpool_affinity)
 TEST_DECLARE   (threadpool_multiple_event_loops)
 TEST_DECLARE   (threadpool_cancel_getaddrinfo)
 TEST_DECLARE   (threadpool_cancel_getnameinfo)
@@ -436,6 +458,7 @@ TEST_DECLARE   (threadpool_cancel_single)
 TEST_DECLARE   (thread_local_storage)
 TEST_DECLARE   (thread_stack_size)
 TEST_DECLARE   (thread_stack_size_explicit)
+TEST_DECLARE   (thread_affinity)
 TEST_DECLARE   (thread_mutex)
 TEST_DECLARE   (thread_mutex_recursive)
 TEST_DECLARE   (thread_rwlock)
@@ -451,6 +474,7 @@ TEST_DECLARE   (poll_duplex)
 TEST_DECLARE   (poll_unidirectional)
 TEST_DECLARE   (poll_close)
 TEST_DECLARE   (poll_bad_fdtype)
+TEST_DECLARE   (poll_many_ready)
 #ifdef __linux__
 TEST_DECLARE   (poll_nested_epoll)
 #endif
@@ -458,6 +482,7 @@ TEST_DECLARE   (poll_nested_epoll)
 TEST_DECLARE   (poll_nested_kqueue)
 #endif
 TEST_DECLARE   (poll_multiple_handles)
+TEST_DECLARE   (poll_high_fd)
 
 TEST_DECLARE   (ip4_addr)
 TEST_DECLARE   (ip6_addr_link_local)
@@ -512,6 +537,8 @@ TEST_DECLARE   (getters_setters)
 TEST_DECLARE   (not_writable_after_shutdown)
 TEST_DECLARE   (not_readable_nor_writable_on_read_error)
 TEST_DECLARE   (readable_on_eof)
+TEST_DECLARE   (read_budget)
+TEST_DECLARE   (read_pool)
 
 #ifndef _WIN32
 TEST_DECLARE  (fork_timer)
@@ -529,6 +556,7 @@ TEST_DECLARE  (fork_fs_events_file_parent_child)
 #ifndef __MVS__
 TEST_DECLARE  (fork_threadpool_queue_work_simple)
 #endif
+TEST_DECLARE  (fork_fs_request_pending)
 #endif
 
 TEST_DECLARE  (idna_toascii)
@@ -539,6 +567,9 @@ TEST_DECLARE  (uname)
 TEST_DECLARE  (metrics_idle_time)
 TEST_DECLARE  (metrics_idle_time_thread)
 TEST_DECLARE  (metrics_idle_time_zero)
+TEST_DECLARE  (metrics_info)
+TEST_DECLARE  (metrics_phases)
+TEST_DECLARE  (metrics_slow_callback)
 
 TASK_LIST_START
   TEST_ENTRY_CUSTOM (platform_output, 0, 1, 5000)
@@ -557,6 +588,10 @@ TASK_LIST_START
   TEST_ENTRY  (loop_update_time)
   TEST_ENTRY  (loop_backend_timeout)
   TEST_ENTRY  (loop_configure)
+  TEST_ENTRY  (loop_configure_io_uring)
+  TEST_ENTRY  (loop_configure_edge_triggered)
+  TEST_ENTRY  (loop_configure_busy_poll)
+  TEST_ENTRY  (loop_group)
   TEST_ENTRY  (default_loop_close)
   TEST_ENTRY  (barrier_1)
   TEST_ENTRY  (barrier_2)
@@ -672,6 +707,12 @@ TASK_LIST_START
   TEST_ENTRY  (tcp_try_write_error)
 
   TEST_ENTRY  (tcp_write_queue_order)
+  TEST_ENTRY  (tcp_write_gather)
+  TEST_ENTRY  (tcp_zerocopy)
+  TEST_ENTRY  (tcp_zerocopy_large_write)
+  TEST_ENTRY  (tcp_zerocopy_close)
+  TEST_ENTRY  (tcp_accept_batch)
+  TEST_ENTRY  (tcp_accept_handoff)
 
   TEST_ENTRY  (tcp_open)
   TEST_HELPER (tcp_open, tcp4_echo_server)
@@ -817,6 +858,8 @@ TASK_LIST_START
   TEST_ENTRY  (timer_is_closing)
   TEST_ENTRY  (timer_null_callback)
   TEST_ENTRY  (timer_early_check)
+  TEST_ENTRY  (timer_wheel)
+  TEST_ENTRY  (timer_slack)
 
   TEST_ENTRY  (idle_starvation)
 
@@ -862,6 +905,9 @@ TASK_LIST_START
 
   TEST_ENTRY  (async)
   TEST_ENTRY  (async_null_cb)
+  TEST_ENTRY  (channel)
+  TEST_ENTRY  (channel_full)
+  TEST_ENTRY  (channel_close_pending)
   TEST_ENTRY  (eintr_handling)
 
   TEST_ENTRY  (get_currentexe)
@@ -908,6 +954,7 @@ TASK_LIST_START
   TEST_ENTRY  (poll_unidirectional)
   TEST_ENTRY  (poll_close)
   TEST_ENTRY  (poll_bad_fdtype)
+  TEST_ENTRY  (poll_many_ready)
 #if (defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))) && \
     !defined(__sun)
   TEST_ENTRY  (poll_oob)
@@ -920,6 +967,7 @@ TASK_LIST_START
   TEST_ENTRY  (poll_nested_kqueue)
 #endif
   TEST_ENTRY  (poll_multiple_handles)
+  TEST_ENTRY  (poll_high_fd)
 
   TEST_ENTRY  (socket_buffer_size)
 
@@ -997,6 +1045,7 @@ TASK_LIST_START
   TEST_ENTRY  (fs_file_nametoolong)
   TEST_ENTRY  (fs_file_loop)
   TEST_ENTRY  (fs_file_async)
+  TEST_ENTRY  (fs_file_async_io_uring)
   TEST_ENTRY  (fs_file_sync)
   TEST_ENTRY  (fs_file_write_null_buffer)
   TEST_ENTRY  (fs_async_dir)
@@ -1090,6 +1139,12 @@ TASK_LIST_START
   TEST_ENTRY  (strscpy)
   TEST_ENTRY  (threadpool_queue_work_simple)
   TEST_ENTRY  (threadpool_queue_work_einval)
+  TEST_ENTRY  (threadpool_queue_work_priority)
+  TEST_ENTRY  (threadpool_queue_work_done_early)
+  TEST_ENTRY  (threadpool_resize)
+  TEST_ENTRY  (threadpool_autoscale)
+  TEST_ENTRY  (threadpool_metrics)
+  TEST_ENTRY  (threadpool_affinity)
   TEST_ENTRY_CUSTOM (threadpool_multiple_event_loops, 0, 0, 60000)
   TEST_ENTRY  (threadpool_cancel_getaddrinfo)
   TEST_ENTRY  (threadpool_cancel_getnameinfo)
@@ -1100,6 +1155,7 @@ TASK_LIST_START
   TEST_ENTRY  (thread_local_storage)
   TEST_ENTRY  (thread_stack_size)
   TEST_ENTRY  (thread_stack_size_explicit)
+  TEST_ENTRY  (thread_affinity)
   TEST_ENTRY  (thread_mutex)
   TEST_ENTRY  (thread_mutex_recursive)
   TEST_ENTRY  (thread_rwlock)
@@ -1134,6 +1190,7 @@ TASK_LIST_START
 #ifndef __MVS__
   TEST_ENTRY  (fork_threadpool_queue_work_simple)
 #endif
+  TEST_ENTRY  (fork_fs_request_pending)
 #endif
 
   TEST_ENTRY  (utf8_decode1)
@@ -1151,10 +1208,15 @@ TASK_LIST_START
   TEST_HELPER   (not_readable_nor_writable_on_read_error, tcp4_echo_server)
   TEST_ENTRY    (readable_on_eof)
   TEST_HELPER   (readable_on_eof, tcp4_echo_server)
+  TEST_ENTRY    (read_budget)
+  TEST_ENTRY    (read_pool)
 
   TEST_ENTRY  (metrics_idle_time)
   TEST_ENTRY  (metrics_idle_time_thread)
   TEST_ENTRY  (metrics_idle_time_zero)
+  TEST_ENTRY  (metrics_info)
+  TEST_ENTRY  (metrics_phases)
+  TEST_ENTRY  (metrics_slow_callback)
 
 #if 0
   /* These are for testing the test runner. */
@@ -36,3 +36,199 @@ TEST_IMPL(loop_configure) {
   ASSERT(0 == uv_loop_close(&loop));
   return 0;
 }
+
+
+#ifdef __linux__
+static uv_tcp_t iou_server;
+static uv_tcp_t iou_client;
+static uv_tcp_t iou_peer;
+static uv_connect_t iou_connect_req;
+static uv_write_t iou_write_req;
+static uv_write_t iou_peer_write_req;
+static int iou_server_reads;
+static int iou_client_reads;
+
+
+static void iou_alloc_cb(uv_handle_t* handle,
+                         size_t suggested_size,
+                         uv_buf_t* buf) {
+  static char slab[64];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void iou_client_read_cb(uv_stream_t* stream,
+                               ssize_t nread,
+                               const uv_buf_t* buf) {
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == 4);
+  ASSERT(0 == memcmp(buf->base, "PONG", 4));
+  iou_client_reads++;
+
+  uv_close((uv_handle_t*) &iou_client, NULL);
+  uv_close((uv_handle_t*) &iou_peer, NULL);
+  uv_close((uv_handle_t*) &iou_server, NULL);
+}
+
+
+static void iou_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void iou_server_read_cb(uv_stream_t* stream,
+                               ssize_t nread,
+                               const uv_buf_t* buf) {
+  uv_buf_t reply;
+
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == 4);
+  ASSERT(0 == memcmp(buf->base, "PING", 4));
+  iou_server_reads++;
+
+  reply = uv_buf_init("PONG", 4);
+  ASSERT(0 == uv_write(&iou_peer_write_req, stream, &reply, 1, iou_write_cb));
+}
+
+
+static void iou_connection_cb(uv_stream_t* server, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(server->loop, &iou_peer));
+  ASSERT(0 == uv_accept(server, (uv_stream_t*) &iou_peer));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &iou_peer,
+                            iou_alloc_cb,
+                            iou_server_read_cb));
+}
+
+
+static void iou_connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+  buf = uv_buf_init("PING", 4);
+  ASSERT(0 == uv_write(&iou_write_req, req->handle, &buf, 1, iou_write_cb));
+  ASSERT(0 == uv_read_start(req->handle, iou_alloc_cb, iou_client_read_cb));
+}
+
+
+static void iou_ping_pong(uv_loop_t* loop) {
+  struct sockaddr_in addr;
+  uv_timer_t timer_handle;
+
+  iou_server_reads = 0;
+  iou_client_reads = 0;
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(loop, &iou_server));
+  ASSERT(0 == uv_tcp_bind(&iou_server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &iou_server, 1, iou_connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &iou_client));
+  ASSERT(0 == uv_tcp_connect(&iou_connect_req,
+                             &iou_client,
+                             (const struct sockaddr*) &addr,
+                             iou_connect_cb));
+
+  ASSERT(0 == uv_timer_init(loop, &timer_handle));
+  ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 10, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(1 == iou_server_reads);
+  ASSERT(1 == iou_client_reads);
+}
+#endif
+
+
+TEST_IMPL(loop_configure_io_uring) {
+#ifdef __linux__
+  uv_loop_t loop;
+  int r;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  r = uv_loop_configure(&loop, UV_LOOP_USE_IO_URING);
+  if (r == UV_ENOSYS || r == UV_EPERM) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(r == 0);
+
+  iou_ping_pong(&loop);
+
+  ASSERT(0 == uv_loop_close(&loop));
+#else
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_USE_IO_URING));
+  ASSERT(0 == uv_loop_close(&loop));
+#endif
+  return 0;
+}
+
+
+TEST_IMPL(loop_configure_edge_triggered) {
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_loop_init(&loop));
+#ifdef __linux__
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_USE_EDGE_TRIGGERED));
+  iou_ping_pong(&loop);
+#else
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_USE_EDGE_TRIGGERED));
+#endif
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+TEST_IMPL(loop_configure_busy_poll) {
+  uv_timer_t timer_handle;
+  uv_metrics_t metrics;
+  uv_loop_t loop;
+#ifdef __linux__
+  uv_udp_t udp;
+  uint64_t start;
+#endif
+
+  ASSERT(0 == uv_loop_init(&loop));
+#ifdef __linux__
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 2000000u));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 2000u));
+
+  /* Sockets get SO_BUSY_POLL if the process is allowed to set it. */
+  ASSERT(0 == uv_udp_init_ex(&loop, &udp, AF_INET));
+
+  /* Spins for up to 2 ms, then sleeps until the timer expires. */
+  ASSERT(0 == uv_timer_init(&loop, &timer_handle));
+  uv_update_time(&loop);
+  start = uv_hrtime();
+  ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(uv_hrtime() - start >= 9 * 1000000);
+
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(metrics.busy_poll_time >= 2 * 1000000);
+  ASSERT(metrics.busy_poll_time < 10 * 1000000);
+
+  /* Nothing to wait for, nothing to spin for. */
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 0u));
+  uv_close((uv_handle_t*) &udp, NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(metrics.busy_poll_time < 10 * 1000000);
+#else
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 2000u));
+  ASSERT(0 == uv_timer_init(&loop, &timer_handle));
+  ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(0 == metrics.busy_poll_time);
+#endif
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
@@ -0,0 +1,142 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+
+#define NUM_LOOPS 4
+#define NUM_CONNECTS 32
+
+static uv_tcp_t servers[NUM_LOOPS];
+static unsigned int accepted[NUM_LOOPS];  /* Written by the group's loops. */
+static uv_tcp_t clients[NUM_CONNECTS];
+static uv_connect_t connect_reqs[NUM_CONNECTS];
+static unsigned int eof_count;
+
+
+static void free_cb(uv_handle_t* handle) {
+  free(handle);
+}
+
+
+static void connection_cb(uv_stream_t* server, int status) {
+  uv_tcp_t* conn;
+
+  ASSERT_EQ(0, status);
+
+  conn = malloc(sizeof(*conn));
+  ASSERT_NOT_NULL(conn);
+  ASSERT_EQ(0, uv_tcp_init(server->loop, conn));
+  ASSERT_EQ(0, uv_accept(server, (uv_stream_t*) conn));
+  uv_close((uv_handle_t*) conn, free_cb);
+
+  accepted[(uv_tcp_t*) server - servers]++;
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  static char slab[64];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread == 0 || nread == UV_ECONNRESET)
+    return;
+
+  ASSERT_EQ(nread, UV_EOF);
+  eof_count++;
+  uv_close((uv_handle_t*) stream, NULL);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_read_start(req->handle, alloc_cb, read_cb));
+}
+
+
+TEST_IMPL(loop_group) {
+  struct sockaddr_in addr;
+  uv_loop_group_t group;
+  unsigned int flags;
+  unsigned int total;
+  unsigned int i;
+  int r;
+
+  ASSERT_EQ(UV_EINVAL, uv_loop_group_init(&group, 0, 0));
+  ASSERT_EQ(0, uv_loop_group_init(&group,
+                                  NUM_LOOPS,
+                                  UV_LOOP_GROUP_PIN_THREADS));
+  ASSERT_EQ(NUM_LOOPS, group.nloops);
+  ASSERT_NULL(uv_loop_group_get_loop(&group, NUM_LOOPS));
+  for (i = 0; i < NUM_LOOPS; i++)
+    ASSERT_NOT_NULL(uv_loop_group_get_loop(&group, i));
+  ASSERT_EQ(UV_EINVAL, uv_loop_group_stop(&group));
+
+  flags = 0;
+#ifdef __linux__
+  flags = UV_LOOP_GROUP_STEER_CPU;
+#endif
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  r = uv_loop_group_listen(&group,
+                           servers,
+                           (const struct sockaddr*) &addr,
+                           NUM_CONNECTS,
+                           flags,
+                           connection_cb);
+  if (r == UV_ENOTSUP) {
+    ASSERT_EQ(0, uv_loop_group_close(&group));
+    RETURN_SKIP("SO_REUSEPORT load balancing is not supported.");
+  }
+  ASSERT_EQ(0, r);
+
+  ASSERT_EQ(0, uv_loop_group_start(&group));
+  ASSERT_EQ(UV_EBUSY, uv_loop_group_start(&group));
+  ASSERT_EQ(UV_EBUSY, uv_loop_group_close(&group));
+
+  for (i = 0; i < NUM_CONNECTS; i++) {
+    ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), clients + i));
+    ASSERT_EQ(0, uv_tcp_connect(connect_reqs + i,
+                                clients + i,
+                                (const struct sockaddr*) &addr,
+                                connect_cb));
+  }
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT_EQ(NUM_CONNECTS, eof_count);
+
+  ASSERT_EQ(0, uv_loop_group_stop(&group));
+  ASSERT_EQ(UV_EINVAL, uv_loop_group_stop(&group));
+
+  total = 0;
+  for (i = 0; i < NUM_LOOPS; i++)
+    total += accepted[i];
+  ASSERT_EQ(NUM_CONNECTS, total);
+
+  /* Closes the listen sockets too. */
+  ASSERT_EQ(0, uv_loop_group_close(&group));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -23,6 +23,11 @@
 #include "task.h"
 #include <string.h> /* memset */
 
+#ifndef _WIN32
+# include <unistd.h> /* close */
+# define closesocket close
+#endif
+
 #define UV_NS_TO_MS 1000000
 
 
@@ -133,3 +138,286 @@ TEST_IMPL(metrics_idle_time_zero) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+
+static uv_metrics_t write_metrics;
+static int write_cb_called;
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_metrics_info(req->handle->loop, &write_metrics));
+  write_cb_called++;
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ASSERT(0 && "read_cb should not be called");
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  ASSERT(0 && "alloc_cb should not be called");
+}
+
+
+TEST_IMPL(metrics_info) {
+  static char data[1 << 22];
+  uv_metrics_t metrics;
+  uv_write_t write_req;
+  uv_os_sock_t fds[2];
+  uv_tcp_t tcp;
+  uv_loop_t loop;
+  uv_buf_t buf;
+  uint64_t ctl;
+  int i;
+
+  ASSERT_EQ(UV_EINVAL, uv_metrics_info(NULL, &metrics));
+  ASSERT_EQ(0, uv_loop_init(&loop));
+  ASSERT_EQ(UV_EINVAL, uv_metrics_info(&loop, NULL));
+
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+  ASSERT_EQ(0, metrics.loop_count);
+  ASSERT_EQ(0, metrics.backend_ctl);
+  ASSERT_EQ(0, metrics.backend_ctl_last);
+
+  ASSERT_EQ(0, uv_socketpair(SOCK_STREAM, 0, fds, 0, UV_NONBLOCK_PIPE));
+  ASSERT_EQ(0, uv_tcp_init(&loop, &tcp));
+  ASSERT_EQ(0, uv_tcp_open(&tcp, fds[0]));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &tcp, alloc_cb, read_cb));
+
+  /* Too much to write in one go, the stream watches for both reading and
+   * writing until the other end has drained the socket.
+   */
+  buf = uv_buf_init(data, sizeof(data));
+  ASSERT_EQ(0, uv_write(&write_req, (uv_stream_t*) &tcp, &buf, 1, write_cb));
+
+  ASSERT_EQ(1, uv_run(&loop, UV_RUN_NOWAIT));
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+  ASSERT_EQ(1, metrics.loop_count);
+  ctl = metrics.backend_ctl;
+
+  /* Stopping and restarting reading before the loop gets to update the
+   * registration doesn't cost a system call.
+   */
+  for (i = 0; i < 4; i++) {
+    ASSERT_EQ(0, uv_read_stop((uv_stream_t*) &tcp));
+    ASSERT_EQ(0, uv_read_start((uv_stream_t*) &tcp, alloc_cb, read_cb));
+    ASSERT_EQ(1, uv_run(&loop, UV_RUN_NOWAIT));
+  }
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+  ASSERT_EQ(ctl, metrics.backend_ctl);
+  ASSERT_EQ(0, write_cb_called);
+
+  for (i = 5; write_cb_called == 0; i++) {
+    ASSERT_EQ(1, uv_run(&loop, UV_RUN_NOWAIT));
+    while (recv(fds[1], data, sizeof(data), 0) > 0);
+  }
+
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+  ASSERT_EQ(i, metrics.loop_count);
+  ASSERT_GT(metrics.backend_ctl, 0);
+  ASSERT_LE(metrics.backend_ctl_last, metrics.backend_ctl);
+
+  /* The stream stopped watching for writability. The registration is
+   * narrowed down on the next loop iteration and left alone afterwards.
+   */
+  for (i = 0; i < 4; i++)
+    ASSERT_EQ(1, uv_run(&loop, UV_RUN_NOWAIT));
+
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+  ASSERT_LE(metrics.backend_ctl - write_metrics.backend_ctl, 1);
+  ASSERT_EQ(0, metrics.backend_ctl_last);
+#ifdef __linux__
+  if (getenv("UV_USE_IO_URING") == NULL &&
+      getenv("UV_USE_EDGE_TRIGGERED") == NULL) {
+    ASSERT_EQ(1, metrics.backend_ctl - write_metrics.backend_ctl);
+  }
+#endif
+
+  uv_close((uv_handle_t*) &tcp, NULL);
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(0, closesocket(fds[1]));
+
+  ASSERT_EQ(0, uv_loop_close(&loop));
+  return 0;
+}
+
+
+static void timer_sleep_cb(uv_timer_t* handle) {
+  (*(int*) handle->data)++;
+  uv_sleep(20);
+}
+
+
+static void async_noop_cb(uv_async_t* handle) {
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(metrics_phases) {
+  uv_metrics_histogram_t hist;
+  uv_metrics_t metrics;
+  uv_timer_t timer;
+  uv_async_t async;
+  uv_loop_t loop;
+  uint64_t p50;
+  uint64_t p99;
+  int cntr;
+  int i;
+
+  ASSERT_EQ(0, uv_loop_init(&loop));
+  ASSERT_EQ(UV_EINVAL,
+            uv_metrics_phase_info(&loop, UV_METRICS_PHASE_TIMERS, &hist));
+  ASSERT_EQ(0, uv_loop_configure(&loop, UV_METRICS_PHASES));
+  ASSERT_EQ(UV_EINVAL,
+            uv_metrics_phase_info(&loop, UV_METRICS_PHASE_MAX, &hist));
+  ASSERT_EQ(UV_EINVAL, uv_metrics_phase_info(&loop, 0, NULL));
+
+  cntr = 0;
+  timer.data = &cntr;
+  ASSERT_EQ(0, uv_timer_init(&loop, &timer));
+  ASSERT_EQ(0, uv_timer_start(&timer, timer_sleep_cb, 1, 1));
+  ASSERT_EQ(0, uv_async_init(&loop, &async, async_noop_cb));
+  ASSERT_EQ(0, uv_async_send(&async));
+
+  while (cntr < 3)
+    ASSERT_EQ(1, uv_run(&loop, UV_RUN_ONCE));
+
+  uv_close((uv_handle_t*) &timer, NULL);
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(0, uv_metrics_info(&loop, &metrics));
+
+  /* Every iteration records every phase once, timers twice in
+   * UV_RUN_ONCE mode.
+   */
+  for (i = 0; i < UV_METRICS_PHASE_MAX; i++) {
+    ASSERT_EQ(0, uv_metrics_phase_info(&loop, i, &hist));
+    if (i == UV_METRICS_PHASE_TIMERS)
+      ASSERT_GE(hist.count, metrics.loop_count);
+    else
+      ASSERT_EQ(hist.count, metrics.loop_count);
+    ASSERT_LE(hist.max, hist.sum);
+  }
+
+  /* The timer callback is the slow part of the loop. */
+  ASSERT_EQ(0, uv_metrics_phase_info(&loop, UV_METRICS_PHASE_TIMERS, &hist));
+  ASSERT_GE(hist.sum, 3 * 20 * UV_NS_TO_MS);
+  ASSERT_GE(hist.max, 20 * UV_NS_TO_MS);
+  p50 = uv_metrics_histogram_percentile(&hist, 50);
+  p99 = uv_metrics_histogram_percentile(&hist, 99);
+  ASSERT_LE(p50, p99);
+  ASSERT_LE(p99, hist.max);
+  ASSERT_EQ(hist.max, uv_metrics_histogram_percentile(&hist, 100));
+
+  ASSERT_EQ(0, uv_metrics_phase_info(&loop, UV_METRICS_PHASE_TICK, &hist));
+  ASSERT_GE(hist.sum, 3 * 20 * UV_NS_TO_MS);
+
+  /* Time blocked waiting for the next timer doesn't count. */
+  ASSERT_EQ(0, uv_metrics_phase_info(&loop, UV_METRICS_PHASE_POLL, &hist));
+  ASSERT_LT(hist.max, 20 * UV_NS_TO_MS);
+
+  /* The async wakeup and three timers. */
+  ASSERT_GE(metrics.events, 1);
+  ASSERT_GE(metrics.callbacks, 3 + 1);
+
+  ASSERT_EQ(0, uv_loop_close(&loop));
+  return 0;
+}
+
+
+static uv_slow_callback_info_t slow_infos[8];
+static int slow_cb_called;
+
+
+static void slow_cb(uv_loop_t* loop, const uv_slow_callback_info_t* info) {
+  ASSERT_LT(slow_cb_called, ARRAY_SIZE(slow_infos));
+  slow_infos[slow_cb_called++] = *info;
+}
+
+
+static void timer_fast_cb(uv_timer_t* handle) {
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+static void timer_slow_cb(uv_timer_t* handle) {
+  uv_sleep(20);
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+#ifndef _WIN32
+static void slow_alloc_cb(uv_handle_t* handle,
+                          size_t size,
+                          uv_buf_t* buf) {
+  static char slab[64];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void slow_read_cb(uv_stream_t* stream,
+                         ssize_t nread,
+                         const uv_buf_t* buf) {
+  ASSERT_EQ(1, nread);
+  uv_sleep(20);
+  uv_close((uv_handle_t*) stream, NULL);
+}
+#endif
+
+
+TEST_IMPL(metrics_slow_callback) {
+  uv_timer_t fast;
+  uv_timer_t slow;
+  uv_loop_t loop;
+#ifndef _WIN32
+  uv_os_sock_t fds[2];
+  uv_pipe_t pipe;
+#endif
+
+  ASSERT_EQ(0, uv_loop_init(&loop));
+  ASSERT_EQ(UV_EINVAL, uv_loop_set_slow_callback(NULL, 0, slow_cb));
+  ASSERT_EQ(0, uv_loop_set_slow_callback(&loop, 10 * UV_NS_TO_MS, slow_cb));
+
+  /* Only the callback that takes longer than the threshold is reported. */
+  ASSERT_EQ(0, uv_timer_init(&loop, &fast));
+  ASSERT_EQ(0, uv_timer_start(&fast, timer_fast_cb, 0, 0));
+  ASSERT_EQ(0, uv_timer_init(&loop, &slow));
+  ASSERT_EQ(0, uv_timer_start(&slow, timer_slow_cb, 0, 0));
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT_EQ(1, slow_cb_called);
+  ASSERT_EQ(UV_METRICS_PHASE_TIMERS, slow_infos[0].phase);
+  ASSERT_EQ(UV_TIMER, slow_infos[0].type);
+  ASSERT_EQ(-1, slow_infos[0].fd);
+  ASSERT_GE(slow_infos[0].duration, 20 * UV_NS_TO_MS);
+
+#ifndef _WIN32
+  /* I/O callbacks carry the handle type and the file descriptor. */
+  ASSERT_EQ(0, uv_socketpair(SOCK_STREAM, 0, fds, 0, 0));
+  ASSERT_EQ(0, uv_pipe_init(&loop, &pipe, 0));
+  ASSERT_EQ(0, uv_pipe_open(&pipe, fds[0]));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &pipe, slow_alloc_cb, slow_read_cb));
+  ASSERT_EQ(1, write(fds[1], "x", 1));
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(0, close(fds[1]));
+
+  ASSERT_EQ(2, slow_cb_called);
+  ASSERT_EQ(UV_METRICS_PHASE_POLL, slow_infos[1].phase);
+  ASSERT_EQ(UV_NAMED_PIPE, slow_infos[1].type);
+  ASSERT_EQ(fds[0], slow_infos[1].fd);
+  ASSERT_GE(slow_infos[1].duration, 20 * UV_NS_TO_MS);
+
+  /* Removing the hook stops the reports. */
+  ASSERT_EQ(0, uv_loop_set_slow_callback(&loop, 0, NULL));
+  ASSERT_EQ(0, uv_timer_init(&loop, &slow));
+  ASSERT_EQ(0, uv_timer_start(&slow, timer_slow_cb, 0, 0));
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(2, slow_cb_called);
+#endif
+
+  ASSERT_EQ(0, uv_loop_close(&loop));
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -0,0 +1,126 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+# include <sys/resource.h>
+# include <sys/socket.h>
+# include <unistd.h>
+
+/* Above the part of the watcher table that is indexed by fd, see
+ * UV__WATCHERS_DENSE_MAX in src/unix/internal.h.
+ */
+# define HIGH_FD_BASE 16384
+# define NPAIRS 48
+
+static uv_poll_t polls[NPAIRS];
+static int wfds[NPAIRS];
+static int poll_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void poll_cb(uv_poll_t* handle, int status, int events) {
+  uv_os_fd_t fd;
+  char c;
+
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(UV_READABLE, events & UV_READABLE);
+  ASSERT_EQ(0, uv_fileno((uv_handle_t*) handle, &fd));
+  ASSERT_EQ(1, read(fd, &c, 1));
+  ASSERT_EQ(handle - polls, c);
+
+  poll_cb_called++;
+  uv_close((uv_handle_t*) handle, close_cb);
+}
+#endif
+
+
+TEST_IMPL(poll_high_fd) {
+#ifdef _WIN32
+  RETURN_SKIP("Unix only test");
+#else
+  struct rlimit lim;
+  uv_poll_t other;
+  uv_loop_t* loop;
+  int fds[2];
+  int fd;
+  int i;
+  char c;
+
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &lim));
+  if (lim.rlim_max != RLIM_INFINITY &&
+      lim.rlim_max < HIGH_FD_BASE + 4 * NPAIRS) {
+    RETURN_SKIP("File descriptor limit too low.");
+  }
+  lim.rlim_cur = lim.rlim_max;
+  if (setrlimit(RLIMIT_NOFILE, &lim))
+    RETURN_SKIP("File descriptor limit too low.");
+
+  loop = uv_default_loop();
+
+  /* Spread the fds out, with gaps, like a process where other loops own the
+   * fds in between.
+   */
+  for (i = 0; i < NPAIRS; i++) {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    fd = HIGH_FD_BASE + 3 * i + (i % 2);
+    ASSERT_EQ(fd, dup2(fds[0], fd));
+    ASSERT_EQ(0, close(fds[0]));
+    wfds[i] = fds[1];
+
+    ASSERT_EQ(0, uv_poll_init(loop, &polls[i], fd));
+    ASSERT_EQ(0, uv_poll_start(&polls[i], UV_READABLE, poll_cb));
+  }
+
+  /* The table knows who owns the fd. */
+  ASSERT_EQ(UV_EEXIST, uv_poll_init(loop, &other, HIGH_FD_BASE));
+
+  /* Unregister half of them again and re-register them. */
+  for (i = 0; i < NPAIRS; i += 2)
+    ASSERT_EQ(0, uv_poll_stop(&polls[i]));
+  for (i = 0; i < NPAIRS; i += 2)
+    ASSERT_EQ(0, uv_poll_start(&polls[i], UV_READABLE, poll_cb));
+
+  for (i = 0; i < NPAIRS; i++) {
+    c = (char) i;
+    ASSERT_EQ(1, write(wfds[i], &c, 1));
+  }
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT_EQ(NPAIRS, poll_cb_called);
+  ASSERT_EQ(NPAIRS, close_cb_called);
+
+  for (i = 0; i < NPAIRS; i++) {
+    ASSERT_EQ(0, close(HIGH_FD_BASE + 3 * i + (i % 2)));
+    ASSERT_EQ(0, close(wfds[i]));
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
@@ -24,6 +24,7 @@
 #ifdef _WIN32
 # include <fcntl.h>
 #else
+# include <sys/resource.h>
 # include <sys/socket.h>
 # include <unistd.h>
 #endif
@@ -694,3 +695,108 @@ TEST_IMPL(poll_nested_kqueue) {
   return 0;
 }
 #endif  /* UV_HAVE_KQUEUE */
+
+
+#define NUM_READY 1000
+
+static uv_os_sock_t ready_fds[NUM_READY][2];
+static uv_poll_t ready_handles[NUM_READY];
+static int ready_cb_called;
+
+
+static void ready_cb(uv_poll_t* handle, int status, int events) {
+  char c;
+
+  ASSERT(status == 0);
+  ASSERT(events == UV_READABLE);
+  ASSERT(1 == recv(*(uv_os_sock_t*) handle->data, &c, 1, 0));
+  ready_cb_called++;
+}
+
+
+/* Makes all file descriptors readable and runs one loop iteration. Returns
+ * how often the loop polled the kernel for the events.
+ */
+static uint64_t run_ready(uv_loop_t* loop) {
+  uv_metrics_t metrics;
+  uint64_t polls;
+  int called;
+  int i;
+
+  for (i = 0; i < NUM_READY; i++)
+    ASSERT_EQ(1, send(ready_fds[i][1], "!", 1, 0));
+
+  ASSERT_EQ(0, uv_metrics_info(loop, &metrics));
+  polls = metrics.backend_poll;
+  called = ready_cb_called;
+  ASSERT_EQ(1, uv_run(loop, UV_RUN_ONCE));
+  ASSERT_EQ(called + NUM_READY, ready_cb_called);
+  ASSERT_EQ(0, uv_metrics_info(loop, &metrics));
+
+  return metrics.backend_poll - polls;
+}
+
+
+/* More file descriptors than fit into one batch of events become ready at
+ * the same time. All of them should be dispatched in one loop iteration. On
+ * Linux the event array grows while the loop is busy, until one poll picks up
+ * all the events, and shrinks again when the loop has been quiet for a while.
+ */
+TEST_IMPL(poll_many_ready) {
+#ifdef _WIN32
+  RETURN_SKIP("Not on Windows");
+#else
+  struct rlimit lim;
+  uv_loop_t* loop;
+  uint64_t polls;
+  int i;
+
+  ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &lim));
+  if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < 2 * NUM_READY + 64) {
+    lim.rlim_cur = lim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &lim) ||
+        (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < 2 * NUM_READY + 64)) {
+      RETURN_SKIP("File descriptor limit too low.");
+    }
+  }
+
+  loop = uv_default_loop();
+  for (i = 0; i < NUM_READY; i++) {
+    ASSERT(0 == uv_socketpair(SOCK_STREAM, 0, ready_fds[i], 0, 0));
+    ASSERT(0 == uv_poll_init_socket(loop, &ready_handles[i], ready_fds[i][0]));
+    ready_handles[i].data = &ready_fds[i][0];
+    ASSERT(0 == uv_poll_start(&ready_handles[i], UV_READABLE, ready_cb));
+  }
+
+  polls = run_ready(loop);
+#ifdef __linux__
+  ASSERT_GT(polls, 1);
+#endif
+
+  polls = run_ready(loop);
+#ifdef __linux__
+  ASSERT_EQ(polls, 1);
+#endif
+
+  for (i = 0; i < 1000; i++)
+    ASSERT(1 == uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(ready_cb_called == 2 * NUM_READY);
+
+  polls = run_ready(loop);
+#ifdef __linux__
+  ASSERT_GT(polls, 1);
+#endif
+  (void) polls;
+
+  for (i = 0; i < NUM_READY; i++) {
+    uv_close((uv_handle_t*) &ready_handles[i], NULL);
+    ASSERT(0 == close(ready_fds[i][1]));
+  }
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  for (i = 0; i < NUM_READY; i++)
+    ASSERT(0 == close(ready_fds[i][0]));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
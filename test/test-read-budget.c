@@ -0,0 +1,123 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef _WIN32
+
+TEST_IMPL(read_budget) {
+  RETURN_SKIP("Test not implemented on Windows.");
+}
+
+#else  /* !_WIN32 */
+
+#include <string.h>
+#include <unistd.h>
+
+#define DATA_SIZE (32 * 1024)
+#define READ_SIZE 1024
+
+static uv_loop_t loop;
+static uv_pipe_t pipes[2];
+static int peer_fds[2];
+static size_t bytes_read[2];
+static unsigned int max_run[2];
+static unsigned int run;
+static int last_read = -1;
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  static char slab[READ_SIZE];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  int i;
+
+  ASSERT_GE(nread, 0);
+  if (nread == 0)
+    return;
+
+  i = (uv_pipe_t*) stream - pipes;
+  bytes_read[i] += nread;
+
+  /* Count how many reads in a row one stream gets while the other one also
+   * has data waiting.
+   */
+  if (bytes_read[0] < DATA_SIZE && bytes_read[1] < DATA_SIZE) {
+    run = i == last_read ? run + 1 : 1;
+    if (run > max_run[i])
+      max_run[i] = run;
+  }
+  last_read = i;
+
+  if (bytes_read[i] == DATA_SIZE) {
+    uv_close((uv_handle_t*) stream, NULL);
+    ASSERT_EQ(0, close(peer_fds[i]));
+  }
+}
+
+
+TEST_IMPL(read_budget) {
+  uv_os_sock_t fds[2];
+  char data[DATA_SIZE];
+  int i;
+
+  ASSERT_EQ(0, uv_loop_init(&loop));
+  ASSERT_EQ(UV_EINVAL, uv_loop_configure(&loop, UV_LOOP_READ_BUDGET, 0, (size_t) 0));
+  ASSERT_EQ(0, uv_loop_configure(&loop, UV_LOOP_READ_BUDGET, 4, (size_t) 0));
+  ASSERT_EQ(0, uv_loop_configure(&loop, UV_LOOP_READ_ROUND_ROBIN));
+  /* Deferred edge-triggered streams aren't reported again, they must be read
+   * on their turn. UV_ENOSYS where there is no edge-triggered mode.
+   */
+  uv_loop_configure(&loop, UV_LOOP_USE_EDGE_TRIGGERED);
+
+  memset(data, 'x', sizeof(data));
+
+  for (i = 0; i < 2; i++) {
+    ASSERT_EQ(0, uv_socketpair(SOCK_STREAM, 0, fds, 0, 0));
+    ASSERT_EQ(0, uv_pipe_init(&loop, &pipes[i], 0));
+    ASSERT_EQ(0, uv_pipe_open(&pipes[i], fds[0]));
+    ASSERT_EQ(DATA_SIZE, write(fds[1], data, sizeof(data)));
+    peer_fds[i] = fds[1];
+    ASSERT_EQ(0, uv_read_start((uv_stream_t*) &pipes[i], alloc_cb, read_cb));
+  }
+
+  /* The second stream gets a smaller budget of its own. */
+  ASSERT_EQ(0, uv_stream_set_read_budget((uv_stream_t*) &pipes[1],
+                                         0,
+                                         2 * READ_SIZE));
+
+  ASSERT_EQ(0, uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT_EQ(DATA_SIZE, bytes_read[0]);
+  ASSERT_EQ(DATA_SIZE, bytes_read[1]);
+  ASSERT_EQ(4, max_run[0]);
+  ASSERT_EQ(2, max_run[1]);
+
+  ASSERT_EQ(0, uv_loop_close(&loop));
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+#endif  /* !_WIN32 */
@@ -0,0 +1,156 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#define POOL_BUF_SIZE 4096
+#define DATA_SIZE (64 * 1024)
+
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t incoming;
+static uv_write_t write_req;
+static uv_shutdown_t shutdown_req;
+static char data[DATA_SIZE];
+static size_t bytes_read;
+static char* pool_base;
+static int read_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  read_cb_called++;
+
+  if (nread == UV_EOF) {
+    ASSERT_EQ(bytes_read, DATA_SIZE);
+    uv_read_pool_release(stream->loop, buf);
+    uv_close((uv_handle_t*) &client, close_cb);
+    uv_close((uv_handle_t*) &server, close_cb);
+    uv_close((uv_handle_t*) &incoming, close_cb);
+    return;
+  }
+
+  ASSERT_GE(nread, 0);
+
+  if (buf->base != NULL) {
+    ASSERT_EQ(POOL_BUF_SIZE, buf->len);
+
+    /* The buffer went back to the pool in the previous callback. */
+    if (pool_base == NULL)
+      pool_base = buf->base;
+    ASSERT_PTR_EQ(pool_base, buf->base);
+
+    /* The buffer size can't change while buffers are handed out. */
+    ASSERT_EQ(UV_EBUSY, uv_read_pool_init(stream->loop, 2 * POOL_BUF_SIZE, 4));
+    ASSERT_EQ(0, uv_read_pool_init(stream->loop, POOL_BUF_SIZE, 4));
+  }
+
+  ASSERT_LE(bytes_read + nread, DATA_SIZE);
+  ASSERT_EQ(0, memcmp(data + bytes_read, buf->base, nread));
+  bytes_read += nread;
+
+  uv_read_pool_release(stream->loop, buf);
+}
+
+
+static void connection_cb(uv_stream_t* tcp, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_tcp_init(tcp->loop, &incoming));
+  ASSERT_EQ(0, uv_accept(tcp, (uv_stream_t*) &incoming));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &incoming,
+                             uv_read_pool_alloc,
+                             read_cb));
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT_EQ(0, status);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT_EQ(0, status);
+  buf = uv_buf_init(data, sizeof(data));
+  ASSERT_EQ(0, uv_write(&write_req, req->handle, &buf, 1, write_cb));
+  ASSERT_EQ(0, uv_shutdown(&shutdown_req, req->handle, shutdown_cb));
+}
+
+
+TEST_IMPL(read_pool) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  size_t i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (char) (i * 31 + i / 256);
+
+  ASSERT_EQ(UV_EINVAL, uv_read_pool_init(loop, 1, 4));
+
+  /* Without a pool there is nothing to hand out. */
+  ASSERT_EQ(0, uv_tcp_init(loop, &client));
+  uv_read_pool_alloc((uv_handle_t*) &client, 65536, &buf);
+  ASSERT_NULL(buf.base);
+  ASSERT_EQ(0, buf.len);
+
+  ASSERT_EQ(0, uv_read_pool_init(loop, POOL_BUF_SIZE, 4));
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(loop, &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, connection_cb));
+  ASSERT_EQ(0, uv_tcp_connect(&connect_req,
+                              &client,
+                              (struct sockaddr*) &addr,
+                              connect_cb));
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+
+  ASSERT_EQ(DATA_SIZE, bytes_read);
+  ASSERT_GE(read_cb_called, DATA_SIZE / POOL_BUF_SIZE);
+  ASSERT_NOT_NULL(pool_base);
+  ASSERT_EQ(3, close_cb_called);
+
+  /* Nothing is outstanding, the size can change now. */
+  ASSERT_EQ(0, uv_read_pool_init(loop, 2 * POOL_BUF_SIZE, 4));
+  ASSERT_EQ(0, uv_read_pool_init(loop, 0, 0));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -0,0 +1,201 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifdef _WIN32
+
+TEST_IMPL(tcp_accept_batch) {
+  RETURN_SKIP("Test not implemented on Windows.");
+}
+
+TEST_IMPL(tcp_accept_handoff) {
+  RETURN_SKIP("Test not implemented on Windows.");
+}
+
+#else  /* !_WIN32 */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define NUM_CLIENTS 4
+
+static uv_tcp_t server;
+static uv_tcp_t clients[NUM_CLIENTS];
+static uv_channel_t channels[2];
+static uv_timer_t timer;
+static int client_fds[NUM_CLIENTS];
+static int connection_cb_called;
+static int accepted;
+static int handed_off[2];
+
+
+static void connect_clients(void) {
+  struct sockaddr_in addr;
+  int i;
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+
+  /* Blocking connects that all end up in the backlog before the loop runs. */
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    client_fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(client_fds[i], 0);
+    ASSERT_EQ(0, connect(client_fds[i],
+                         (const struct sockaddr*) &addr,
+                         sizeof(addr)));
+  }
+}
+
+
+static void close_all(void) {
+  int i;
+
+  ASSERT_EQ(NUM_CLIENTS, accepted);
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    uv_close((uv_handle_t*) &clients[i], NULL);
+    ASSERT_EQ(0, close(client_fds[i]));
+  }
+
+  uv_close((uv_handle_t*) &server, NULL);
+}
+
+
+static void accept_one(uv_stream_t* stream) {
+  ASSERT_LT(accepted, NUM_CLIENTS);
+  ASSERT_EQ(0, uv_tcp_init(stream->loop, &clients[accepted]));
+  ASSERT_EQ(0, uv_accept(stream, (uv_stream_t*) &clients[accepted]));
+  accepted++;
+}
+
+
+static void drain_cb(uv_timer_t* handle) {
+  static uv_tcp_t client;
+
+  /* The rest of the batch is still queued up. */
+  while (accepted < NUM_CLIENTS)
+    accept_one((uv_stream_t*) &server);
+
+  ASSERT_EQ(0, uv_tcp_init(handle->loop, &client));
+  ASSERT_EQ(UV_EAGAIN, uv_accept((uv_stream_t*) &server,
+                                 (uv_stream_t*) &client));
+  uv_close((uv_handle_t*) &client, NULL);
+  uv_close((uv_handle_t*) handle, NULL);
+  close_all();
+}
+
+
+static void batch_connection_cb(uv_stream_t* stream, int status) {
+  ASSERT_EQ(0, status);
+  connection_cb_called++;
+
+  /* Take the first one right away, leave the others for later. */
+  if (connection_cb_called == 1) {
+    accept_one(stream);
+    return;
+  }
+
+  ASSERT_EQ(2, connection_cb_called);
+  ASSERT_EQ(0, uv_timer_init(stream->loop, &timer));
+  ASSERT_EQ(0, uv_timer_start(&timer, drain_cb, 0, 0));
+}
+
+
+TEST_IMPL(tcp_accept_batch) {
+  struct sockaddr_in addr;
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(0, uv_tcp_accept_batch(&server, 2 * NUM_CLIENTS));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, batch_connection_cb));
+
+  connect_clients();
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT_EQ(2, connection_cb_called);
+  ASSERT_EQ(NUM_CLIENTS, accepted);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void handoff_connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(0 && "should not be called");
+}
+
+
+static void channel_cb(uv_channel_t* channel, void** msgs, unsigned int n) {
+  unsigned int i;
+
+  for (i = 0; i < n; i++) {
+    ASSERT_LT(accepted, NUM_CLIENTS);
+    ASSERT_EQ(0, uv_tcp_init(channel->async.loop, &clients[accepted]));
+    ASSERT_EQ(0, uv_tcp_open(&clients[accepted],
+                             (uv_os_sock_t) (intptr_t) msgs[i]));
+    accepted++;
+    handed_off[channel - channels]++;
+  }
+
+  if (accepted == NUM_CLIENTS) {
+    uv_channel_close(&channels[0], NULL);
+    uv_channel_close(&channels[1], NULL);
+    close_all();
+  }
+}
+
+
+TEST_IMPL(tcp_accept_handoff) {
+  uv_channel_t* handoff[2];
+  struct sockaddr_in addr;
+  uv_loop_t* loop;
+
+  loop = uv_default_loop();
+  ASSERT_EQ(0, uv_channel_init(loop, &channels[0], NUM_CLIENTS, channel_cb));
+  ASSERT_EQ(0, uv_channel_init(loop, &channels[1], NUM_CLIENTS, channel_cb));
+  handoff[0] = &channels[0];
+  handoff[1] = &channels[1];
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(loop, &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(UV_EINVAL, uv_tcp_accept_handoff(&server, NULL, 2));
+  ASSERT_EQ(0, uv_tcp_accept_handoff(&server, handoff, 2));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, handoff_connection_cb));
+
+  connect_clients();
+
+  ASSERT_EQ(0, uv_run(loop, UV_RUN_DEFAULT));
+
+  ASSERT_EQ(NUM_CLIENTS, accepted);
+  ASSERT_EQ(NUM_CLIENTS / 2, handed_off[0]);
+  ASSERT_EQ(NUM_CLIENTS / 2, handed_off[1]);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+#endif  /* !_WIN32 */
@@ -0,0 +1,138 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#define REQ_COUNT 10000
+#define DATA_SIZE (REQ_COUNT * 3 * 64)
+
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t incoming;
+static uv_write_t write_reqs[REQ_COUNT];
+static unsigned char data[DATA_SIZE];
+static size_t bytes_written;
+static size_t bytes_read;
+static int write_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+  /* Requests that went out in the same writev() still complete in order. */
+  ASSERT_PTR_EQ(req, &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  static char slab[65536];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ASSERT_GE(nread, 0);
+  ASSERT_LE(bytes_read + nread, bytes_written);
+  ASSERT_EQ(0, memcmp(data + bytes_read, buf->base, nread));
+  bytes_read += nread;
+
+  if (bytes_read == bytes_written) {
+    uv_close((uv_handle_t*) &client, close_cb);
+    uv_close((uv_handle_t*) &server, close_cb);
+    uv_close((uv_handle_t*) &incoming, close_cb);
+  }
+}
+
+
+static void connection_cb(uv_stream_t* tcp, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_tcp_init(tcp->loop, &incoming));
+  ASSERT_EQ(0, uv_accept(tcp, (uv_stream_t*) &incoming));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &incoming, alloc_cb, read_cb));
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t bufs[3];
+  unsigned int nbufs;
+  unsigned int j;
+  size_t len;
+  int i;
+
+  ASSERT_EQ(0, status);
+
+  /* Requests of one to three buffers, some of them empty. The socket fills
+   * up quickly, after that the requests queue up and get written together.
+   */
+  for (i = 0; i < REQ_COUNT; i++) {
+    nbufs = 1 + i % 3;
+    for (j = 0; j < nbufs; j++) {
+      len = (i * 7 + j * 13) % 64;
+      ASSERT_LE(bytes_written + len, sizeof(data));
+      bufs[j] = uv_buf_init((char*) data + bytes_written, len);
+      bytes_written += len;
+    }
+
+    ASSERT_EQ(0, uv_write(&write_reqs[i], req->handle, bufs, nbufs, write_cb));
+  }
+}
+
+
+TEST_IMPL(tcp_write_gather) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+  int buffer_size;
+  size_t i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (unsigned char) (i * 31 + i / 256);
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, connection_cb));
+
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &client));
+  ASSERT_EQ(0, uv_tcp_connect(&connect_req,
+                              &client,
+                              (struct sockaddr*) &addr,
+                              connect_cb));
+  buffer_size = 16 * 1024;
+  ASSERT_EQ(0, uv_send_buffer_size((uv_handle_t*) &client, &buffer_size));
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT_EQ(REQ_COUNT, write_cb_called);
+  ASSERT_EQ(bytes_written, bytes_read);
+  ASSERT_EQ(3, close_cb_called);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -0,0 +1,379 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BIG_SIZE (256 * 1024)
+#define SMALL_SIZE 100
+#define REQ_COUNT 16
+
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t incoming;
+static uv_write_t write_reqs[REQ_COUNT];
+static uv_shutdown_t shutdown_req;
+static unsigned char* data;
+static size_t data_size;
+static size_t bytes_read;
+static int write_cb_called;
+static int shutdown_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_PTR_EQ(req, &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT_EQ(0, status);
+  /* The zero-copy writes completed before the shutdown did. */
+  ASSERT_EQ(REQ_COUNT, write_cb_called);
+  shutdown_cb_called++;
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  static char slab[65536];
+  *buf = uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread == UV_EOF) {
+    ASSERT_EQ(data_size, bytes_read);
+    uv_close((uv_handle_t*) &client, close_cb);
+    uv_close((uv_handle_t*) &server, close_cb);
+    uv_close((uv_handle_t*) &incoming, close_cb);
+    return;
+  }
+
+  ASSERT_GE(nread, 0);
+  ASSERT_LE(bytes_read + nread, data_size);
+  ASSERT_EQ(0, memcmp(data + bytes_read, buf->base, nread));
+  bytes_read += nread;
+}
+
+
+static void connection_cb(uv_stream_t* tcp, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_tcp_init(tcp->loop, &incoming));
+  ASSERT_EQ(0, uv_accept(tcp, (uv_stream_t*) &incoming));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &incoming, alloc_cb, read_cb));
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+  size_t offset;
+  size_t len;
+  int i;
+
+  ASSERT_EQ(0, status);
+
+  /* Large writes go out without copying, the small ones in between are
+   * below the threshold and get copied.
+   */
+  offset = 0;
+  for (i = 0; i < REQ_COUNT; i++) {
+    len = i % 2 ? SMALL_SIZE : BIG_SIZE;
+    buf = uv_buf_init((char*) data + offset, len);
+    offset += len;
+    ASSERT_EQ(0, uv_write(&write_reqs[i], req->handle, &buf, 1, write_cb));
+  }
+
+  ASSERT_EQ(offset, data_size);
+  ASSERT_EQ(0, uv_shutdown(&shutdown_req, req->handle, shutdown_cb));
+}
+
+
+TEST_IMPL(tcp_zerocopy) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+  size_t i;
+  int r;
+
+  ASSERT_EQ(0, uv_tcp_init_ex(uv_default_loop(), &client, AF_INET));
+  r = uv_tcp_zerocopy(&client, 1, 64 * 1024);
+  if (r == UV_ENOTSUP || r == UV_ENOPROTOOPT) {
+    uv_close((uv_handle_t*) &client, NULL);
+    ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    MAKE_VALGRIND_HAPPY();
+    RETURN_SKIP("Zero-copy sends are not supported.");
+  }
+  ASSERT_EQ(0, r);
+
+  data_size = (REQ_COUNT / 2) * (BIG_SIZE + SMALL_SIZE);
+  data = malloc(data_size);
+  ASSERT_NOT_NULL(data);
+  for (i = 0; i < data_size; i++)
+    data[i] = (unsigned char) (i * 13 + i / 4096);
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, connection_cb));
+
+  ASSERT_EQ(0, uv_tcp_connect(&connect_req,
+                              &client,
+                              (struct sockaddr*) &addr,
+                              connect_cb));
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT_EQ(REQ_COUNT, write_cb_called);
+  ASSERT_EQ(1, shutdown_cb_called);
+  ASSERT_EQ(3, close_cb_called);
+  ASSERT_EQ(data_size, bytes_read);
+
+  free(data);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+#define LARGE_SIZE (4 * 1024 * 1024)
+
+static uv_timer_t timer;
+static uv_write_t large_req;
+static uint64_t loop_count;
+static int paused;
+
+
+static void large_write_cb(uv_write_t* req, int status) {
+  ASSERT_EQ(0, status);
+  write_cb_called++;
+}
+
+
+static void timer_cb(uv_timer_t* handle);
+
+
+static void large_read_cb(uv_stream_t* stream,
+                          ssize_t nread,
+                          const uv_buf_t* buf) {
+  uv_metrics_t metrics;
+
+  ASSERT_GE(nread, 0);
+  ASSERT_LE(bytes_read + nread, data_size);
+  ASSERT_EQ(0, memcmp(data + bytes_read, buf->base, nread));
+  bytes_read += nread;
+
+  if (bytes_read == data_size) {
+    uv_close((uv_handle_t*) &client, close_cb);
+    uv_close((uv_handle_t*) &server, close_cb);
+    uv_close((uv_handle_t*) &incoming, close_cb);
+    return;
+  }
+
+  /* Take a break halfway through, the writer runs into the full socket
+   * buffers while the kernel is done with what it sent so far.
+   */
+  if (!paused && bytes_read >= data_size / 2) {
+    paused = 1;
+    ASSERT_EQ(0, uv_read_stop(stream));
+    ASSERT_EQ(0, uv_metrics_info(stream->loop, &metrics));
+    loop_count = metrics.loop_count;
+    ASSERT_EQ(0, uv_timer_init(stream->loop, &timer));
+    ASSERT_EQ(0, uv_timer_start(&timer, timer_cb, 100, 0));
+  }
+}
+
+
+static void timer_cb(uv_timer_t* handle) {
+  uv_metrics_t metrics;
+
+  /* The completions of the zero-copy sends have been picked up right away.
+   * Otherwise the loop spins on the POLLERR that the error queue reports.
+   */
+  ASSERT_EQ(0, uv_metrics_info(handle->loop, &metrics));
+  ASSERT_LT(metrics.loop_count - loop_count, 10);
+  ASSERT_EQ(0, write_cb_called);
+
+  uv_close((uv_handle_t*) handle, NULL);
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &incoming,
+                             alloc_cb,
+                             large_read_cb));
+}
+
+
+static void large_connection_cb(uv_stream_t* tcp, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_tcp_init(tcp->loop, &incoming));
+  ASSERT_EQ(0, uv_accept(tcp, (uv_stream_t*) &incoming));
+  ASSERT_EQ(0, uv_read_start((uv_stream_t*) &incoming,
+                             alloc_cb,
+                             large_read_cb));
+}
+
+
+static void large_connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+  int size;
+
+  ASSERT_EQ(0, status);
+
+  size = 64 * 1024;
+  ASSERT_EQ(0, uv_send_buffer_size((uv_handle_t*) req->handle, &size));
+
+  buf = uv_buf_init((char*) data, data_size);
+  ASSERT_EQ(0, uv_write(&large_req, req->handle, &buf, 1, large_write_cb));
+}
+
+
+/* A single write much larger than the socket buffers, its sends complete
+ * long before the write request does.
+ */
+TEST_IMPL(tcp_zerocopy_large_write) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+  size_t i;
+  int size;
+  int r;
+
+  ASSERT_EQ(0, uv_tcp_init_ex(uv_default_loop(), &client, AF_INET));
+  r = uv_tcp_zerocopy(&client, 1, 0);
+  if (r == UV_ENOTSUP || r == UV_ENOPROTOOPT) {
+    uv_close((uv_handle_t*) &client, NULL);
+    ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    MAKE_VALGRIND_HAPPY();
+    RETURN_SKIP("Zero-copy sends are not supported.");
+  }
+  ASSERT_EQ(0, r);
+
+  data_size = LARGE_SIZE;
+  data = malloc(data_size);
+  ASSERT_NOT_NULL(data);
+  for (i = 0; i < data_size; i++)
+    data[i] = (unsigned char) (i * 13 + i / 4096);
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  /* Accepted connections inherit it. */
+  size = 64 * 1024;
+  ASSERT_EQ(0, uv_recv_buffer_size((uv_handle_t*) &server, &size));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, large_connection_cb));
+
+  ASSERT_EQ(0, uv_tcp_connect(&connect_req,
+                              &client,
+                              (struct sockaddr*) &addr,
+                              large_connect_cb));
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT_EQ(1, write_cb_called);
+  ASSERT_EQ(3, close_cb_called);
+  ASSERT_EQ(data_size, bytes_read);
+
+  free(data);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void close_write_cb(uv_write_t* req, int status) {
+  /* Sent, or never got to it before the close. */
+  ASSERT(status == 0 || status == UV_ECANCELED);
+  write_cb_called++;
+}
+
+
+static void close_timer_cb(uv_timer_t* handle) {
+  uv_close((uv_handle_t*) &server, close_cb);
+  uv_close((uv_handle_t*) &incoming, close_cb);
+  uv_close((uv_handle_t*) handle, close_cb);
+}
+
+
+static void close_connection_cb(uv_stream_t* tcp, int status) {
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_tcp_init(tcp->loop, &incoming));
+  ASSERT_EQ(0, uv_accept(tcp, (uv_stream_t*) &incoming));
+}
+
+
+static void close_connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT_EQ(0, status);
+
+  buf = uv_buf_init((char*) data, data_size);
+  ASSERT_EQ(0, uv_write(&large_req, req->handle, &buf, 1, close_write_cb));
+
+  /* The kernel hasn't acknowledged the sends yet. The loop keeps running
+   * after the handle is gone.
+   */
+  uv_close((uv_handle_t*) req->handle, close_cb);
+  ASSERT_EQ(0, uv_timer_init(req->handle->loop, &timer));
+  ASSERT_EQ(0, uv_timer_start(&timer, close_timer_cb, 10, 0));
+}
+
+
+TEST_IMPL(tcp_zerocopy_close) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+  int r;
+
+  ASSERT_EQ(0, uv_tcp_init_ex(uv_default_loop(), &client, AF_INET));
+  r = uv_tcp_zerocopy(&client, 1, 1);
+  if (r == UV_ENOTSUP || r == UV_ENOPROTOOPT) {
+    uv_close((uv_handle_t*) &client, NULL);
+    ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+    MAKE_VALGRIND_HAPPY();
+    RETURN_SKIP("Zero-copy sends are not supported.");
+  }
+  ASSERT_EQ(0, r);
+
+  data_size = BIG_SIZE;
+  data = calloc(1, data_size);
+  ASSERT_NOT_NULL(data);
+
+  ASSERT_EQ(0, uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT_EQ(0, uv_tcp_init(uv_default_loop(), &server));
+  ASSERT_EQ(0, uv_tcp_bind(&server, (struct sockaddr*) &addr, 0));
+  ASSERT_EQ(0, uv_listen((uv_stream_t*) &server, 128, close_connection_cb));
+
+  ASSERT_EQ(0, uv_tcp_connect(&connect_req,
+                              &client,
+                              (struct sockaddr*) &addr,
+                              close_connect_cb));
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT_EQ(1, write_cb_called);
+  ASSERT_EQ(4, close_cb_called);
+
+  free(data);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
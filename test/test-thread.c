@@ -30,6 +30,10 @@
 #include <pthread.h>
 #endif
 
+#if defined(__linux__) && defined(__GLIBC__)
+#include <sched.h>  /* cpu_set_t */
+#endif
+
 struct getaddrinfo_req {
   uv_thread_t thread_id;
   unsigned int counter;
@@ -293,3 +297,69 @@ TEST_IMPL(thread_stack_size_explicit) {
 
   return 0;
 }
+
+
+static void thread_check_affinity(void* arg) {
+#if defined(__linux__) && defined(__GLIBC__)
+  cpu_set_t cpuset;
+
+  ASSERT(0 == pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset));
+  ASSERT(CPU_COUNT(&cpuset) == 1);
+  ASSERT(CPU_ISSET(*(int*) arg, &cpuset));
+#endif
+}
+
+
+TEST_IMPL(thread_affinity) {
+  uv_thread_options_t options;
+  uv_thread_t thread;
+  char* cpumask;
+  int cpu;
+  int n;
+#if defined(__linux__) && defined(__GLIBC__)
+  cpu_set_t cpuset;
+#endif
+
+  n = uv_cpumask_size();
+  options.flags = UV_THREAD_HAS_AFFINITY;
+  options.cpumask = NULL;
+  options.mask_size = 0;
+
+  if (n == UV_ENOTSUP) {
+    ASSERT(UV_ENOTSUP == uv_thread_create_ex(&thread,
+                                             &options,
+                                             thread_check_affinity,
+                                             NULL));
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+  }
+
+  ASSERT(n > 0);
+  cpumask = calloc(n, 1);
+  ASSERT_NOT_NULL(cpumask);
+  options.cpumask = cpumask;
+  options.mask_size = n;
+
+  /* Empty mask. */
+  ASSERT(UV_EINVAL == uv_thread_create_ex(&thread,
+                                          &options,
+                                          thread_check_affinity,
+                                          NULL));
+
+  /* Pin to the first CPU the process may run on. */
+  cpu = 0;
+#if defined(__linux__) && defined(__GLIBC__)
+  ASSERT(0 == sched_getaffinity(0, sizeof(cpuset), &cpuset));
+  while (!CPU_ISSET(cpu, &cpuset))
+    cpu++;
+#endif
+  cpumask[cpu] = 1;
+
+  ASSERT(0 == uv_thread_create_ex(&thread,
+                                  &options,
+                                  thread_check_affinity,
+                                  &cpu));
+  ASSERT(0 == uv_thread_join(&thread));
+
+  free(cpumask);
+  return 0;
+}
@@ -255,6 +255,7 @@ TEST_IMPL(threadpool_cancel_random) {
 
 TEST_IMPL(threadpool_cancel_work) {
   struct cancel_info ci;
+  uv_work_queue_stats_t stats;
   uv_work_t reqs[16];
   uv_loop_t* loop;
   unsigned i;
@@ -272,6 +273,12 @@ TEST_IMPL(threadpool_cancel_work) {
   ASSERT(1 == timer_cb_called);
   ASSERT(ARRAY_SIZE(reqs) == done2_cb_called);
 
+  /* Only the requests that saturate the pool have run. */
+  ASSERT(0 == uv_work_queue_stats(UV_WORK_PRIORITY_NORMAL, &stats));
+  ASSERT(0 == stats.depth);
+  ASSERT(ARRAY_SIZE(pause_reqs) + ARRAY_SIZE(reqs) == stats.submitted);
+  ASSERT(ARRAY_SIZE(pause_reqs) == stats.started);
+
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
@@ -319,6 +326,15 @@ TEST_IMPL(threadpool_cancel_fs) {
   ASSERT(0 == uv_fs_write(loop, reqs + n++, 0, &iov, 1, 0, fs_cb));
   ASSERT(n == ARRAY_SIZE(reqs));
 
+  /* Requests that went to the io_uring can only be cancelled until the loop
+   * submits them, cancel everything right away.
+   */
+  if (getenv("UV_USE_IO_URING") != NULL) {
+    for (n = 0; n < ARRAY_SIZE(reqs); n++)
+      ASSERT(0 == uv_cancel((uv_req_t*) (reqs + n)));
+    ci.nreqs = 0;
+  }
+
   ASSERT(0 == uv_timer_init(loop, &ci.timer_handle));
   ASSERT(0 == uv_timer_start(&ci.timer_handle, timer_cb, 10, 0));
   ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
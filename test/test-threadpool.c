@@ -22,6 +22,11 @@
 #include "uv.h"
 #include "task.h"
 
+#if defined(__linux__) && defined(__GLIBC__)
+#include <pthread.h>
+#include <sched.h>  /* cpu_set_t */
+#endif
+
 static int work_cb_count;
 static int after_work_cb_count;
 static uv_work_t work_req;
@@ -74,3 +79,385 @@ TEST_IMPL(threadpool_queue_work_einval) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uv_sem_t low_sem;
+static uv_work_t low_reqs[8];
+static uv_work_t high_req;
+static int low_done_cb_count;
+static int high_done_cb_count;
+
+
+static void low_work_cb(uv_work_t* req) {
+  uv_sem_wait(&low_sem);
+}
+
+
+static void low_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  /* The high priority request must not have waited for the bulk work. */
+  ASSERT(high_done_cb_count == 1);
+  low_done_cb_count++;
+}
+
+
+static void high_work_cb(uv_work_t* req) {
+  ASSERT(req == &high_req);
+}
+
+
+static void high_done_cb(uv_work_t* req, int status) {
+  size_t i;
+
+  ASSERT(status == 0);
+  ASSERT(low_done_cb_count == 0);
+  high_done_cb_count++;
+
+  for (i = 0; i < ARRAY_SIZE(low_reqs); i++)
+    uv_sem_post(&low_sem);
+}
+
+
+TEST_IMPL(threadpool_queue_work_priority) {
+  uv_work_queue_stats_t stats;
+  uv_loop_t* loop;
+  char buf[64];
+  size_t i;
+
+  /* Twice as many blocking low priority requests as there are threads, they
+   * would occupy the whole pool if their concurrency wasn't limited. */
+  snprintf(buf,
+           sizeof(buf),
+           "UV_THREADPOOL_SIZE=%lu",
+           (unsigned long) ARRAY_SIZE(low_reqs) / 2);
+  putenv(buf);
+
+  loop = uv_default_loop();
+  ASSERT(0 == uv_sem_init(&low_sem, 0));
+
+  ASSERT(UV_EINVAL == uv_queue_work_ex(loop,
+                                       &high_req,
+                                       (uv_work_priority_t) 42,
+                                       high_work_cb,
+                                       high_done_cb));
+  ASSERT(UV_EINVAL == uv_queue_work_ex(loop,
+                                       &high_req,
+                                       UV_WORK_PRIORITY_HIGH,
+                                       NULL,
+                                       high_done_cb));
+
+  for (i = 0; i < ARRAY_SIZE(low_reqs); i++)
+    ASSERT(0 == uv_queue_work_ex(loop,
+                                 low_reqs + i,
+                                 UV_WORK_PRIORITY_LOW,
+                                 low_work_cb,
+                                 low_done_cb));
+
+  ASSERT(0 == uv_queue_work_ex(loop,
+                               &high_req,
+                               UV_WORK_PRIORITY_HIGH,
+                               high_work_cb,
+                               high_done_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(high_done_cb_count == 1);
+  ASSERT(low_done_cb_count == ARRAY_SIZE(low_reqs));
+
+  ASSERT(UV_EINVAL == uv_work_queue_stats((uv_work_priority_t) 42, &stats));
+  ASSERT(UV_EINVAL == uv_work_queue_stats(UV_WORK_PRIORITY_HIGH, NULL));
+
+  ASSERT(0 == uv_work_queue_stats(UV_WORK_PRIORITY_HIGH, &stats));
+  ASSERT(stats.depth == 0);
+  ASSERT(stats.submitted == 1);
+  ASSERT(stats.started == 1);
+
+  ASSERT(0 == uv_work_queue_stats(UV_WORK_PRIORITY_NORMAL, &stats));
+  ASSERT(stats.submitted == 0);
+
+  ASSERT(0 == uv_work_queue_stats(UV_WORK_PRIORITY_LOW, &stats));
+  ASSERT(stats.depth == 0);
+  ASSERT(stats.submitted == ARRAY_SIZE(low_reqs));
+  ASSERT(stats.started == ARRAY_SIZE(low_reqs));
+  /* Half of the requests waited for the other half. */
+  ASSERT(stats.max_wait_time > 0);
+  ASSERT(stats.wait_time >= stats.max_wait_time);
+
+  uv_sem_destroy(&low_sem);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_sem_t short_done_sem;
+static uv_sem_t long_sem;
+static uv_work_t short_req;
+static uv_work_t long_req;
+static int short_done_cb_count;
+static int long_done_cb_count;
+
+
+static void short_work_cb(uv_work_t* req) {
+  uv_sem_post(&short_done_sem);
+}
+
+
+static void short_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(long_done_cb_count == 0);
+  short_done_cb_count++;
+  uv_sem_post(&long_sem);
+}
+
+
+static void long_work_cb(uv_work_t* req) {
+  /* Only returns when the short request has been reported. */
+  uv_sem_wait(&long_sem);
+}
+
+
+static void long_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(short_done_cb_count == 1);
+  long_done_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_queue_work_done_early) {
+  uv_loop_t* loop;
+
+  /* One thread runs both requests, the long one after the short one. */
+  putenv("UV_THREADPOOL_SIZE=1");
+  loop = uv_default_loop();
+  ASSERT(0 == uv_sem_init(&short_done_sem, 0));
+  ASSERT(0 == uv_sem_init(&long_sem, 0));
+
+  /* Keep the worker from handing the short request over right away, it has
+   * to hold on to it while it picks up the long one.
+   */
+  uv_mutex_lock(&loop->wq_mutex);
+  ASSERT(0 == uv_queue_work(loop, &short_req, short_work_cb, short_done_cb));
+  ASSERT(0 == uv_queue_work(loop, &long_req, long_work_cb, long_done_cb));
+  uv_sem_wait(&short_done_sem);
+  uv_sleep(100);
+  uv_mutex_unlock(&loop->wq_mutex);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(short_done_cb_count == 1);
+  ASSERT(long_done_cb_count == 1);
+
+  uv_sem_destroy(&short_done_sem);
+  uv_sem_destroy(&long_sem);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_barrier_t resize_barrier;
+static uv_work_t resize_reqs[6];
+static int resize_done_cb_count;
+
+
+static void resize_work_cb(uv_work_t* req) {
+  /* Only passes when all requests run at the same time. */
+  uv_barrier_wait(&resize_barrier);
+}
+
+
+static void resize_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  resize_done_cb_count++;
+}
+
+
+static void run_concurrent_work(size_t n) {
+  size_t i;
+
+  ASSERT(n <= ARRAY_SIZE(resize_reqs));
+  ASSERT(0 == uv_barrier_init(&resize_barrier, n));
+  resize_done_cb_count = 0;
+
+  for (i = 0; i < n; i++)
+    ASSERT(0 == uv_queue_work(uv_default_loop(),
+                              resize_reqs + i,
+                              resize_work_cb,
+                              resize_done_cb));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(resize_done_cb_count == (int) n);
+  uv_barrier_destroy(&resize_barrier);
+}
+
+
+static void wait_for_size(unsigned int size) {
+  int i;
+
+  /* Workers exit asynchronously. */
+  for (i = 0; i < 500 && uv_threadpool_size() != size; i++)
+    uv_sleep(10);
+
+  ASSERT(uv_threadpool_size() == size);
+}
+
+
+TEST_IMPL(threadpool_resize) {
+  putenv("UV_THREADPOOL_SIZE=2");
+  ASSERT(uv_threadpool_size() == 2);
+
+  ASSERT(UV_EINVAL == uv_threadpool_resize(0));
+  ASSERT(UV_EINVAL == uv_threadpool_resize(1025));
+
+  ASSERT(0 == uv_threadpool_resize(ARRAY_SIZE(resize_reqs)));
+  ASSERT(uv_threadpool_size() == ARRAY_SIZE(resize_reqs));
+  run_concurrent_work(ARRAY_SIZE(resize_reqs));
+
+  ASSERT(0 == uv_threadpool_resize(1));
+  wait_for_size(1);
+  run_concurrent_work(1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(threadpool_autoscale) {
+  putenv("UV_THREADPOOL_SIZE=1");
+
+  ASSERT(UV_EINVAL == uv_threadpool_autoscale(2, 1, 1, 1));
+  ASSERT(UV_EINVAL == uv_threadpool_autoscale(0, 0, 1, 1));
+  ASSERT(UV_EINVAL == uv_threadpool_autoscale(1, 1025, 1, 1));
+
+  /* Grows when requests wait for more than 1 ms, idle workers exit after
+   * 50 ms. A single thread would block forever in the barrier. */
+  ASSERT(0 == uv_threadpool_autoscale(1, 4, 1, 50));
+  ASSERT(uv_threadpool_size() == 1);
+  run_concurrent_work(4);
+  wait_for_size(1);
+
+  /* The minimum is started right away. */
+  ASSERT(0 == uv_threadpool_autoscale(3, 4, 0, 0));
+  ASSERT(uv_threadpool_size() == 3);
+  run_concurrent_work(3);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_work_t metrics_reqs[4];
+
+
+static void metrics_work_cb(uv_work_t* req) {
+  uv_sleep(20);
+}
+
+
+TEST_IMPL(threadpool_metrics) {
+  uv_threadpool_metrics_t metrics;
+  uint64_t nwait;
+  uint64_t nrun;
+  uint64_t nslow;
+  size_t i;
+  int n;
+
+  putenv("UV_THREADPOOL_SIZE=4");
+  ASSERT(UV_EINVAL == uv_threadpool_metrics(NULL));
+
+  /* Only two of the four threads may run slow I/O work at the same time. */
+  for (i = 0; i < ARRAY_SIZE(metrics_reqs); i++)
+    ASSERT(0 == uv_queue_work_ex(uv_default_loop(),
+                                 metrics_reqs + i,
+                                 UV_WORK_PRIORITY_LOW,
+                                 metrics_work_cb,
+                                 NULL));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  /* Workers update their counters after handing the request back. */
+  for (n = 0; n < 500; n++) {
+    ASSERT(0 == uv_threadpool_metrics(&metrics));
+    if (metrics.idle_threads == metrics.threads)
+      break;
+    uv_sleep(10);
+  }
+
+  ASSERT(metrics.threads == 4);
+  ASSERT(metrics.idle_threads == 4);
+  ASSERT(metrics.queue_depth == 0);
+  ASSERT(metrics.completed == ARRAY_SIZE(metrics_reqs));
+  ASSERT(metrics.slow_io_throttled > 0);
+  ASSERT(metrics.idle_time > 0);
+
+  nwait = 0;
+  nrun = 0;
+  nslow = 0;
+  for (i = 0; i < UV_THREADPOOL_HISTOGRAM_SIZE; i++) {
+    nwait += metrics.wait_time[i];
+    nrun += metrics.run_time[i];
+    /* Bucket 15 starts at 16.384 ms. */
+    if (i >= 15)
+      nslow += metrics.run_time[i];
+  }
+  ASSERT(nwait == ARRAY_SIZE(metrics_reqs));
+  ASSERT(nrun == ARRAY_SIZE(metrics_reqs));
+  ASSERT(nslow == ARRAY_SIZE(metrics_reqs));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static int pinned_cpu;
+
+
+static void pinned_work_cb(uv_work_t* req) {
+#if defined(__linux__) && defined(__GLIBC__)
+  cpu_set_t cpuset;
+
+  ASSERT(0 == pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset));
+  ASSERT(CPU_COUNT(&cpuset) == 1);
+  ASSERT(CPU_ISSET(pinned_cpu, &cpuset));
+#endif
+  work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_affinity) {
+  char buf[64];
+#if defined(__linux__) && defined(__GLIBC__)
+  cpu_set_t cpuset;
+#endif
+
+  if (uv_cpumask_size() == UV_ENOTSUP)
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+
+  /* Pin the workers to the first CPU the process may run on. */
+  pinned_cpu = 0;
+#if defined(__linux__) && defined(__GLIBC__)
+  ASSERT(0 == sched_getaffinity(0, sizeof(cpuset), &cpuset));
+  while (!CPU_ISSET(pinned_cpu, &cpuset))
+    pinned_cpu++;
+#endif
+
+  snprintf(buf, sizeof(buf), "UV_THREADPOOL_CPUS=%d", pinned_cpu);
+  putenv(buf);
+
+  ASSERT(0 == uv_queue_work(uv_default_loop(),
+                            &work_req,
+                            pinned_work_cb,
+                            NULL));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(work_cb_count == 1);
+
+  /* Workers added later are pinned as well. */
+  ASSERT(0 == uv_threadpool_resize(8));
+  ASSERT(0 == uv_queue_work(uv_default_loop(),
+                            &work_req,
+                            pinned_work_cb,
+                            NULL));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(work_cb_count == 2);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
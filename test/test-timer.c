@@ -345,3 +345,144 @@ TEST_IMPL(timer_early_check) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uv_timer_t wheel_timers[200];
+static uint64_t wheel_last_timeout;
+static int wheel_last_index;
+static int wheel_cb_called;
+
+
+static void wheel_cb(uv_timer_t* handle) {
+  int index;
+
+  index = (int) (handle - wheel_timers);
+  /* Repeating timers have already been rescheduled. */
+  if (uv_timer_get_repeat(handle) == 0)
+    ASSERT(0 == uv_timer_get_due_in(handle));
+
+  /* Same order as with the heap: by timeout, then by start order. */
+  ASSERT(handle->timeout >= wheel_last_timeout);
+  if (handle->timeout == wheel_last_timeout)
+    ASSERT(index > wheel_last_index);
+
+  wheel_last_timeout = handle->timeout;
+  wheel_last_index = index;
+  wheel_cb_called++;
+}
+
+
+TEST_IMPL(timer_wheel) {
+  uv_timer_t huge_timer;
+  uv_loop_t loop;
+  int expected;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  /* Existing timers can't be moved to the wheel. */
+  ASSERT(0 == uv_timer_init(&loop, &huge_timer));
+  ASSERT(0 == uv_timer_start(&huge_timer, never_cb, 1, 0));
+  if (getenv("UV_USE_TIMER_WHEEL") == NULL)
+    ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL));
+  ASSERT(0 == uv_timer_stop(&huge_timer));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL));
+
+  /* Beyond the reach of the wheel. */
+  ASSERT(0 == uv_timer_start(&huge_timer, never_cb, (uint64_t) -1, 0));
+  uv_unref((uv_handle_t*) &huge_timer);
+
+  /* Timeouts up to 200 ms cross several level 1 slots, many of them are
+   * the same. Every 7th timer is stopped again. */
+  expected = 0;
+  for (i = 0; i < (int) ARRAY_SIZE(wheel_timers); i++) {
+    ASSERT(0 == uv_timer_init(&loop, wheel_timers + i));
+    ASSERT(0 == uv_timer_start(wheel_timers + i, wheel_cb, (i * 37) % 201, 0));
+    if (i % 7 == 0)
+      ASSERT(0 == uv_timer_stop(wheel_timers + i));
+    else
+      expected++;
+  }
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(wheel_cb_called == expected);
+
+  /* Restarting from a callback and uv_timer_again() keep working. */
+  wheel_cb_called = 0;
+  wheel_last_timeout = 0;
+  ASSERT(0 == uv_timer_start(wheel_timers, wheel_cb, 70, 5));
+  ASSERT(0 == uv_timer_again(wheel_timers));
+  ASSERT_UINT64_EQ(5, uv_timer_get_due_in(wheel_timers));
+  while (wheel_cb_called < 3)
+    ASSERT(1 == uv_run(&loop, UV_RUN_ONCE));
+  ASSERT(0 == uv_timer_stop(wheel_timers));
+
+  for (i = 0; i < (int) ARRAY_SIZE(wheel_timers); i++)
+    uv_close((uv_handle_t*) (wheel_timers + i), NULL);
+  uv_close((uv_handle_t*) &huge_timer, NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_timer_t slack_timers[10];
+static uint64_t slack_fired_at[ARRAY_SIZE(slack_timers)];
+static int slack_cb_called;
+
+
+static void slack_cb(uv_timer_t* handle) {
+  slack_fired_at[handle - slack_timers] = uv_now(handle->loop);
+  slack_cb_called++;
+}
+
+
+TEST_IMPL(timer_slack) {
+  uv_loop_t* loop;
+  uint64_t start;
+  uint64_t due;
+  size_t wakeups;
+  size_t i;
+
+  loop = uv_default_loop();
+  start = uv_now(loop);
+
+  /* Deadlines 1 ms apart, each may fire up to 16 ms late. */
+  for (i = 0; i < ARRAY_SIZE(slack_timers); i++) {
+    ASSERT(0 == uv_timer_init(loop, slack_timers + i));
+    ASSERT(0 == uv_timer_start_ex(slack_timers + i, slack_cb, i + 1, 0, 16));
+    due = uv_timer_get_due_in(slack_timers + i);
+    ASSERT_UINT64_GE(due, i + 1);
+    ASSERT_UINT64_LE(due, i + 1 + 16);
+  }
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(slack_cb_called == ARRAY_SIZE(slack_timers));
+
+  /* The deadlines fall on at most two 16 ms boundaries. */
+  wakeups = 1;
+  for (i = 0; i < ARRAY_SIZE(slack_timers); i++) {
+    ASSERT_UINT64_GE(slack_fired_at[i], start + i + 1);
+    if (i > 0 && slack_fired_at[i] != slack_fired_at[i - 1])
+      wakeups++;
+  }
+  ASSERT(wakeups <= 2);
+
+  /* Repeats keep their slack. */
+  slack_cb_called = 0;
+  ASSERT(0 == uv_timer_start_ex(slack_timers, slack_cb, 1, 3, 32));
+  ASSERT(0 == uv_timer_again(slack_timers));
+  ASSERT_UINT64_GE(uv_timer_get_due_in(slack_timers), 3);
+  ASSERT_UINT64_LE(uv_timer_get_due_in(slack_timers), 3 + 32);
+  ASSERT(0 == uv_timer_stop(slack_timers));
+
+  for (i = 0; i < ARRAY_SIZE(slack_timers); i++)
+    uv_close((uv_handle_t*) (slack_timers + i), NULL);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}